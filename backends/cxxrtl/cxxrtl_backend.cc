@@ -2850,7 +2850,8 @@ struct CxxrtlWorker {
 			f << "#include <cxxrtl/cxxrtl.h>\n";
 		f << "\n";
 		f << "#if defined(CXXRTL_INCLUDE_CAPI_IMPL) || \\\n";
-		f << "    defined(CXXRTL_INCLUDE_VCD_CAPI_IMPL)\n";
+		f << "    defined(CXXRTL_INCLUDE_VCD_CAPI_IMPL) || \\\n";
+		f << "    defined(CXXRTL_INCLUDE_FST_CAPI_IMPL)\n";
 		f << "#include <cxxrtl/capi/cxxrtl_capi.cc>\n";
 		f << "#endif\n";
 		f << "\n";
@@ -2858,6 +2859,10 @@ struct CxxrtlWorker {
 		f << "#include <cxxrtl/capi/cxxrtl_capi_vcd.cc>\n";
 		f << "#endif\n";
 		f << "\n";
+		f << "#if defined(CXXRTL_INCLUDE_FST_CAPI_IMPL)\n";
+		f << "#include <cxxrtl/capi/cxxrtl_capi_fst.cc>\n";
+		f << "#endif\n";
+		f << "\n";
 		f << "using namespace cxxrtl_yosys;\n";
 		f << "\n";
 		f << "namespace " << design_ns << " {\n";
@@ -0,0 +1,117 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef CXXRTL_CAPI_FST_H
+#define CXXRTL_CAPI_FST_H
+
+// This file is a part of the CXXRTL C API. It should be used together with `cxxrtl_capi_fst.cc`.
+//
+// The CXXRTL C API for FST writing makes it possible to insert virtual probes into designs and
+// dump waveforms to Fast Signal Trace files. Unlike the VCD writer, the FST writer owns its output
+// file, and compresses the waveforms on a background thread.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cxxrtl/capi/cxxrtl_capi.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opaque reference to an FST writer.
+typedef struct _cxxrtl_fst *cxxrtl_fst;
+
+// Create an FST writer that writes to the file at `filename`.
+//
+// Returns NULL if the file could not be created.
+cxxrtl_fst cxxrtl_fst_create(const char *filename);
+
+// Write out all samples, finalize the file, and release all resources used by an FST writer.
+void cxxrtl_fst_destroy(cxxrtl_fst fst);
+
+// Set FST timescale.
+//
+// The `number` must be 1, 10, or 100, and the `unit` must be one of `"s"`, `"ms"`, `"us"`, `"ns"`,
+// `"ps"`, or `"fs"`.
+//
+// Timescale can only be set before the first call to `cxxrtl_fst_sample`.
+void cxxrtl_fst_timescale(cxxrtl_fst fst, int number, const char *unit);
+
+// Set the size of sample buffers.
+//
+// Samples are collected into buffers of approximately `size` bytes, which are compressed on
+// a background thread. If `max_pending` full buffers are waiting to be compressed,
+// `cxxrtl_fst_sample` blocks until the background thread catches up.
+//
+// Buffering can only be configured before the first call to `cxxrtl_fst_sample`.
+void cxxrtl_fst_buffering(cxxrtl_fst fst, size_t size, size_t max_pending);
+
+// Schedule a specific CXXRTL object to be sampled.
+//
+// The `name` is a full hierarchical name as described for `cxxrtl_get`; it does not need to match
+// the original name of `object`, if any. The `object` must outlive the FST writer, but there are
+// no other requirements; if desired, it can be provided by user code, rather than come from
+// a design.
+//
+// Objects can only be scheduled before the first call to `cxxrtl_fst_sample`.
+void cxxrtl_fst_add(cxxrtl_fst fst, const char *name, struct cxxrtl_object *object);
+
+// Schedule all CXXRTL objects in a simulation.
+//
+// The design `handle` must outlive the FST writer.
+//
+// Objects can only be scheduled before the first call to `cxxrtl_fst_sample`.
+void cxxrtl_fst_add_from(cxxrtl_fst fst, cxxrtl_handle handle);
+
+// Schedule CXXRTL objects in a simulation that match a given predicate.
+//
+// For every object in the simulation, `filter` is called with the provided `data`, the full
+// hierarchical name of the object (see `cxxrtl_get` for details), and the object description.
+// The object will be sampled if the predicate returns a non-zero value.
+//
+// Objects can only be scheduled before the first call to `cxxrtl_fst_sample`.
+void cxxrtl_fst_add_from_if(cxxrtl_fst fst, cxxrtl_handle handle, void *data,
+                            int (*filter)(void *data, const char *name,
+                                          const struct cxxrtl_object *object));
+
+// Schedule all CXXRTL objects in a simulation except for memories.
+//
+// The design `handle` must outlive the FST writer.
+//
+// Objects can only be scheduled before the first call to `cxxrtl_fst_sample`.
+void cxxrtl_fst_add_from_without_memories(cxxrtl_fst fst, cxxrtl_handle handle);
+
+// Sample all scheduled objects.
+//
+// The values of every signal changed since the previous call to `cxxrtl_fst_sample` (all values if
+// this is the first call) are copied to the current sample buffer at `time`. This function does not
+// perform any formatting or compression itself.
+void cxxrtl_fst_sample(cxxrtl_fst fst, uint64_t time);
+
+// Hand off the current sample buffer to the background thread.
+//
+// This function does not wait for the samples to be written to the file. Use `cxxrtl_fst_destroy`
+// to ensure that all samples are written.
+void cxxrtl_fst_flush(cxxrtl_fst fst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
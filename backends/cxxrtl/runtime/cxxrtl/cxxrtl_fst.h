@@ -0,0 +1,390 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef CXXRTL_FST_H
+#define CXXRTL_FST_H
+
+// The FST writer is built on the FST library vendored in Yosys at `libs/fst`. The simulation must be
+// built with that directory on the include path, and `fstapi.cc`, `fastlz.cc` and `lz4.cc` from it
+// must be linked into the simulation binary together with zlib.
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <fstapi.h>
+
+#include <cxxrtl/cxxrtl.h>
+
+namespace cxxrtl {
+
+// Unlike `vcd_writer`, which formats text on the thread that calls `sample()`, `fst_writer` only
+// snapshots the changed values into a flat sample buffer on the simulation thread. Full buffers are
+// handed off to a background thread, which owns the FST context after the first sample and performs
+// all of the formatting and compression.
+class fst_writer {
+	struct variable {
+		fstHandle handle;
+		size_t width;
+		chunk_t *curr;
+		size_t cache_offset;
+		debug_outline *outline;
+		bool *outline_warm;
+	};
+
+	// A sample buffer is a sequence of records. A record starting with `time_marker` is followed by
+	// two chunks containing a 64-bit timestamp (low chunk first). Any other record starts with
+	// a variable index and is followed by the chunks of its value (see `record_chunks()`).
+	static constexpr chunk_t time_marker = ~chunk_t(0);
+	typedef std::vector<chunk_t> sample_buffer;
+
+	fstWriterContext *context = nullptr;
+	std::vector<std::string> current_scope;
+	std::map<debug_outline*, bool> outlines;
+	std::vector<variable> variables;
+	std::vector<chunk_t> cache;
+	std::map<chunk_t*, size_t> aliases;
+	bool streaming = false;
+
+	size_t buffer_chunks = 1 << 20;
+	size_t max_pending_buffers = 4;
+	sample_buffer buffer;
+
+	std::thread compressor;
+	std::mutex mutex;
+	std::condition_variable pending_cond;
+	std::condition_variable space_cond;
+	std::deque<sample_buffer> pending;
+	std::vector<sample_buffer> recycled;
+	bool finishing = false;
+
+	static size_t chunks_for(size_t width) {
+		return (width + (sizeof(chunk_t) * 8 - 1)) / (sizeof(chunk_t) * 8);
+	}
+
+	// `fstWriterEmitValueChangeVec32()` reads the chunk above the most significant one even if
+	// the width is a multiple of 32 bits, so values of such widths are followed by a spare chunk.
+	static size_t record_chunks(size_t width) {
+		return chunks_for(width) + (width > 32 && width % 32 == 0);
+	}
+
+	void emit_scope(const std::vector<std::string> &scope) {
+		assert(!streaming);
+		size_t same_scope_count = 0;
+		while ((same_scope_count < current_scope.size()) &&
+			   (same_scope_count < scope.size()) &&
+			   (current_scope[same_scope_count] == scope[same_scope_count])) {
+			same_scope_count++;
+		}
+		while (current_scope.size() > same_scope_count) {
+			fstWriterSetUpscope(context);
+			current_scope.pop_back();
+		}
+		while (current_scope.size() < scope.size()) {
+			fstWriterSetScope(context, FST_ST_VCD_MODULE, scope[current_scope.size()].c_str(), nullptr);
+			current_scope.push_back(scope[current_scope.size()]);
+		}
+	}
+
+	void emit_var(variable &var, enum fstVarType type, const std::string &name,
+	              size_t lsb_at, bool multipart) {
+		assert(!streaming);
+		std::string full_name = name;
+		if (multipart || name.back() == ']' || lsb_at != 0) {
+			if (var.width == 1)
+				full_name += " [" + std::to_string(lsb_at) + "]";
+			else
+				full_name += " [" + std::to_string(lsb_at + var.width - 1) + ":" + std::to_string(lsb_at) + "]";
+		}
+		// Variables that were unified by `register_variable` become FST aliases.
+		fstHandle handle = fstWriterCreateVar(context, type, FST_VD_IMPLICIT, var.width, full_name.c_str(),
+		                                      var.handle);
+		if (var.handle == 0)
+			var.handle = handle;
+	}
+
+	void reset_outlines() {
+		for (auto &outline_it : outlines)
+			outline_it.second = /*warm=*/(outline_it.first == nullptr);
+	}
+
+	variable &register_variable(size_t width, chunk_t *curr, bool constant = false, debug_outline *outline = nullptr) {
+		if (aliases.count(curr)) {
+			return variables[aliases[curr]];
+		} else {
+			auto outline_it = outlines.emplace(outline, /*warm=*/(outline == nullptr)).first;
+			aliases[curr] = variables.size();
+			if (constant) {
+				variables.emplace_back(variable { 0, width, curr, (size_t)-1, outline_it->first, &outline_it->second });
+			} else {
+				variables.emplace_back(variable { 0, width, curr, cache.size(), outline_it->first, &outline_it->second });
+				cache.insert(cache.end(), &curr[0], &curr[chunks_for(width)]);
+			}
+			return variables.back();
+		}
+	}
+
+	bool test_variable(const variable &var) {
+		if (var.cache_offset == (size_t)-1)
+			return false; // constant
+		if (!*var.outline_warm) {
+			var.outline->eval();
+			*var.outline_warm = true;
+		}
+		const size_t chunks = chunks_for(var.width);
+		if (std::equal(&var.curr[0], &var.curr[chunks], &cache[var.cache_offset])) {
+			return false;
+		} else {
+			std::copy(&var.curr[0], &var.curr[chunks], &cache[var.cache_offset]);
+			return true;
+		}
+	}
+
+	void record_value(size_t index) {
+		const variable &var = variables[index];
+		buffer.push_back(chunk_t(index));
+		buffer.insert(buffer.end(), &var.curr[0], &var.curr[chunks_for(var.width)]);
+		buffer.resize(buffer.size() + record_chunks(var.width) - chunks_for(var.width));
+	}
+
+	void record_time(uint64_t timestamp) {
+		buffer.push_back(chunk_t(time_marker));
+		buffer.push_back(chunk_t(timestamp));
+		buffer.push_back(chunk_t(timestamp >> 32));
+	}
+
+	void emit_buffer(const sample_buffer &samples) {
+		size_t offset = 0;
+		while (offset < samples.size()) {
+			if (samples[offset] == time_marker) {
+				uint64_t timestamp = samples[offset + 1] | (uint64_t(samples[offset + 2]) << 32);
+				fstWriterEmitTimeChange(context, timestamp);
+				offset += 3;
+			} else {
+				const variable &var = variables[samples[offset]];
+				if (var.width == 0)
+					fstWriterEmitValueChange(context, var.handle, "0");
+				else
+					fstWriterEmitValueChangeVec32(context, var.handle, var.width, &samples[offset + 1]);
+				offset += 1 + record_chunks(var.width);
+			}
+		}
+	}
+
+	void compress() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			pending_cond.wait(lock, [this] { return !pending.empty() || finishing; });
+			if (pending.empty())
+				break;
+			sample_buffer samples = std::move(pending.front());
+			pending.pop_front();
+			space_cond.notify_one();
+			lock.unlock();
+			emit_buffer(samples);
+			samples.clear();
+			lock.lock();
+			recycled.push_back(std::move(samples));
+		}
+	}
+
+	void hand_off() {
+		if (buffer.empty())
+			return;
+		std::unique_lock<std::mutex> lock(mutex);
+		// Bound the memory used by samples that have been taken but not yet compressed; if the
+		// compressor cannot keep up, the simulation is throttled instead.
+		space_cond.wait(lock, [this] { return pending.size() < max_pending_buffers; });
+		pending.push_back(std::move(buffer));
+		if (!recycled.empty()) {
+			buffer = std::move(recycled.back());
+			recycled.pop_back();
+		} else {
+			buffer = sample_buffer();
+			buffer.reserve(buffer_chunks);
+		}
+		pending_cond.notify_one();
+	}
+
+	void start_streaming() {
+		emit_scope({});
+		streaming = true;
+		buffer.reserve(buffer_chunks);
+		compressor = std::thread([this] { compress(); });
+	}
+
+	static std::vector<std::string> split_hierarchy(const std::string &hier_name) {
+		std::vector<std::string> hierarchy;
+		size_t prev = 0;
+		while (true) {
+			size_t curr = hier_name.find_first_of(' ', prev);
+			if (curr == std::string::npos) {
+				hierarchy.push_back(hier_name.substr(prev));
+				break;
+			} else {
+				hierarchy.push_back(hier_name.substr(prev, curr - prev));
+				prev = curr + 1;
+			}
+		}
+		return hierarchy;
+	}
+
+public:
+	fst_writer() {}
+	fst_writer(const fst_writer &) = delete;
+	fst_writer &operator=(const fst_writer &) = delete;
+
+	~fst_writer() {
+		close();
+	}
+
+	// Open the output file. Returns false if the file could not be created.
+	bool open(const std::string &filename) {
+		assert(context == nullptr);
+		context = fstWriterCreate(filename.c_str(), /*use_compressed_hier=*/1);
+		if (context == nullptr)
+			return false;
+		fstWriterSetVersion(context, "CXXRTL");
+		fstWriterSetPackType(context, FST_WR_PT_LZ4);
+		return true;
+	}
+
+	bool is_open() const {
+		return context != nullptr;
+	}
+
+	// Set the size (in chunks) of a sample buffer, and the number of full buffers that may be queued
+	// for compression before `sample()` blocks. Can only be changed before the first `sample()`.
+	void buffering(size_t chunks, size_t max_pending) {
+		assert(!streaming);
+		assert(chunks > 0 && max_pending > 0);
+		buffer_chunks = chunks;
+		max_pending_buffers = max_pending;
+	}
+
+	void timescale(unsigned number, const std::string &unit) {
+		assert(context != nullptr && !streaming);
+		assert(number == 1 || number == 10 || number == 100);
+		assert(unit == "s" || unit == "ms" || unit == "us" ||
+		       unit == "ns" || unit == "ps" || unit == "fs");
+		fstWriterSetTimescaleFromString(context, (std::to_string(number) + unit).c_str());
+	}
+
+	void add(const std::string &hier_name, const debug_item &item, bool multipart = false) {
+		assert(context != nullptr);
+		std::vector<std::string> scope = split_hierarchy(hier_name);
+		std::string name = scope.back();
+		scope.pop_back();
+
+		emit_scope(scope);
+		switch (item.type) {
+			case debug_item::VALUE:
+				emit_var(register_variable(item.width, item.curr, /*constant=*/item.next == nullptr),
+				         FST_VT_VCD_WIRE, name, item.lsb_at, multipart);
+				break;
+			case debug_item::WIRE:
+				emit_var(register_variable(item.width, item.curr),
+				         FST_VT_VCD_REG, name, item.lsb_at, multipart);
+				break;
+			case debug_item::MEMORY: {
+				const size_t stride = chunks_for(item.width);
+				for (size_t index = 0; index < item.depth; index++) {
+					chunk_t *nth_curr = &item.curr[stride * index];
+					std::string nth_name = name + '[' + std::to_string(index) + ']';
+					emit_var(register_variable(item.width, nth_curr),
+					         FST_VT_VCD_REG, nth_name, item.lsb_at, multipart);
+				}
+				break;
+			}
+			case debug_item::ALIAS:
+				// See the comment in `vcd_writer::add()`.
+				emit_var(register_variable(item.width, item.curr),
+				         FST_VT_VCD_WIRE, name, item.lsb_at, multipart);
+				break;
+			case debug_item::OUTLINE:
+				emit_var(register_variable(item.width, item.curr, /*constant=*/false, item.outline),
+				         FST_VT_VCD_WIRE, name, item.lsb_at, multipart);
+				break;
+		}
+	}
+
+	template<class Filter>
+	void add(const debug_items &items, const Filter &filter) {
+		// `debug_items` is a map, so the items are already sorted in an order optimal for emitting
+		// FST scopes.
+		for (auto &it : items.table)
+			for (auto &part : it.second)
+				if (filter(it.first, part))
+					add(it.first, part, it.second.size() > 1);
+	}
+
+	void add(const debug_items &items) {
+		this->add(items, [](const std::string &, const debug_item &) {
+			return true;
+		});
+	}
+
+	void add_without_memories(const debug_items &items) {
+		this->add(items, [](const std::string &, const debug_item &item) {
+			return item.type != debug_item::MEMORY;
+		});
+	}
+
+	void sample(uint64_t timestamp) {
+		assert(context != nullptr);
+		bool first_sample = !streaming;
+		if (first_sample)
+			start_streaming();
+		reset_outlines();
+		record_time(timestamp);
+		for (size_t index = 0; index < variables.size(); index++)
+			if (test_variable(variables[index]) || first_sample)
+				record_value(index);
+		if (buffer.size() >= buffer_chunks)
+			hand_off();
+	}
+
+	// Hand off the samples taken so far to the compression thread without waiting for them to
+	// be written.
+	void flush() {
+		if (streaming)
+			hand_off();
+	}
+
+	// Write out all samples and finalize the file. Blocks until the compression thread is done.
+	void close() {
+		if (context == nullptr)
+			return;
+		if (streaming) {
+			hand_off();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				finishing = true;
+			}
+			pending_cond.notify_one();
+			compressor.join();
+		}
+		fstWriterClose(context);
+		context = nullptr;
+	}
+};
+
+}
+
+#endif
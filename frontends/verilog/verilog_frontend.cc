@@ -46,6 +46,11 @@ using namespace VERILOG_FRONTEND;
 static std::vector<std::string> verilog_defaults;
 static std::list<std::vector<std::string>> verilog_defaults_stack;
 
+const std::vector<std::string> &VERILOG_FRONTEND::default_options()
+{
+	return verilog_defaults;
+}
+
 static void error_on_dpi_function(AST::AstNode *node)
 {
     if (node->type == AST::AST_DPI_FUNCTION)
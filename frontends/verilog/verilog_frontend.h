@@ -39,6 +39,9 @@ YOSYS_NAMESPACE_BEGIN
 
 namespace VERILOG_FRONTEND
 {
+	// options registered with 'verilog_defaults', used by every read_verilog call
+	const std::vector<std::string> &default_options();
+
 	/* Ephemeral context class */
 	struct ConstParser {
 		AST::AstSrcLocType loc;
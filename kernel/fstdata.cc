@@ -205,77 +205,187 @@ static void reconstruct_clb_attimes(void *user_data, uint64_t pnt_time, fstHandl
 void FstData::reconstruct_callback_attimes(uint64_t pnt_time, fstHandle pnt_facidx, const unsigned char *pnt_value, uint32_t /* plen */)
 {
 	if (pnt_time > end_time || !pnt_value) return;
-	if (curr_cycle > last_cycle) return;
+	if (!block_started) {
+		// the reader always delivers whole blocks, stop it before the next one
+		fstReaderSetLimitTimeRange(ctx, next_block_time, std::max(pnt_time, next_block_time));
+		block_started = true;
+	}
+	block_changes.push_back({pnt_time, pnt_facidx, block_values.size()});
+	block_values += (const char *)pnt_value;
+	block_values += '\0';
+}
+
+void FstData::processChange(uint64_t time, fstHandle handle, const char *value)
+{
 	// if we are past the timestamp
 	bool is_clock = false;
 	if (!all_samples) {
 		for(auto &s : clk_signals) {
-			if (s==pnt_facidx)  {
+			if (s==handle)  {
 				is_clock=true;
 				break;
 			}
 		}
 	}
 
-	if (pnt_time > past_time) {
-		past_data = last_data;
-		past_time = pnt_time;
+	if (time > past_time) {
+		flushPastData();
+		past_time = time;
 	}
 
-	if (pnt_time > last_time) {
+	if (time > last_time) {
 		if (all_samples) {
-			callback(last_time);
-			curr_cycle++;
-			last_time = pnt_time;
+			emitSample(last_time);
+			last_time = time;
 		} else {
 			if (is_clock) {
-				std::string val = std::string((const char *)pnt_value);
-				std::string prev = past_data[pnt_facidx];
+				std::string val = std::string(value);
+				std::string prev = past_data[handle];
 				if ((prev!="1" && val=="1") || (prev!="0" && val=="0")) {
-					callback(last_time);
-					curr_cycle++;
-					last_time = pnt_time;
+					emitSample(last_time);
+					last_time = time;
 				}
 			}
 		}
 	}
 	// always update last_data
-	last_data[pnt_facidx] =  std::string((const char *)pnt_value);
+	last_data[handle] = value;
+	last_changed.push_back(handle);
 }
 
-void FstData::reconstructAllAtTimes(std::vector<fstHandle> &signal, uint64_t start, uint64_t end, unsigned int end_cycle, CallbackFunction cb)
+// past_data = last_data, but only touching the signals that changed
+void FstData::flushPastData()
+{
+	for (auto handle : last_changed) {
+		const std::string &value = last_data.at(handle);
+		past_data[handle] = value;
+		past_changes[handle] = value;
+	}
+	last_changed.clear();
+}
+
+void FstData::emitSample(uint64_t time)
+{
+	Sample sample;
+	sample.time = time;
+	sample.changes.reserve(past_changes.size());
+	for (auto &it : past_changes)
+		sample.changes.emplace_back(it.first, std::move(it.second));
+	past_changes.clear();
+	samples.push_back(std::move(sample));
+	curr_cycle++;
+}
+
+void FstData::setReadHandles(const std::vector<fstHandle> &handles)
+{
+	read_handles = handles;
+}
+
+void FstData::beginSamples(std::vector<fstHandle> &signal, uint64_t start, uint64_t end, unsigned int end_cycle)
 {
 	clk_signals = signal;
-	callback = cb;
 	start_time = start;
 	end_time = end;
 	curr_cycle = 0;
 	last_cycle = end_cycle;
 	last_data.clear();
+	last_changed.clear();
 	last_time = start_time;
 	past_data.clear();
+	past_changes.clear();
 	past_time = start_time;
+	sample_data.clear();
+	samples.clear();
 	all_samples = clk_signals.empty();
 
-	fstReaderSetUnlimitedTimeRange(ctx);
-	fstReaderSetFacProcessMaskAll(ctx);
-	fstReaderIterBlocks2(ctx, reconstruct_clb_attimes, reconstruct_clb_varlen_attimes, this, nullptr);
-	if (last_time!=end_time && curr_cycle <= last_cycle) {
-		past_data = last_data;
-		callback(last_time);
-		curr_cycle++;
+	block_changes.clear();
+	block_values.clear();
+	block_pos = 0;
+	next_block_time = start_time;
+	blocks_done = false;
+	finished = false;
+
+	// without clocks every time step in the file is a sample, which can only
+	// be found by reading all signals
+	if (read_handles.empty() || all_samples) {
+		fstReaderSetFacProcessMaskAll(ctx);
+	} else {
+		fstReaderClrFacProcessMaskAll(ctx);
+		for (auto handle : read_handles)
+			if (handle != 0)
+				fstReaderSetFacProcessMask(ctx, handle);
+		for (auto handle : clk_signals)
+			fstReaderSetFacProcessMask(ctx, handle);
 	}
-	if (curr_cycle <= last_cycle) {
-		past_data = last_data;
-		callback(end_time);
-		curr_cycle++;
+}
+
+void FstData::readBlock()
+{
+	block_changes.clear();
+	block_values.clear();
+	block_pos = 0;
+	block_started = false;
+
+	// blocks that end before next_block_time are skipped using the block
+	// index, the callback stops the reader after the first block it reads
+	fstReaderSetLimitTimeRange(ctx, next_block_time, end_time);
+	fstReaderIterBlocks2(ctx, reconstruct_clb_attimes, reconstruct_clb_varlen_attimes, this, nullptr);
+
+	uint64_t block_end_time = next_block_time;
+	for (auto &change : block_changes)
+		block_end_time = std::max(block_end_time, change.time);
+	if (!block_started || block_end_time >= end_time)
+		blocks_done = true;
+	else
+		next_block_time = block_end_time + 1;
+}
+
+bool FstData::nextSample(uint64_t &time)
+{
+	while (samples.empty() && !finished) {
+		if (curr_cycle > last_cycle) {
+			finished = true;
+		} else if (block_pos < block_changes.size()) {
+			BlockChange &change = block_changes[block_pos++];
+			processChange(change.time, change.handle, block_values.c_str() + change.value);
+		} else if (!blocks_done) {
+			readBlock();
+		} else {
+			if (last_time!=end_time) {
+				flushPastData();
+				emitSample(last_time);
+			}
+			if (curr_cycle <= last_cycle) {
+				flushPastData();
+				emitSample(end_time);
+			}
+			finished = true;
+		}
 	}
+	if (samples.empty())
+		return false;
+
+	Sample &sample = samples.front();
+	for (auto &it : sample.changes)
+		sample_data[it.first] = std::move(it.second);
+	time = sample.time;
+	samples.pop_front();
+	return true;
+}
+
+void FstData::reconstructAllAtTimes(std::vector<fstHandle> &signal, uint64_t start, uint64_t end, unsigned int end_cycle, CallbackFunction cb)
+{
+	beginSamples(signal, start, end, end_cycle);
+	uint64_t time;
+	while (nextSample(time))
+		cb(time);
 }
 
 std::string FstData::valueOf(fstHandle signal)
 {
-	if (past_data.find(signal) == past_data.end()) {
+	auto it = sample_data.find(signal);
+	if (it == sample_data.end()) {
 		return std::string(handle_to_var[signal].width, 'x');
 	}
-	return past_data[signal];
+	return it->second;
 }
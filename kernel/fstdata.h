@@ -23,6 +23,8 @@
 #include "kernel/yosys.h"
 #include "libs/fst/fstapi.h"
 
+#include <deque>
+
 YOSYS_NAMESPACE_BEGIN
 
 typedef std::function<void(uint64_t)> CallbackFunction;
@@ -52,6 +54,21 @@ class FstData
 	void reconstruct_callback_attimes(uint64_t pnt_time, fstHandle pnt_facidx, const unsigned char *pnt_value, uint32_t plen);
 	void reconstructAllAtTimes(std::vector<fstHandle> &signal, uint64_t start_time, uint64_t end_time, unsigned int end_cycle, CallbackFunction cb);
 
+	// Only read value changes for the given handles (in addition to the clock
+	// signals passed to beginSamples). By default all handles are read, which
+	// is also the case when sampling without clock signals.
+	void setReadHandles(const std::vector<fstHandle> &handles);
+
+	// Streaming access to the samples in [start_time, end_time]. A sample is
+	// produced for every time step, or for every edge of one of the given
+	// clock signals if any are given. The file is read one FST block at a
+	// time, starting at the block containing start_time, and each block is
+	// decompressed once. Only the value changes of the current block are kept
+	// in memory, and they are turned into samples one at a time. After
+	// nextSample returns true, valueOf returns the values of that sample.
+	void beginSamples(std::vector<fstHandle> &signal, uint64_t start_time, uint64_t end_time, unsigned int end_cycle);
+	bool nextSample(uint64_t &time);
+
 	std::string valueOf(fstHandle signal);
 	fstHandle getHandle(std::string name);
 	dict<int,fstHandle> getMemoryHandles(std::string name);
@@ -59,24 +76,56 @@ class FstData
 	const char *getTimescaleString() { return timescale_str.c_str(); }
 private:
 	void extractVarNames();
+	void readBlock();
+	void processChange(uint64_t time, fstHandle handle, const char *value);
+	void flushPastData();
+	void emitSample(uint64_t time);
+
+	struct Sample
+	{
+		uint64_t time;
+		std::vector<std::pair<fstHandle, std::string>> changes;
+	};
+
+	// a value change of the current block, the value is at the given offset
+	// in block_values
+	struct BlockChange
+	{
+		uint64_t time;
+		fstHandle handle;
+		size_t value;
+	};
 
 	struct fstReaderContext *ctx;
 	std::vector<FstVar> vars;
 	std::map<fstHandle, FstVar> handle_to_var;
 	std::map<std::string, fstHandle> name_to_handle;
 	std::map<std::string, dict<int, fstHandle>> memory_to_handle;
-	std::map<fstHandle, std::string> last_data;
+	dict<fstHandle, std::string> last_data;
+	std::vector<fstHandle> last_changed;
 	uint64_t last_time;
-	std::map<fstHandle, std::string> past_data;
+	dict<fstHandle, std::string> past_data;
+	dict<fstHandle, std::string> past_changes;
 	uint64_t past_time;
+	dict<fstHandle, std::string> sample_data;
+	// samples not yet returned by nextSample, at most the two emitted at the
+	// end of the data
+	std::deque<Sample> samples;
+	std::vector<BlockChange> block_changes;
+	std::string block_values;
+	size_t block_pos;
 	int scale; // exponent of 10, e.g. -6 = us, -9 = ns
 	std::string timescale_str;
 	uint64_t start_time;
 	uint64_t end_time;
+	uint64_t next_block_time;
+	bool block_started;
+	bool blocks_done;
+	bool finished;
 	unsigned int last_cycle;
 	unsigned int curr_cycle;
-	CallbackFunction callback;
 	std::vector<fstHandle> clk_signals;
+	std::vector<fstHandle> read_handles;
 	bool all_samples;
 	std::string tmp_file;
 };
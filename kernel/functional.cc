@@ -535,6 +535,17 @@ public:
 				memories[mem.cell] = &mem;
 		}
 	}
+	void add_observed(Wire *wire)
+	{
+		if (wire->port_input || wire->port_output)
+			return;
+		DriveSpec driver = driver_map(DriveSpec(DriveChunkWire(wire, 0, wire->width)));
+		for (auto const &chunk : driver.chunks())
+			if (chunk.is_none() || chunk.is_multiple())
+				return;
+		auto &output = factory.add_output(wire->name, ID($observe), Sort(wire->width));
+		output.set_value(enqueue(DriveChunk(DriveChunkWire(wire, 0, wire->width))));
+	}
 private:
 	Node concatenate_read_results(Mem *mem, vector<Node> results)
 	{
@@ -733,6 +744,18 @@ IR IR::from_module(Module *module) {
     return ir;
 }
 
+IR IR::from_module(Module *module, pool<Wire*> const &observed) {
+	IR ir;
+    auto factory = ir.factory();
+    FunctionalIRConstruction ctor(module, factory);
+    for (auto wire : observed)
+        ctor.add_observed(wire);
+    ctor.process_queue();
+    ir.topological_sort();
+    ir.forward_buf();
+    return ir;
+}
+
 void IR::topological_sort() {
     Graph::SccAdaptor compute_graph_scc(_graph);
     bool scc = false;
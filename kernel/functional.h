@@ -250,6 +250,9 @@ namespace Functional {
 		IR::Graph::Ref mutate(Node n);
 	public:
 		static IR from_module(Module *module);
+		// like from_module, but additionally exposes each of the given wires as an output
+		// of kind $observe, provided that the wire is fully driven and not an input port
+		static IR from_module(Module *module, pool<Wire*> const &observed);
 		Factory factory();
 		int size() const { return _graph.size(); }
 		Node operator[](int i);
@@ -0,0 +1,134 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef GATESIM_H
+#define GATESIM_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Bit-parallel simulation of fine-grained gate cells with random input
+// patterns. Every simulated bit has `num_words` consecutive words in `words`,
+// each holding the values of 64 patterns, and is referred to by the offset of
+// its first word. Finding the cells to simulate and keeping track of the
+// offsets of the bits is left to the user.
+struct GateSim
+{
+	int num_words;
+	std::vector<uint64_t> words;
+
+	GateSim(int num_words) : num_words(num_words) { }
+
+	// the cell types that can be simulated, $equiv cells are simulated as
+	// buffers but are not included here
+	static bool is_gate(RTLIL::IdString type)
+	{
+		return type.in(ID($_BUF_), ID($_NOT_), ID($_AND_), ID($_NAND_), ID($_OR_), ID($_NOR_),
+				ID($_XOR_), ID($_XNOR_), ID($_ANDNOT_), ID($_ORNOT_), ID($_MUX_), ID($_NMUX_),
+				ID($_AOI3_), ID($_OAI3_), ID($_AOI4_), ID($_OAI4_));
+	}
+
+	// A pseudo-random word of patterns for an input bit, derived from the
+	// name of its wire, so that the patterns do not depend on the order in
+	// which the bits are simulated.
+	static uint64_t random_word(RTLIL::SigBit bit, int word)
+	{
+		uint64_t x = ((uint64_t)bit.wire->name.index_ << 32) ^ ((uint64_t)bit.offset << 8) ^ word;
+		// splitmix64
+		x += 0x9e3779b97f4a7c15ull;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	// The patterns of an input bit, or of a constant bit, where x and z are
+	// simulated as 0. Pattern 0 is all zeros and pattern 1 all ones.
+	static uint64_t input_word(RTLIL::SigBit bit, int word)
+	{
+		if (bit.wire == nullptr)
+			return bit == RTLIL::State::S1 ? ~uint64_t(0) : 0;
+		uint64_t value = random_word(bit, word);
+		if (word == 0)
+			return (value & ~uint64_t(3)) | 2;
+		return value;
+	}
+
+	static uint64_t eval_gate(RTLIL::IdString type, uint64_t a, uint64_t b, uint64_t c, uint64_t d)
+	{
+		if (type.in(ID($_BUF_), ID($equiv))) return a;
+		if (type == ID($_NOT_)) return ~a;
+		if (type == ID($_AND_)) return a & b;
+		if (type == ID($_NAND_)) return ~(a & b);
+		if (type == ID($_OR_)) return a | b;
+		if (type == ID($_NOR_)) return ~(a | b);
+		if (type == ID($_XOR_)) return a ^ b;
+		if (type == ID($_XNOR_)) return ~(a ^ b);
+		if (type == ID($_ANDNOT_)) return a & ~b;
+		if (type == ID($_ORNOT_)) return a | ~b;
+		if (type == ID($_MUX_)) return (a & ~c) | (b & c);
+		if (type == ID($_NMUX_)) return ~((a & ~c) | (b & c));
+		if (type == ID($_AOI3_)) return ~((a & b) | c);
+		if (type == ID($_OAI3_)) return ~((a | b) & c);
+		if (type == ID($_AOI4_)) return ~((a & b) | (c & d));
+		if (type == ID($_OAI4_)) return ~((a | b) & (c | d));
+		log_abort();
+	}
+
+	// Appends the words of an input bit and returns their offset.
+	int add_input(RTLIL::SigBit bit)
+	{
+		int offset = GetSize(words);
+		for (int i = 0; i < num_words; i++)
+			words.push_back(input_word(bit, i));
+		return offset;
+	}
+
+	// Simulates a gate and returns the offset of the words of its output.
+	// `offset_of` returns the offset of the words of an input bit of the gate,
+	// or -1 if that bit is not simulated, in which case the gate is not
+	// simulated either and -1 is returned.
+	template<typename F>
+	int eval_cell(RTLIL::Cell *cell, F offset_of)
+	{
+		int a = -1, b = -1, c = -1, d = -1;
+		for (auto &conn : cell->connections()) {
+			if (conn.first == ID::Y)
+				continue;
+			int v = offset_of(conn.second.as_bit());
+			if (v < 0)
+				return -1;
+			if (conn.first == ID::A) a = v;
+			else if (conn.first == ID::B) b = v;
+			else if (conn.first.in(ID::C, ID::S)) c = v;
+			else if (conn.first == ID::D) d = v;
+		}
+
+		int y = GetSize(words);
+		words.resize(y + num_words);
+		for (int i = 0; i < num_words; i++)
+			words[y+i] = eval_gate(cell->type, words[a+i], b < 0 ? 0 : words[b+i],
+					c < 0 ? 0 : words[c+i], d < 0 ? 0 : words[d+i]);
+		return y;
+	}
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -56,7 +56,10 @@ struct QuickConeSat {
 	pool<RTLIL::Wire*> imported_onehot;
 	pool<RTLIL::SigBit> bits_queue;
 
-	QuickConeSat(ModWalker &modwalker) : modwalker(modwalker), ez(), satgen(ez.get(), &modwalker.sigmap) {}
+	QuickConeSat(ModWalker &modwalker) : modwalker(modwalker), ez(), satgen(ez.get(), &modwalker.sigmap)
+	{
+		satgen.cnf_templates = true;
+	}
 
 	// Imports a signal into the SAT solver, queues its input cone to be
 	// imported in the next prepare() call.
@@ -3212,6 +3212,43 @@ RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, const RTLIL::Cell *oth
 	return cell;
 }
 
+std::vector<RTLIL::Cell*> RTLIL::Module::addCells(const std::vector<RTLIL::IdString> &names, RTLIL::IdString type,
+		const std::vector<std::pair<RTLIL::IdString, RTLIL::SigSpec>> &ports,
+		const dict<RTLIL::IdString, RTLIL::Const> &attributes)
+{
+	int count = GetSize(names);
+	std::vector<std::vector<RTLIL::SigBit>> port_bits;
+	port_bits.reserve(ports.size());
+	for (auto &port : ports) {
+		log_assert(GetSize(port.second) == count);
+		port_bits.push_back(port.second.to_sigbit_vector());
+	}
+
+	// setPort() does more than storing the connection in these cases
+	bool plain = monitors.empty() && yosys_xtrace == 0 &&
+			(design == nullptr || (design->monitors.empty() && !design->flagBufferedNormalized));
+
+	std::vector<RTLIL::Cell*> result;
+	result.reserve(count);
+	cells_.reserve(cells_.size() + count);
+
+	for (int i = 0; i < count; i++) {
+		RTLIL::Cell *cell = addCell(names[i], type);
+		cell->attributes = attributes;
+		if (plain) {
+			cell->connections_.reserve(ports.size());
+			for (int j = 0; j < GetSize(ports); j++)
+				cell->connections_.emplace(ports[j].first, port_bits[j][i]);
+		} else {
+			for (int j = 0; j < GetSize(ports); j++)
+				cell->setPort(ports[j].first, port_bits[j][i]);
+		}
+		result.push_back(cell);
+	}
+
+	return result;
+}
+
 RTLIL::Memory *RTLIL::Module::addMemory(RTLIL::IdString name)
 {
 	RTLIL::Memory *mem = new RTLIL::Memory;
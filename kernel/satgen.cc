@@ -19,12 +19,149 @@
 
 #include "kernel/satgen.h"
 #include "kernel/ff.h"
+#include "kernel/threading.h"
 #include "kernel/yosys_common.h"
 
 USING_YOSYS_NAMESPACE
 
+namespace {
+
+// CNF of a cell imported with a separate wire on every port. Variables of the
+// port bits are renamed to the variables of the actual port bits on import,
+// all other variables are replaced by new ones.
+struct CnfTemplate
+{
+	bool supported;
+	int num_vars;
+	std::vector<std::vector<int>> clauses;
+	// variable of each port bit (and its undef bit), 0 if not bound
+	std::vector<std::vector<int>> port_vars, port_undef_vars;
+};
+
+// cell type, parameters, port names and widths, SatGen flags
+using CnfTemplateKey = std::tuple<IdString, dict<IdString, Const>, std::vector<std::pair<IdString, int>>, int>;
+
+Mutex cnf_templates_mutex;
+dict<CnfTemplateKey, std::unique_ptr<CnfTemplate>> cnf_templates_cache;
+
+std::unique_ptr<CnfTemplate> build_cnf_template(RTLIL::Cell *cell, const std::vector<std::pair<IdString, int>> &ports,
+		bool model_undef, bool def_formal, bool ignore_div_by_zero)
+{
+	RTLIL::Module module;
+	RTLIL::Cell *template_cell = module.addCell(ID(template), cell->type);
+	template_cell->parameters = cell->parameters;
+
+	std::vector<RTLIL::Wire*> wires;
+	for (auto &port : ports) {
+		wires.push_back(module.addWire(port.first, port.second));
+		template_cell->setPort(port.first, wires.back());
+	}
+
+	ezSAT ez;
+	SigMap sigmap;
+	SatGen satgen(&ez, &sigmap);
+	satgen.model_undef = model_undef;
+	satgen.def_formal = def_formal;
+	satgen.ignore_div_by_zero = ignore_div_by_zero;
+
+	auto result = std::make_unique<CnfTemplate>();
+	result->supported = satgen.importCell(template_cell);
+
+	for (auto wire : wires) {
+		auto &vars = result->port_vars.emplace_back();
+		for (int id : satgen.importSigSpec(wire))
+			vars.push_back(ez.bound(id));
+		auto &undef_vars = result->port_undef_vars.emplace_back();
+		if (model_undef)
+			for (int id : satgen.importUndefSigSpec(wire))
+				undef_vars.push_back(ez.bound(id));
+	}
+
+	result->num_vars = ez.numCnfVariables();
+	ez.consumeCnf(result->clauses);
+	return result;
+}
+
+}
+
+bool SatGen::importCellTemplate(RTLIL::Cell *cell, int timestep)
+{
+	if (!cell->type.in(ID($and), ID($or), ID($xor), ID($xnor), ID($add), ID($sub), ID($not), ID($neg), ID($pos), ID($buf),
+			ID($bweqx), ID($mux), ID($bwmux), ID($bmux), ID($demux), ID($pmux),
+			ID($reduce_and), ID($reduce_or), ID($reduce_xor), ID($reduce_xnor), ID($reduce_bool),
+			ID($logic_not), ID($logic_and), ID($logic_or),
+			ID($lt), ID($le), ID($eq), ID($ne), ID($eqx), ID($nex), ID($ge), ID($gt),
+			ID($shl), ID($shr), ID($sshl), ID($sshr), ID($shift), ID($shiftx),
+			ID($mul), ID($macc), ID($macc_v2), ID($div), ID($mod), ID($divfloor), ID($modfloor),
+			ID($lut), ID($sop), ID($fa), ID($lcu), ID($alu), ID($slice), ID($concat)))
+		return false;
+
+	std::vector<std::pair<IdString, int>> ports;
+	for (auto &conn : cell->connections()) {
+		// importDefSigSpec() models constant x bits as free variables
+		if (model_undef && conn.second.has_const(State::Sx))
+			return false;
+		ports.emplace_back(conn.first, GetSize(conn.second));
+	}
+	std::sort(ports.begin(), ports.end());
+
+	CnfTemplateKey key(cell->type, cell->parameters, ports, model_undef | def_formal << 1 | ignore_div_by_zero << 2);
+
+	const CnfTemplate *tpl = nullptr;
+	{
+		LockGuard lock(cnf_templates_mutex);
+		auto it = cnf_templates_cache.find(key);
+		if (it != cnf_templates_cache.end())
+			tpl = it->second.get();
+	}
+
+	if (tpl == nullptr) {
+		// building a template creates IdStrings
+		if (Multithreading::active())
+			return false;
+		auto new_tpl = build_cnf_template(cell, ports, model_undef, def_formal, ignore_div_by_zero);
+		LockGuard lock(cnf_templates_mutex);
+		tpl = cnf_templates_cache.emplace(key, std::move(new_tpl)).first->second.get();
+	}
+
+	if (!tpl->supported)
+		return false;
+
+	std::vector<int> var_map(tpl->num_vars + 1);
+	for (int i = 0; i < GetSize(ports); i++) {
+		RTLIL::SigSpec sig = cell->getPort(ports[i].first);
+		std::vector<int> ids = importSigSpec(sig, timestep);
+		for (int j = 0; j < GetSize(ids); j++)
+			if (tpl->port_vars[i][j] != 0)
+				var_map[tpl->port_vars[i][j]] = ez->bind(ids[j]);
+		if (model_undef) {
+			ids = importUndefSigSpec(sig, timestep);
+			for (int j = 0; j < GetSize(ids); j++)
+				if (tpl->port_undef_vars[i][j] != 0)
+					var_map[tpl->port_undef_vars[i][j]] = ez->bind(ids[j]);
+		}
+	}
+
+	for (int i = 1; i <= tpl->num_vars; i++)
+		if (var_map[i] == 0)
+			var_map[i] = ez->newCnfVariable();
+
+	std::vector<int> clause;
+	for (auto &tpl_clause : tpl->clauses) {
+		clause.clear();
+		for (int lit : tpl_clause)
+			clause.push_back(lit > 0 ? var_map[lit] : -var_map[-lit]);
+		ez->addCnfClause(clause);
+	}
+
+	return true;
+}
+
 bool SatGen::importCell(RTLIL::Cell *cell, int timestep)
 {
+	if (cnf_templates && importCellTemplate(cell, timestep))
+		return true;
+
 	bool arith_undef_handled = false;
 	bool is_arith_compare = cell->type.in(ID($lt), ID($le), ID($ge), ID($gt));
 
@@ -1391,7 +1528,7 @@ bool SatGen::importCell(RTLIL::Cell *cell, int timestep)
 
 namespace Yosys {
 
-void report_missing_model(bool warn_only, RTLIL::Cell* cell)
+void report_missing_model(bool warn_only, RTLIL::Cell* cell, DeferredLogs *logs)
 {
 	std::string s;
 	if (cell->is_builtin_ff())
@@ -1399,7 +1536,12 @@ void report_missing_model(bool warn_only, RTLIL::Cell* cell)
 	else
 		s = stringf("No SAT model available for cell %s (%s).\n", cell, cell->type.unescape());
 
-	if (warn_only) {
+	if (logs != nullptr) {
+		if (warn_only)
+			logs->log_warning("%s", s);
+		else
+			logs->log_error("%s", s);
+	} else if (warn_only) {
 		log_formatted_warning_noprefix(s);
 	} else {
 		log_formatted_error(s);
@@ -75,6 +75,10 @@ struct SatGen
 	bool ignore_div_by_zero;
 	bool model_undef;
 	bool def_formal = false;
+	// Import word-level cells by copying the CNF of a cached import of the
+	// same cell type, parameters and port widths, with renamed variables,
+	// instead of building ezSAT expressions for every cell.
+	bool cnf_templates = false;
 
 	SatGen(ezSAT *ez, const SigMap *sigmap, std::string prefix = std::string()) :
 			ez(ez), sigmap(sigmap), prefix(prefix), ignore_div_by_zero(false), model_undef(false)
@@ -291,9 +295,16 @@ struct SatGen
 	}
 
 	bool importCell(RTLIL::Cell *cell, int timestep = -1);
+
+private:
+	bool importCellTemplate(RTLIL::Cell *cell, int timestep);
 };
 
-void report_missing_model(bool warn_only, RTLIL::Cell* cell);
+class DeferredLogs;
+
+// Reports a cell that has no SAT model as an error, or as a warning if
+// `warn_only` is set. With `logs`, the message is deferred to these logs.
+void report_missing_model(bool warn_only, RTLIL::Cell* cell, DeferredLogs *logs = nullptr);
 
 YOSYS_NAMESPACE_END
 
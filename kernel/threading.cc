@@ -34,8 +34,10 @@ static int get_work_units_per_thread_override()
 void DeferredLogs::flush()
 {
 	for (auto &m : logs)
-		if (m.error)
+		if (m.kind == Message::Error)
 			YOSYS_NAMESPACE_PREFIX log_error("%s", m.text.c_str());
+		else if (m.kind == Message::Warning)
+			YOSYS_NAMESPACE_PREFIX log_warning("%s", m.text.c_str());
 		else
 			YOSYS_NAMESPACE_PREFIX log("%s", m.text.c_str());
 }
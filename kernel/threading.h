@@ -116,19 +116,24 @@ public:
 	template <typename... Args>
 	void log(FmtString<TypeIdentity<Args>...> fmt, Args... args)
 	{
-		logs.push_back({fmt.format(args...), false});
+		logs.push_back({fmt.format(args...), Message::Info});
+	}
+	template <typename... Args>
+	void log_warning(FmtString<TypeIdentity<Args>...> fmt, Args... args)
+	{
+		logs.push_back({fmt.format(args...), Message::Warning});
 	}
 	template <typename... Args>
 	void log_error(FmtString<TypeIdentity<Args>...> fmt, Args... args)
 	{
-		logs.push_back({fmt.format(args...), true});
+		logs.push_back({fmt.format(args...), Message::Error});
 	}
 	void flush();
 private:
 	struct Message
 	{
 		std::string text;
-		bool error;
+		enum { Info, Warning, Error } kind;
 	};
 	std::vector<Message> logs;
 };
@@ -0,0 +1,117 @@
+/*
+ *  ezSAT -- A simple and easy to use CNF generator for SAT solvers
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+#include "ezipasir.h"
+
+ezIpasirSAT::ezIpasirSAT(const ezIpasirApi &api) : api(api), ipasirSolver(NULL), terminateSet(false), foundContradiction(false)
+{
+}
+
+ezIpasirSAT::~ezIpasirSAT()
+{
+	if (ipasirSolver != NULL)
+		api.release(ipasirSolver);
+}
+
+void ezIpasirSAT::clear()
+{
+	if (ipasirSolver != NULL) {
+		api.release(ipasirSolver);
+		ipasirSolver = NULL;
+	}
+	foundContradiction = false;
+	ezSAT::clear();
+}
+
+int ezIpasirSAT::terminateCallback(void *data)
+{
+	ezIpasirSAT *that = (ezIpasirSAT*)data;
+	return that->terminateSet && std::chrono::steady_clock::now() > that->terminateTime;
+}
+
+bool ezIpasirSAT::solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions)
+{
+	preSolverCallback();
+
+	solverTimeoutStatus = false;
+	solverPropLimitStatus = false;
+	solverProps = 0;
+
+	if (foundContradiction) {
+		consumeCnf();
+		return false;
+	}
+
+	std::vector<int> extraClauses, modelIdx;
+
+	for (auto id : assumptions)
+		extraClauses.push_back(bind(id));
+	for (auto id : modelExpressions)
+		modelIdx.push_back(bind(id));
+
+	// the CNF variables of ezSAT are numbered from 1, like IPASIR literals
+	std::vector<std::vector<int>> cnf;
+	consumeCnf(cnf);
+
+	// an empty clause would be taken as the end of a clause by the solver
+	for (auto &clause : cnf)
+		if (clause.empty()) {
+			foundContradiction = true;
+			return false;
+		}
+
+	if (ipasirSolver == NULL) {
+		ipasirSolver = api.init();
+		if (api.set_terminate != NULL)
+			api.set_terminate(ipasirSolver, this, terminateCallback);
+	}
+
+	for (auto &clause : cnf) {
+		for (auto idx : clause)
+			api.add(ipasirSolver, idx);
+		api.add(ipasirSolver, 0);
+	}
+
+	for (auto idx : extraClauses)
+		api.assume(ipasirSolver, idx);
+
+	terminateSet = solverTimeout > 0;
+	if (terminateSet)
+		terminateTime = std::chrono::steady_clock::now() + std::chrono::seconds(solverTimeout);
+	int result = api.solve(ipasirSolver);
+	terminateSet = false;
+
+	if (result == 0)
+		solverTimeoutStatus = true;
+	if (result != 10)
+		return false;
+
+	modelValues.clear();
+	modelValues.resize(modelIdx.size());
+
+	for (size_t i = 0; i < modelIdx.size(); i++) {
+		int idx = modelIdx[i];
+		int32_t value = api.val(ipasirSolver, idx < 0 ? -idx : idx);
+		modelValues[i] = idx < 0 ? value < 0 : value > 0;
+	}
+
+	return true;
+}
+
@@ -0,0 +1,65 @@
+/*
+ *  ezSAT -- A simple and easy to use CNF generator for SAT solvers
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+#ifndef EZIPASIR_H
+#define EZIPASIR_H
+
+#include "ezsat.h"
+#include <stdint.h>
+#include <chrono>
+
+// Entry points of a solver implementing the IPASIR incremental SAT solver
+// interface (ipasir.h of the SAT Race 2015), for example CaDiCaL or Kissat.
+// The table is filled by the application, usually with dlsym().
+struct ezIpasirApi
+{
+	const char *(*signature)();
+	void *(*init)();
+	void (*release)(void *solver);
+	void (*add)(void *solver, int32_t lit_or_zero);
+	void (*assume)(void *solver, int32_t lit);
+	int (*solve)(void *solver);
+	int32_t (*val)(void *solver, int32_t lit);
+	void (*set_terminate)(void *solver, void *data, int (*terminate)(void *data));
+};
+
+// IPASIR solvers do not eliminate variables that are used in later calls, so
+// freeze() is not needed. The propagation limit is not supported by the
+// interface and ignored, the timeout is implemented with set_terminate and
+// measured in wall clock time.
+class ezIpasirSAT : public ezSAT
+{
+private:
+	const ezIpasirApi &api;
+	void *ipasirSolver;
+	bool terminateSet;
+	std::chrono::steady_clock::time_point terminateTime;
+	bool foundContradiction;
+
+	static int terminateCallback(void *data);
+
+public:
+	ezIpasirSAT(const ezIpasirApi &api);
+	virtual ~ezIpasirSAT();
+	virtual void clear();
+	virtual bool solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions);
+};
+
+#endif
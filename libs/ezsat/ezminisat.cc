@@ -45,6 +45,13 @@ ezMiniSAT::ezMiniSAT() : minisatSolver(NULL)
 	minisatSolver = NULL;
 	foundContradiction = false;
 
+	randomSeed = 0;
+	randomVarFreq = 0;
+	lubyRestart = true;
+	restartFirst = 100;
+	simplification = true;
+	solverInterrupted = false;
+
 	freeze(CONST_TRUE);
 	freeze(CONST_FALSE);
 }
@@ -85,6 +92,38 @@ bool ezMiniSAT::eliminated(int idx)
 }
 #endif
 
+void ezMiniSAT::initSolver()
+{
+	if (minisatSolver != NULL)
+		return;
+
+	minisatSolver = new Solver;
+	minisatSolver->verbosity = EZMINISAT_VERBOSITY;
+	minisatSolver->random_var_freq = randomVarFreq;
+	minisatSolver->luby_restart = lubyRestart;
+	minisatSolver->restart_first = restartFirst;
+	if (randomSeed != 0) {
+		minisatSolver->random_seed = randomSeed;
+		minisatSolver->rnd_init_act = true;
+	}
+#if EZMINISAT_SIMPSOLVER
+	if (!simplification)
+		minisatSolver->eliminate(true);
+#endif
+}
+
+void ezMiniSAT::interrupt()
+{
+	if (minisatSolver != NULL)
+		minisatSolver->interrupt();
+}
+
+void ezMiniSAT::clearInterrupt()
+{
+	if (minisatSolver != NULL)
+		minisatSolver->clearInterrupt();
+}
+
 #if defined(HAS_ALARM)
 ezMiniSAT *ezMiniSAT::alarmHandlerThis = NULL;
 clock_t ezMiniSAT::alarmHandlerTimeout = 0;
@@ -103,20 +142,11 @@ bool ezMiniSAT::solver(const std::vector<int> &modelExpressions, std::vector<boo
 {
 	preSolverCallback();
 
-	solverTimeoutStatus = false;
-	solverPropLimitStatus = false;
-	solverProps = 0;
-
-	if (0) {
-contradiction:
-		delete minisatSolver;
-		minisatSolver = NULL;
-		minisatVars.clear();
-		foundContradiction = true;
-		return false;
-	}
-
 	if (foundContradiction) {
+		solverTimeoutStatus = false;
+		solverPropLimitStatus = false;
+		solverInterrupted = false;
+		solverProps = 0;
 		consumeCnf();
 		return false;
 	}
@@ -128,11 +158,6 @@ contradiction:
 	for (auto id : modelExpressions)
 		modelIdx.push_back(bind(id));
 
-	if (minisatSolver == NULL) {
-		minisatSolver = new Solver;
-		minisatSolver->verbosity = EZMINISAT_VERBOSITY;
-	}
-
 #if EZMINISAT_INCREMENTAL
 	std::vector<std::vector<int>> cnf;
 	consumeCnf(cnf);
@@ -140,14 +165,43 @@ contradiction:
 	const std::vector<std::vector<int>> &cnf = this->cnf();
 #endif
 
-	while (int(minisatVars.size()) < numCnfVariables())
+#if EZMINISAT_SIMPSOLVER && EZMINISAT_INCREMENTAL
+	return solveCnf(cnf, numCnfVariables(), cnfFrozenVars, extraClauses, modelIdx, modelValues);
+#else
+	std::set<int> frozenVars;
+	return solveCnf(cnf, numCnfVariables(), frozenVars, extraClauses, modelIdx, modelValues);
+#endif
+}
+
+bool ezMiniSAT::solveCnf(const std::vector<std::vector<int>> &cnf, int numVariables, std::set<int> &frozenVars,
+		const std::vector<int> &extraClauses, const std::vector<int> &modelIdx, std::vector<bool> &modelValues)
+{
+	solverTimeoutStatus = false;
+	solverPropLimitStatus = false;
+	solverInterrupted = false;
+	solverProps = 0;
+
+	if (0) {
+contradiction:
+		// the solver is only freed by clear(), so that interrupt() can be
+		// called from other threads at any time during solveCnf()
+		foundContradiction = true;
+		return false;
+	}
+
+	if (foundContradiction)
+		return false;
+
+	initSolver();
+
+	while (int(minisatVars.size()) < numVariables)
 		minisatVars.push_back(minisatSolver->newVar());
 
 #if EZMINISAT_SIMPSOLVER && EZMINISAT_INCREMENTAL
-	for (auto idx : cnfFrozenVars)
+	for (auto idx : frozenVars)
 		minisatSolver->setFrozen(minisatVars.at(idx > 0 ? idx-1 : -idx-1), true);
-	cnfFrozenVars.clear();
 #endif
+	frozenVars.clear();
 
 	for (auto &clause : cnf) {
 		Minisat::vec<Minisat::Lit> ps;
@@ -210,11 +264,15 @@ contradiction:
 		minisatSolver->setPropBudget(solverPropLimit);
 		Minisat::lbool res = minisatSolver->solveLimited(assumps);
 		minisatSolver->budgetOff();
-		if (Minisat::toInt(res) == 2) // l_Undef: propagation budget exhausted
+		if (Minisat::toInt(res) == 2) // l_Undef: propagation budget exhausted or interrupted
 			solverPropLimitStatus = true;
 		foundSolution = (Minisat::toInt(res) == 0); // l_True
 	} else {
-		foundSolution = minisatSolver->solve(assumps);
+		minisatSolver->budgetOff();
+		Minisat::lbool res = minisatSolver->solveLimited(assumps);
+		if (Minisat::toInt(res) == 2) // l_Undef: interrupted
+			solverInterrupted = true;
+		foundSolution = (Minisat::toInt(res) == 0); // l_True
 	}
 
 	solverProps = minisatSolver->propagations - solverPropsBefore;
@@ -58,6 +58,16 @@ private:
 #endif
 
 public:
+	// solver configuration, used when the MiniSat solver is created
+	double randomSeed;        // 0 keeps the MiniSat default and activities
+	double randomVarFreq;
+	bool lubyRestart;
+	int restartFirst;
+	bool simplification;      // SimpSolver preprocessing
+
+	// set if the last solve was stopped by interrupt()
+	bool solverInterrupted;
+
 	ezMiniSAT();
 	virtual ~ezMiniSAT();
 	virtual void clear();
@@ -66,6 +76,19 @@ public:
 	virtual bool eliminated(int idx);
 #endif
 	virtual bool solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions);
+
+	// Solves CNF generated by another ezSAT instance, with CNF variables and
+	// literals numbered by that instance. The clauses are added to the ones
+	// of earlier calls. This lets differently configured solvers work on the
+	// same problem, stopping each other with interrupt().
+	bool solveCnf(const std::vector<std::vector<int>> &cnf, int numVariables, std::set<int> &frozenVars,
+			const std::vector<int> &assumptions, const std::vector<int> &modelIdx, std::vector<bool> &modelValues);
+
+	// creates the MiniSat solver, so that interrupt() can be called from
+	// another thread while solving
+	void initSolver();
+	void interrupt();
+	void clearInterrupt();
 };
 
 #endif
@@ -183,6 +183,11 @@ public:
 	int bind(int id, bool auto_freeze = true);
 	int bound(int id) const;
 
+	// add CNF variables and clauses directly, e.g. to replay previously
+	// generated CNF with renamed variables
+	int newCnfVariable() { return ++cnfVariableCount; }
+	void addCnfClause(const std::vector<int> &clause) { add_clause(clause); }
+
 	int numCnfVariables() const { return cnfVariableCount; }
 	int numCnfClauses() const { return cnfClausesCount; }
 	const std::vector<std::vector<int>> &cnf() const { return cnfClauses; }
@@ -33,6 +33,16 @@
 #  define my_printf printf
 #endif
 
+#if !defined(_YOSYS_) || defined(YOSYS_ENABLE_THREADS)
+#  define SUBCIRCUIT_THREADS
+#  include <atomic>
+#  ifdef _YOSYS_
+#    include "kernel/threading.h"
+#  else
+#    include <thread>
+#  endif
+#endif
+
 using namespace SubCircuit;
 
 #ifndef _YOSYS_
@@ -295,9 +305,19 @@ class SubCircuit::SolverWorker
 		std::string graphId;
 		Graph graph;
 		adjMatrix_t adjMatrix;
+		std::vector<int> edgeTypes;
 		std::vector<bool> usedNodes;
 	};
 
+	static void findEdgeTypes(GraphData &gd)
+	{
+		std::set<int> edgeTypes;
+		for (const auto &row : gd.adjMatrix)
+			for (const auto &it : row)
+				edgeTypes.insert(it.second);
+		gd.edgeTypes.assign(edgeTypes.begin(), edgeTypes.end());
+	}
+
 	static void printAdjMatrix(const adjMatrix_t &matrix)
 	{
 		my_printf("%7s", "");
@@ -717,6 +737,8 @@ class SubCircuit::SolverWorker
 	std::map<std::string, std::set<std::set<std::string>>> swapPorts;
 	std::map<std::string, std::set<std::map<std::string, std::string>>> swapPermutations;
 	DiCache diCache;
+	std::vector<std::vector<bool>> edgeCompatible, edgeCompatibleKnown;
+	int threads;
 	bool verbose;
 
 	// main solver functions
@@ -881,26 +903,64 @@ class SubCircuit::SolverWorker
 		}
 	}
 
-	bool checkEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, int i, int j, const GraphData &needle, const GraphData &haystack)
+	void prepareEdgeCompatibility(const GraphData &needle, const GraphData &haystack)
+	{
+		// dense lookup table for the edge types of needle and haystack, so that
+		// checkEnumerationMatrix() does not need to touch the compare cache
+
+		edgeCompatible.resize(diCache.edgeTypes.size());
+		edgeCompatibleKnown.resize(diCache.edgeTypes.size());
+
+		for (int needleEdgeType : needle.edgeTypes)
+		{
+			std::vector<bool> &compatible = edgeCompatible[needleEdgeType];
+			std::vector<bool> &known = edgeCompatibleKnown[needleEdgeType];
+			compatible.resize(diCache.edgeTypes.size());
+			known.resize(diCache.edgeTypes.size());
+
+			for (int haystackEdgeType : haystack.edgeTypes)
+				if (!known[haystackEdgeType]) {
+					compatible[haystackEdgeType] = diCache.compare(needleEdgeType, haystackEdgeType, swapPorts, swapPermutations);
+					known[haystackEdgeType] = true;
+				}
+		}
+	}
+
+	bool checkEdge(const GraphData &needle, int i, int needleNeighbour, int needleEdgeType, const GraphData &haystack, int j, int haystackNeighbour, int haystackEdgeType) const
+	{
+		if (!edgeCompatible[needleEdgeType][haystackEdgeType])
+			return false;
+
+		const Graph::Node &needleFromNode = needle.graph.nodes[i];
+		const Graph::Node &needleToNode = needle.graph.nodes[needleNeighbour];
+		const Graph::Node &haystackFromNode = haystack.graph.nodes[j];
+		const Graph::Node &haystackToNode = haystack.graph.nodes[haystackNeighbour];
+		return userSolver->userCompareEdge(needle.graphId, needleFromNode.nodeId,  needleFromNode.userData, needleToNode.nodeId,  needleToNode.userData,
+				haystack.graphId, haystackFromNode.nodeId, haystackFromNode.userData, haystackToNode.nodeId, haystackToNode.userData);
+	}
+
+	bool checkEnumerationMatrix(const std::vector<std::set<int>> &enumerationMatrix, int i, int j, const GraphData &needle, const GraphData &haystack) const
 	{
+		const std::map<int, int> &haystackEdges = haystack.adjMatrix.at(j);
+
 		for (const auto &it_needle : needle.adjMatrix.at(i))
 		{
 			int needleNeighbour = it_needle.first;
 			int needleEdgeType = it_needle.second;
-
-			for (int haystackNeighbour : enumerationMatrix[needleNeighbour])
-				if (haystack.adjMatrix.at(j).count(haystackNeighbour) > 0) {
-					int haystackEdgeType = haystack.adjMatrix.at(j).at(haystackNeighbour);
-					if (diCache.compare(needleEdgeType, haystackEdgeType, swapPorts, swapPermutations)) {
-						const Graph::Node &needleFromNode = needle.graph.nodes[i];
-						const Graph::Node &needleToNode = needle.graph.nodes[needleNeighbour];
-						const Graph::Node &haystackFromNode = haystack.graph.nodes[j];
-						const Graph::Node &haystackToNode = haystack.graph.nodes[haystackNeighbour];
-						if (userSolver->userCompareEdge(needle.graphId, needleFromNode.nodeId,  needleFromNode.userData, needleToNode.nodeId,  needleToNode.userData,
-								haystack.graphId, haystackFromNode.nodeId, haystackFromNode.userData, haystackToNode.nodeId, haystackToNode.userData))
-							goto found_match;
-					}
+			const std::set<int> &candidates = enumerationMatrix[needleNeighbour];
+
+			// walk whichever of the two neighbour sets is smaller
+			if (haystackEdges.size() < candidates.size()) {
+				for (const auto &it_haystack : haystackEdges)
+					if (candidates.count(it_haystack.first) > 0 && checkEdge(needle, i, needleNeighbour, needleEdgeType, haystack, j, it_haystack.first, it_haystack.second))
+						goto found_match;
+			} else {
+				for (int haystackNeighbour : candidates) {
+					auto it_haystack = haystackEdges.find(haystackNeighbour);
+					if (it_haystack != haystackEdges.end() && checkEdge(needle, i, needleNeighbour, needleEdgeType, haystack, j, haystackNeighbour, it_haystack->second))
+						goto found_match;
 				}
+			}
 
 			return false;
 		found_match:;
@@ -909,7 +969,7 @@ class SubCircuit::SolverWorker
 		return true;
 	}
 
-	bool pruneEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, int &nextRow, bool allowOverlap)
+	bool pruneEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, const std::vector<bool> &haystackUsedNodes, int &nextRow, bool allowOverlap)
 	{
 		bool didSomething = true;
 
@@ -925,7 +985,7 @@ class SubCircuit::SolverWorker
 				for (int j : enumerationMatrix[i]) {
 					if (!checkEnumerationMatrix(enumerationMatrix, i, j, needle, haystack))
 						didSomething = true;
-					else if (!allowOverlap && haystack.usedNodes[j])
+					else if (!allowOverlap && haystackUsedNodes[j])
 						didSomething = true;
 					else {
 						newRow.insert(j);
@@ -1117,10 +1177,11 @@ class SubCircuit::SolverWorker
 		return false;
 	}
 
-	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack, bool allowOverlap, int limitResults)
+	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, const GraphData &haystack,
+			std::vector<bool> &haystackUsedNodes, bool allowOverlap, int limitResults)
 	{
 		int i = -1;
-		if (!pruneEnumerationMatrix(enumerationMatrix, needle, haystack, i, allowOverlap))
+		if (!pruneEnumerationMatrix(enumerationMatrix, needle, haystack, haystackUsedNodes, i, allowOverlap))
 			return;
 
 		if (i < 0)
@@ -1180,7 +1241,7 @@ class SubCircuit::SolverWorker
 
 			for (int j = 0; j < int(enumerationMatrix.size()); j++)
 				if (!haystack.graph.nodes[*enumerationMatrix[j].begin()].shared)
-					haystack.usedNodes[*enumerationMatrix[j].begin()] = true;
+					haystackUsedNodes[*enumerationMatrix[j].begin()] = true;
 
 			if (verbose) {
 				my_printf("\nSolution:\n");
@@ -1200,6 +1261,13 @@ class SubCircuit::SolverWorker
 		std::set<int> activeRow;
 		enumerationMatrix[i].swap(activeRow);
 
+#ifdef SUBCIRCUIT_THREADS
+		if (iter == 0 && threads > 1 && !verbose && activeRow.size() > 1) {
+			ullmannBranchesParallel(results, enumerationMatrix, i, activeRow, needle, haystack, haystackUsedNodes, allowOverlap, limitResults);
+			return;
+		}
+#endif
+
 		for (int j : activeRow)
 		{
 			// found enough?
@@ -1207,23 +1275,101 @@ class SubCircuit::SolverWorker
 				return;
 
 			// already used by other solution -> try next
-			if (!allowOverlap && haystack.usedNodes[j])
+			if (!allowOverlap && haystackUsedNodes[j])
 				continue;
 
-			// create enumeration matrix for child in recursion tree
-			std::vector<std::set<int>> nextEnumerationMatrix = enumerationMatrix;
-			for (int k = 0; k < int(nextEnumerationMatrix.size()); k++)
-				nextEnumerationMatrix[k].erase(j);
-			nextEnumerationMatrix[i].insert(j);
-
-			// recursion
-			ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, allowOverlap, limitResults);
+			ullmannBranch(results, enumerationMatrix, iter, i, j, needle, haystack, haystackUsedNodes, allowOverlap, limitResults);
 
 			// we just have found something -> unroll to top recursion level
-			if (!allowOverlap && haystack.usedNodes[j] && iter > 0)
+			if (!allowOverlap && haystackUsedNodes[j] && iter > 0)
+				return;
+		}
+	}
+
+	void ullmannBranch(std::vector<Solver::Result> &results, const std::vector<std::set<int>> &enumerationMatrix, int iter, int i, int j, const GraphData &needle, const GraphData &haystack,
+			std::vector<bool> &haystackUsedNodes, bool allowOverlap, int limitResults)
+	{
+		// create enumeration matrix for child in recursion tree
+		std::vector<std::set<int>> nextEnumerationMatrix = enumerationMatrix;
+		for (int k = 0; k < int(nextEnumerationMatrix.size()); k++)
+			nextEnumerationMatrix[k].erase(j);
+		nextEnumerationMatrix[i].insert(j);
+
+		// recursion
+		ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, haystackUsedNodes, allowOverlap, limitResults);
+	}
+
+#ifdef SUBCIRCUIT_THREADS
+	void ullmannBranchesParallel(std::vector<Solver::Result> &results, const std::vector<std::set<int>> &enumerationMatrix, int i, const std::set<int> &activeRow,
+			const GraphData &needle, const GraphData &haystack, std::vector<bool> &haystackUsedNodes, bool allowOverlap, int limitResults)
+	{
+		// Search the branches of the top recursion level on worker threads, each one
+		// with a private copy of the overlap state, and merge the results in the order
+		// of the serial loop in ullmannRecursion(). A branch that found nothing would
+		// not find anything with more haystack nodes in use either. In non-overlapping
+		// mode a branch that found a solution is searched again on this thread once an
+		// earlier branch has claimed new haystack nodes.
+
+		std::vector<int> branches(activeRow.begin(), activeRow.end());
+		std::vector<std::vector<Solver::Result>> branchResults(branches.size());
+		int branchLimit = limitResults >= 0 ? limitResults - int(results.size()) : -1;
+
+		std::atomic<int> nextBranch(0);
+		auto searchBranches = [&]() {
+			for (int b = nextBranch++; b < int(branches.size()); b = nextBranch++) {
+				if (!allowOverlap && haystackUsedNodes[branches[b]])
+					continue;
+				std::vector<bool> branchUsedNodes = haystackUsedNodes;
+				ullmannBranch(branchResults[b], enumerationMatrix, 0, i, branches[b], needle, haystack, branchUsedNodes, allowOverlap, branchLimit);
+			}
+		};
+
+#ifdef _YOSYS_
+		// the yosys thread pool marks RTLIL as accessed by several threads,
+		// so that the compare callbacks can not create IdStrings unnoticed
+		{
+			YOSYS_NAMESPACE_PREFIX ParallelDispatchThreadPool pool(std::min(threads, int(branches.size())));
+			pool.run([&](const YOSYS_NAMESPACE_PREFIX ParallelDispatchThreadPool::RunCtx &) { searchBranches(); });
+		}
+#else
+		std::vector<std::thread> workers;
+		for (int k = 1; k < std::min(threads, int(branches.size())); k++)
+			workers.emplace_back(searchBranches);
+		searchBranches();
+		for (auto &worker : workers)
+			worker.join();
+#endif
+
+		bool usedNodesChanged = false;
+		for (int b = 0; b < int(branches.size()); b++)
+		{
+			if (limitResults >= 0 && int(results.size()) >= limitResults)
 				return;
+
+			if (!allowOverlap && haystackUsedNodes[branches[b]])
+				continue;
+
+			if (branchResults[b].empty())
+				continue;
+
+			if (!allowOverlap && usedNodesChanged) {
+				ullmannBranch(results, enumerationMatrix, 0, i, branches[b], needle, haystack, haystackUsedNodes, allowOverlap, limitResults);
+				continue;
+			}
+
+			for (auto &result : branchResults[b]) {
+				if (limitResults >= 0 && int(results.size()) >= limitResults)
+					return;
+				for (const auto &it : result.mappings) {
+					int j = haystack.graph.nodeMap.at(it.second.haystackNodeId);
+					if (!haystack.graph.nodes[j].shared && !haystackUsedNodes[j])
+						haystackUsedNodes[j] = true, usedNodesChanged = true;
+				}
+				results.push_back(std::move(result));
+			}
 		}
 	}
+#endif
 
 	// additional data structes and functions for mining
 
@@ -1285,9 +1431,10 @@ class SubCircuit::SolverWorker
 			std::vector<std::set<int>> enumerationMatrix;
 			std::map<std::string, std::set<std::string>> initialMappings;
 			generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
+			prepareEdgeCompatibility(needle, haystack);
 
 			haystack.usedNodes.resize(haystack.graph.nodes.size());
-			ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, true, -1);
+			ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, haystack.usedNodes, true, -1);
 		}
 
 		verbose = backupVerbose;
@@ -1305,6 +1452,7 @@ class SubCircuit::SolverWorker
 		needle.graph = Graph(graph, needle_nodes);
 		needle.graph.markAllExtern();
 		diCache.add(needle.graph, needle.adjMatrix, graphId, userSolver);
+		findEdgeTypes(needle);
 
 		std::vector<Solver::Result> ullmannResults;
 		solveForMining(ullmannResults, needle);
@@ -1484,7 +1632,7 @@ class SubCircuit::SolverWorker
 	// interface to the public solver class
 
 protected:
-	SolverWorker(Solver *userSolver) : userSolver(userSolver), verbose(false)
+	SolverWorker(Solver *userSolver) : userSolver(userSolver), threads(1), verbose(false)
 	{
 	}
 
@@ -1493,6 +1641,11 @@ protected:
 		verbose = true;
 	}
 
+	void setThreads(int threads)
+	{
+		this->threads = std::max(threads, 1);
+	}
+
 	void addGraph(std::string graphId, const Graph &graph)
 	{
 		assert(graphData.count(graphId) == 0);
@@ -1501,6 +1654,7 @@ protected:
 		gd.graphId = graphId;
 		gd.graph = graph;
 		diCache.add(gd.graph, gd.adjMatrix, graphId, userSolver);
+		findEdgeTypes(gd);
 	}
 
 	void addCompatibleTypes(std::string needleTypeId, std::string haystackTypeId)
@@ -1516,13 +1670,13 @@ protected:
 	void addSwappablePorts(std::string needleTypeId, const std::set<std::string> &ports)
 	{
 		swapPorts[needleTypeId].insert(ports);
-		diCache.compareCache.clear();
+		clearCompareCache();
 	}
 
 	void addSwappablePortsPermutation(std::string needleTypeId, const std::map<std::string, std::string> &portMapping)
 	{
 		swapPermutations[needleTypeId].insert(portMapping);
-		diCache.compareCache.clear();
+		clearCompareCache();
 	}
 
 	void solve(std::vector<Solver::Result> &results, std::string needleGraphId, std::string haystackGraphId,
@@ -1566,8 +1720,10 @@ protected:
 			printEnumerationMatrix(enumerationMatrix, haystack.graph.nodes.size());
 		}
 
+		prepareEdgeCompatibility(needle, haystack);
+
 		haystack.usedNodes.resize(haystack.graph.nodes.size());
-		ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, allowOverlap, maxSolutions > 0 ? results.size() + maxSolutions : -1);
+		ullmannRecursion(results, enumerationMatrix, 0, needle, haystack, haystack.usedNodes, allowOverlap, maxSolutions > 0 ? results.size() + maxSolutions : -1);
 	}
 
 	void mine(std::vector<Solver::MineResult> &results, int minNodes, int maxNodes, int minMatches, int limitMatchesPerGraph)
@@ -1601,7 +1757,14 @@ protected:
 		compatibleConstants.clear();
 		swapPorts.clear();
 		swapPermutations.clear();
+		clearCompareCache();
+	}
+
+	void clearCompareCache()
+	{
 		diCache.compareCache.clear();
+		edgeCompatible.clear();
+		edgeCompatibleKnown.clear();
 	}
 
 	friend class Solver;
@@ -1642,6 +1805,11 @@ void SubCircuit::Solver::setVerbose()
 	worker->setVerbose();
 }
 
+void SubCircuit::Solver::setThreads(int threads)
+{
+	worker->setThreads(threads);
+}
+
 void SubCircuit::Solver::addGraph(std::string graphId, const Graph &graph)
 {
 	worker->addGraph(graphId, graph);
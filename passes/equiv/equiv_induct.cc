@@ -18,6 +18,8 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/threading.h"
+#include "kernel/topo_scc.h"
 #include "passes/equiv/equiv.h"
 
 USING_YOSYS_NAMESPACE
@@ -25,7 +27,8 @@ PRIVATE_NAMESPACE_BEGIN
 
 struct EquivInductWorker : public EquivWorker<>
 {
-	SigMap sigmap;
+	const SigMap &sigmap;
+	std::string title;
 
 	vector<Cell*> cells;
 	pool<Cell*> workset;
@@ -35,9 +38,25 @@ struct EquivInductWorker : public EquivWorker<>
 	dict<int, int> ez_step_is_consistent;
 	SigPool undriven_signals;
 
-	EquivInductWorker(Module *module, const pool<Cell*> &unproven_equiv_cells, EquivBasicConfig cfg) : EquivWorker<>(module, &sigmap, cfg), sigmap(module),
-			cells(module->selected_cells()), workset(unproven_equiv_cells),
-			success_counter(0) {}
+	// When running on a worker thread, messages are collected in `logs`.
+	// Proven cells are collected in `proven_cells` and only shorted by the
+	// caller after the proof, so that the module is never modified here.
+	DeferredLogs *logs = nullptr;
+	vector<Cell*> proven_cells;
+
+	EquivInductWorker(Module *module, const SigMap &sigmap, const std::string &title, const vector<Cell*> &cells,
+			const pool<Cell*> &unproven_equiv_cells, EquivBasicConfig cfg, DeferredLogs *logs = nullptr) :
+			EquivWorker<>(module, &sigmap, cfg), sigmap(sigmap), title(title), cells(cells), workset(unproven_equiv_cells),
+			success_counter(0), logs(logs) {}
+
+	template <typename... Args>
+	void log(FmtString<TypeIdentity<Args>...> fmt, const Args &... args) const
+	{
+		if (logs)
+			logs->log(fmt, args...);
+		else
+			YOSYS_NAMESPACE_PREFIX log(fmt, args...);
+	}
 
 	void create_timestep(int step)
 	{
@@ -45,7 +64,7 @@ struct EquivInductWorker : public EquivWorker<>
 
 		for (auto cell : cells) {
 			if (!satgen.importCell(cell, step)) {
-				report_missing_model(cfg.ignore_unknown_cells, cell);
+				report_missing_model(cfg.ignore_unknown_cells, cell, logs);
 			}
 			if (cell->type == ID($equiv)) {
 				SigBit bit_a = sigmap(cell->getPort(ID::A)).as_bit();
@@ -84,7 +103,7 @@ struct EquivInductWorker : public EquivWorker<>
 
 	void run()
 	{
-		log("Found %d unproven $equiv cells in module %s:\n", GetSize(workset), module);
+		log("Found %d unproven $equiv cells in %s:\n", GetSize(workset), title);
 
 		if (satgen.model_undef) {
 			for (auto cell : cells)
@@ -108,6 +127,25 @@ struct EquivInductWorker : public EquivWorker<>
 				GetSize(satgen.initial_state), GetSize(undriven_signals));
 		}
 
+		// A model of the failed induction step or of a failed individual proof
+		// satisfies the problem all individual proofs are checked against. Cells
+		// that already differ in such a model are failed without another call
+		// to the SAT solver.
+		dict<Cell*, int> cell_cond;
+		pool<Cell*> refuted;
+		std::vector<int> model_expressions;
+		std::vector<Cell*> model_cells;
+
+		auto solve_and_refute = [&](int assumption) {
+			std::vector<bool> model_values;
+			if (!ez->solve(model_expressions, model_values, assumption))
+				return false;
+			for (int i = 0; i < GetSize(model_cells); i++)
+				if (model_values[i])
+					refuted.insert(model_cells[i]);
+			return true;
+		};
+
 		for (int step = 1; step <= cfg.max_seq; step++)
 		{
 			ez->assume(ez_step_is_consistent[step]);
@@ -122,11 +160,30 @@ struct EquivInductWorker : public EquivWorker<>
 			int new_step_not_consistent = ez->NOT(ez_step_is_consistent[step+1]);
 			ez->bind(new_step_not_consistent);
 
+			if (step == cfg.max_seq) {
+				workset.sort();
+				for (auto cell : workset) {
+					SigBit bit_a = sigmap(cell->getPort(ID::A)).as_bit();
+					SigBit bit_b = sigmap(cell->getPort(ID::B)).as_bit();
+
+					int ez_a = satgen.importSigBit(bit_a, cfg.max_seq+1);
+					int ez_b = satgen.importSigBit(bit_b, cfg.max_seq+1);
+					int cond = ez->XOR(ez_a, ez_b);
+
+					if (satgen.model_undef)
+						cond = ez->AND(cond, ez->NOT(satgen.importUndefSigBit(bit_a, cfg.max_seq+1)));
+
+					cell_cond[cell] = cond;
+					model_expressions.push_back(cond);
+					model_cells.push_back(cell);
+				}
+			}
+
 			log("  Proving induction step %d. (%d clauses over %d variables)\n", step, ez->numCnfClauses(), ez->numCnfVariables());
-			if (!ez->solve(new_step_not_consistent)) {
+			if (!solve_and_refute(new_step_not_consistent)) {
 				log("  Proof for induction step holds. Entire workset of %d cells proven!\n", GetSize(workset));
 				for (auto cell : workset)
-					cell->setPort(ID::B, cell->getPort(ID::A));
+					proven_cells.push_back(cell);
 				success_counter += GetSize(workset);
 				return;
 			}
@@ -134,33 +191,142 @@ struct EquivInductWorker : public EquivWorker<>
 			log("  Proof for induction step failed. %s\n", step != cfg.max_seq ? "Extending to next time step." : "Trying to prove individual $equiv from workset.");
 		}
 
-		workset.sort();
+		int reused_counter = 0;
 
 		for (auto cell : workset)
 		{
-			SigBit bit_a = sigmap(cell->getPort(ID::A)).as_bit();
-			SigBit bit_b = sigmap(cell->getPort(ID::B)).as_bit();
-
 			log("  Trying to prove $equiv for %s:", log_signal(sigmap(cell->getPort(ID::Y))));
 
-			int ez_a = satgen.importSigBit(bit_a, cfg.max_seq+1);
-			int ez_b = satgen.importSigBit(bit_b, cfg.max_seq+1);
-			int cond = ez->XOR(ez_a, ez_b);
-
-			if (satgen.model_undef)
-				cond = ez->AND(cond, ez->NOT(satgen.importUndefSigBit(bit_a, cfg.max_seq+1)));
+			if (refuted.count(cell)) {
+				log(" failed (counterexample of an earlier proof).\n");
+				reused_counter++;
+				continue;
+			}
 
-			if (!ez->solve(cond)) {
+			if (!solve_and_refute(cell_cond.at(cell))) {
 				log(" success!\n");
-				cell->setPort(ID::B, cell->getPort(ID::A));
+				proven_cells.push_back(cell);
 				success_counter++;
 			} else {
 				log(" failed.\n");
 			}
 		}
+
+		if (reused_counter > 0)
+			log("  Reused counterexamples to fail %d $equiv cells without SAT calls.\n", reused_counter);
 	}
 };
 
+struct EquivInductPartition
+{
+	vector<Cell*> cells;
+	pool<Cell*> equiv_cells;
+};
+
+// Splits the induction problem of a module into partitions that share no
+// cells. Each cell in the sequential input cone of an unproven $equiv cell
+// (or, with -set-assumes, of an $assume cell) is connected to the cells
+// driving its inputs and to the other cells reading the same undriven bits,
+// and the partitions are the SCCs of this undirected graph. As the partitions
+// share no SAT variables, proving them separately is equivalent to proving
+// the whole module at once. Clock inputs of flip-flops are not connected, as
+// they are not part of the SAT model. Cells outside of all cones are not part
+// of any partition.
+vector<EquivInductPartition> partition_cells(const SigMap &sigmap, const vector<Cell*> &cells, const pool<Cell*> &unproven_equiv_cells, bool set_assumes)
+{
+	dict<SigBit, Cell*> bit2driver;
+	for (auto cell : cells)
+		if (yosys_celltypes.cell_known(cell->type))
+			for (auto &conn : cell->connections())
+				if (yosys_celltypes.cell_output(cell->type, conn.first))
+					for (auto bit : sigmap(conn.second))
+						bit2driver[bit] = cell;
+	// cells without a known model are pulled into the cones they are
+	// connected to, so that they are reported like in a proof of the whole module
+	for (auto cell : cells)
+		if (!yosys_celltypes.cell_known(cell->type))
+			for (auto &conn : cell->connections())
+				for (auto bit : sigmap(conn.second))
+					if (bit.wire != nullptr && !bit2driver.count(bit))
+						bit2driver[bit] = cell;
+
+	idict<Cell*> cone_cells;
+	IntGraph graph;
+	int first_assume = -1;
+
+	for (auto cell : cells) {
+		bool is_assume = set_assumes && cell->type == ID($assume);
+		if (!is_assume && !unproven_equiv_cells.count(cell))
+			continue;
+		int node = cone_cells(cell);
+		graph.add_edge(node, node);
+		// all assumptions are imported together, so they share a partition
+		if (is_assume) {
+			if (first_assume < 0)
+				first_assume = node;
+			graph.add_edge(first_assume, node);
+			graph.add_edge(node, first_assume);
+		}
+	}
+
+	// first cell of the cones reading each undriven bit
+	dict<SigBit, int> undriven_reader;
+
+	for (int node = 0; node < GetSize(cone_cells); node++) {
+		Cell *cell = cone_cells[node];
+		bool known = yosys_celltypes.cell_known(cell->type);
+		for (auto &conn : cell->connections()) {
+			if (known && !yosys_celltypes.cell_input(cell->type, conn.first))
+				continue;
+			if (cell->is_builtin_ff() && conn.first.in(ID::CLK, ID::C))
+				continue;
+			for (auto bit : sigmap(conn.second)) {
+				int other;
+				auto it = bit2driver.find(bit);
+				if (it != bit2driver.end())
+					other = cone_cells(it->second);
+				else if (bit.wire != nullptr)
+					other = undriven_reader.emplace(bit, node).first->second;
+				else
+					continue;
+				graph.add_edge(node, other);
+				graph.add_edge(other, node);
+			}
+		}
+	}
+
+	vector<int> component_of(GetSize(cone_cells));
+	int num_components = 0;
+	TopoSortedSccs(graph, [&](int *begin, int *end) {
+		for (int *it = begin; it != end; ++it)
+			component_of[*it] = num_components;
+		num_components++;
+	}).process_all();
+
+	// partitions are ordered by their first cell in the module
+	vector<EquivInductPartition> partitions;
+	dict<int, int> partition_index;
+	for (auto cell : cells) {
+		int node = cone_cells.at(cell, -1);
+		if (node < 0)
+			continue;
+		auto it = partition_index.emplace(component_of[node], GetSize(partitions));
+		if (it.second)
+			partitions.emplace_back();
+		EquivInductPartition &partition = partitions[it.first->second];
+		partition.cells.push_back(cell);
+		if (unproven_equiv_cells.count(cell))
+			partition.equiv_cells.insert(cell);
+	}
+
+	// a partition of only $assume cells proves nothing
+	partitions.erase(std::remove_if(partitions.begin(), partitions.end(), [](const EquivInductPartition &partition) {
+		return partition.equiv_cells.empty();
+	}), partitions.end());
+
+	return partitions;
+}
+
 struct EquivInductPass : public Pass {
 	EquivInductPass() : Pass("equiv_induct", "proving $equiv cells using temporal induction") { }
 	void help() override
@@ -175,6 +341,14 @@ struct EquivInductPass : public Pass {
 		log("perform the proof.\n");
 		log("\n");
 		log("%s", EquivBasicConfig::help("4"));
+		log("    -partition\n");
+		log("        split each module into partitions of $equiv cells with overlapping\n");
+		log("        sequential input cones and prove each partition separately. only the\n");
+		log("        cells in these cones are imported into the SAT problems.\n");
+		log("\n");
+		log("    -j <N>\n");
+		log("        prove up to N partitions in parallel, each with its own SAT solver.\n");
+		log("        implies -partition.\n");
 		log("\n");
 		log("This command is very effective in proving complex sequential circuits, when\n");
 		log("the internal state of the circuit quickly propagates to $equiv cells.\n");
@@ -194,6 +368,8 @@ struct EquivInductPass : public Pass {
 		int success_counter = 0;
 		EquivBasicConfig cfg {};
 		cfg.max_seq = 4;
+		bool partition = false;
+		int threads = 1;
 
 		log_header(design, "Executing EQUIV_INDUCT pass.\n");
 
@@ -201,6 +377,15 @@ struct EquivInductPass : public Pass {
 		for (argidx = 1; argidx < args.size(); argidx++) {
 			if (cfg.parse(args, argidx))
 				continue;
+			if (args[argidx] == "-partition") {
+				partition = true;
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = std::max(1, atoi(args[++argidx].c_str()));
+				partition = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -221,9 +406,58 @@ struct EquivInductPass : public Pass {
 				continue;
 			}
 
-			EquivInductWorker worker(module, unproven_equiv_cells, cfg);
-			worker.run();
-			success_counter += worker.success_counter;
+			SigMap sigmap(module);
+			vector<Cell*> cells = module->selected_cells();
+
+			if (!partition) {
+				EquivInductWorker worker(module, sigmap, stringf("module %s", module), cells, unproven_equiv_cells, cfg);
+				worker.run();
+				for (auto cell : worker.proven_cells)
+					cell->setPort(ID::B, cell->getPort(ID::A));
+				success_counter += worker.success_counter;
+				continue;
+			}
+
+			vector<EquivInductPartition> partitions = partition_cells(sigmap, cells, unproven_equiv_cells, cfg.set_assumes);
+			log("Split %d unproven $equiv cells in module %s into %d partitions.\n", GetSize(unproven_equiv_cells), module, GetSize(partitions));
+
+			struct PartitionResult {
+				DeferredLogs logs;
+				vector<Cell*> proven_cells;
+			};
+			vector<PartitionResult> results(GetSize(partitions));
+			vector<std::string> titles;
+			for (int i = 0; i < GetSize(partitions); i++)
+				titles.push_back(stringf("partition %d of module %s", i+1, module));
+			int pool_size = threads > 1 ? ThreadPool::pool_size(0, std::min(threads, GetSize(partitions))) : 0;
+			std::atomic<int> next_partition = 0;
+
+			// partitions are independent problems, threads take the next
+			// unsolved partition until none are left
+			auto prove_partitions = [&](bool deferred) {
+				for (int i = next_partition++; i < GetSize(partitions); i = next_partition++) {
+					EquivInductWorker worker(module, sigmap, titles[i], partitions[i].cells, partitions[i].equiv_cells, cfg,
+							deferred ? &results[i].logs : nullptr);
+					worker.run();
+					results[i].proven_cells = std::move(worker.proven_cells);
+				}
+			};
+
+			if (pool_size <= 1) {
+				prove_partitions(false);
+			} else {
+				ParallelDispatchThreadPool thread_pool(pool_size);
+				thread_pool.run([&](const ParallelDispatchThreadPool::RunCtx &) {
+					prove_partitions(true);
+				});
+			}
+
+			for (auto &result : results) {
+				result.logs.flush();
+				for (auto cell : result.proven_cells)
+					cell->setPort(ID::B, cell->getPort(ID::A));
+				success_counter += GetSize(result.proven_cells);
+			}
 		}
 
 		log("Proved %d previously unproven $equiv cells.\n", success_counter);
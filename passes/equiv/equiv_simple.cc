@@ -19,6 +19,8 @@
 
 #include "kernel/log.h"
 #include "kernel/yosys.h"
+#include "kernel/threading.h"
+#include "kernel/gatesim.h"
 #include "passes/equiv/equiv.h"
 
 USING_YOSYS_NAMESPACE
@@ -28,6 +30,9 @@ struct EquivSimpleConfig : EquivBasicConfig {
 	bool verbose = false;
 	bool short_cones = false;
 	bool group = true;
+	bool sim = true;
+	bool incremental = false;
+	int threads = 1;
 	bool parse(const std::vector<std::string>& args, size_t& idx) {
 		if (EquivBasicConfig::parse(args, idx))
 			return true;
@@ -43,6 +48,18 @@ struct EquivSimpleConfig : EquivBasicConfig {
 			group = false;
 			return true;
 		}
+		if (args[idx] == "-incremental") {
+			incremental = true;
+			return true;
+		}
+		if (args[idx] == "-nosim") {
+			sim = false;
+			return true;
+		}
+		if (args[idx] == "-j" && idx+1 < args.size()) {
+			threads = std::max(1, atoi(args[++idx].c_str()));
+			return true;
+		}
 		return false;
 	}
 	static std::string help(const char* default_seq) {
@@ -56,10 +73,196 @@ struct EquivSimpleConfig : EquivBasicConfig {
 		"\n"
 		"    -nogroup\n"
 		"        disabling grouping of $equiv cells by output wire\n"
+		"\n"
+		"    -incremental\n"
+		"        prove all groups whose input cones share cells with one incremental\n"
+		"        SAT solver, so that shared logic is only encoded once and learned\n"
+		"        clauses are kept between proofs\n"
+		"\n"
+		"    -nosim\n"
+		"        do not simulate gate-level input cones with random patterns and\n"
+		"        previous counterexamples to skip SAT calls that would fail\n"
+		"\n"
+		"    -j <N>\n"
+		"        prove up to N groups of $equiv cells in parallel, each with its\n"
+		"        own SAT solver. Proven cells are marked after all proofs are done.\n"
 		"\n";
 	}
 };
 
+// Bit-parallel simulation of the gate-level logic driving $equiv inputs, in the
+// style of fraiging: every input bit gets one value per pattern, where the
+// patterns are all zeros, all ones, random values and the input values of
+// previous SAT counterexamples. If the two sides of an $equiv differ for any
+// pattern, the SAT problem for sequence length 0 is known to be satisfiable.
+//
+// Outputs of flip-flops and undriven bits are the inputs of the simulation.
+// Undriven bits are always free variables of that SAT problem. Flip-flop
+// outputs are only free until the solver has imported cells for earlier time
+// steps, which constrain them through the flip-flops. Cones containing other
+// cells than fine-grained gates are not simulated.
+struct EquivSimulator : GateSim
+{
+	static constexpr int base_words = 2;
+	static constexpr int max_cex_words = 4;
+	// counterexamples are collected until this many can be added at once,
+	// since adding them means simulating all cones again
+	static constexpr int cex_batch = 16;
+
+	const SigMap &sigmap;
+	const dict<SigBit, Cell*> &bit2driver;
+
+	std::vector<dict<SigBit, bool>> cexs, pending_cexs;
+
+	// offset of the simulated words of each bit in `words`, -1 if unsupported
+	dict<SigBit, int> values;
+	pool<SigBit> visiting;
+
+	EquivSimulator(const SigMap &sigmap, const dict<SigBit, Cell*> &bit2driver) :
+			GateSim(base_words), sigmap(sigmap), bit2driver(bit2driver) {}
+
+	static bool is_gate(Cell *cell)
+	{
+		return GateSim::is_gate(cell->type) || cell->type == ID($equiv);
+	}
+
+	// driver of a bit, or nullptr if the bit is an input of the simulation
+	Cell *driver(SigBit bit) const
+	{
+		auto it = bit2driver.find(bit);
+		if (it == bit2driver.end() || it->second->is_builtin_ff())
+			return nullptr;
+		return it->second;
+	}
+
+	// the words after the first `base_words` hold the counterexamples
+	uint64_t cex_word(SigBit bit, int word) const
+	{
+		uint64_t value = input_word(bit, word);
+		if (bit.wire == nullptr || word < base_words)
+			return value;
+		for (int i = (word - base_words) * 64; i < GetSize(cexs) && i < (word - base_words + 1) * 64; i++) {
+			auto it = cexs[i].find(bit);
+			if (it != cexs[i].end()) {
+				uint64_t mask = uint64_t(1) << (i % 64);
+				value = it->second ? value | mask : value & ~mask;
+			}
+		}
+		return value;
+	}
+
+	int simulate(SigBit root)
+	{
+		auto found = values.find(root);
+		if (found != values.end())
+			return found->second;
+
+		std::vector<std::pair<SigBit, bool>> stack = {{root, false}};
+		while (!stack.empty())
+		{
+			auto [bit, expanded] = stack.back();
+			if (values.count(bit)) {
+				if (expanded)
+					visiting.erase(bit);
+				stack.pop_back();
+				continue;
+			}
+
+			Cell *cell = driver(bit);
+			if (cell == nullptr) {
+				values[bit] = GetSize(words);
+				for (int i = 0; i < num_words; i++)
+					words.push_back(cex_word(bit, i));
+				stack.pop_back();
+				continue;
+			}
+
+			if (!is_gate(cell) || (!expanded && visiting.count(bit))) {
+				// unsupported cell or combinational loop
+				values[bit] = -1;
+				stack.pop_back();
+				continue;
+			}
+
+			if (!expanded) {
+				visiting.insert(bit);
+				stack.back().second = true;
+				for (auto &conn : cell->connections())
+					if (conn.first != ID::Y) {
+						SigBit input = sigmap(conn.second).as_bit();
+						if (!values.count(input))
+							stack.push_back({input, false});
+					}
+				continue;
+			}
+
+			visiting.erase(bit);
+			values[bit] = eval_cell(cell, [&](SigBit input) { return values.at(sigmap(input)); });
+			stack.pop_back();
+		}
+
+		return values.at(root);
+	}
+
+	// true if the simulation shows that the bits can differ
+	bool differs(SigBit bit_a, SigBit bit_b)
+	{
+		int a = simulate(bit_a);
+		int b = simulate(bit_b);
+		if (a < 0 || b < 0)
+			return false;
+		for (int i = 0; i < num_words; i++)
+			if (words[a+i] != words[b+i])
+				return true;
+		return false;
+	}
+
+	// inputs of the simulation that the given bits depend on, empty if the
+	// cones are not simulated
+	std::vector<SigBit> inputs(SigBit bit_a, SigBit bit_b)
+	{
+		if (simulate(bit_a) < 0 || simulate(bit_b) < 0)
+			return {};
+
+		std::vector<SigBit> result;
+		pool<SigBit> seen;
+		std::vector<SigBit> queue = {bit_a, bit_b};
+		while (!queue.empty()) {
+			SigBit bit = queue.back();
+			queue.pop_back();
+			if (!seen.insert(bit).second)
+				continue;
+			Cell *cell = driver(bit);
+			if (cell == nullptr) {
+				if (bit.wire != nullptr)
+					result.push_back(bit);
+				continue;
+			}
+			for (auto &conn : cell->connections())
+				if (conn.first != ID::Y)
+					queue.push_back(sigmap(conn.second).as_bit());
+		}
+		return result;
+	}
+
+	void add_cex(dict<SigBit, bool> &&cex)
+	{
+		pending_cexs.push_back(std::move(cex));
+		if (GetSize(pending_cexs) < cex_batch)
+			return;
+
+		for (auto &it : pending_cexs)
+			cexs.push_back(std::move(it));
+		pending_cexs.clear();
+		if (GetSize(cexs) > max_cex_words * 64)
+			cexs.erase(cexs.begin(), cexs.begin() + (GetSize(cexs) - max_cex_words * 64));
+
+		num_words = base_words + (GetSize(cexs) + 63) / 64;
+		values.clear();
+		words.clear();
+	}
+};
+
 struct EquivSimpleWorker : public EquivWorker<EquivSimpleConfig>
 {
 	const vector<Cell*> &equiv_cells;
@@ -81,9 +284,36 @@ struct EquivSimpleWorker : public EquivWorker<EquivSimpleConfig>
 
 	pool<pair<Cell*, int>> imported_cells_cache;
 
-	EquivSimpleWorker(const vector<Cell*> &equiv_cells, const vector<Cell*> &assume_cells, DesignModel model, EquivSimpleConfig cfg) :
+	// When running on a worker thread, messages are collected in `logs` and
+	// proven cells in `proven_cells` instead of modifying the module, so that
+	// the main thread can replay both in the order of a serial run.
+	DeferredLogs *logs = nullptr;
+	vector<Cell*> proven_cells;
+
+	EquivSimulator *sim;
+	int sim_skipped = 0;
+	// set once cells were imported for a time step before the last one, which
+	// constrains the flip-flop outputs of the last time step
+	bool imported_earlier_steps = false;
+
+	EquivSimpleWorker(const vector<Cell*> &equiv_cells, const vector<Cell*> &assume_cells, DesignModel model, EquivSimpleConfig cfg,
+			EquivSimulator *sim, DeferredLogs *logs = nullptr) :
 			EquivWorker<EquivSimpleConfig>(equiv_cells.front()->module, &model.sigmap, cfg), equiv_cells(equiv_cells), assume_cells(assume_cells),
-			model(model) {}
+			model(model), logs(logs), sim(sim)
+	{
+		// patterns do not respect assumptions or undef modelling
+		if (cfg.set_assumes || cfg.model_undef)
+			this->sim = nullptr;
+	}
+
+	template <typename... Args>
+	void log(FmtString<TypeIdentity<Args>...> fmt, const Args &... args) const
+	{
+		if (logs)
+			logs->log(fmt, args...);
+		else
+			YOSYS_NAMESPACE_PREFIX log(fmt, args...);
+	}
 
 	struct ConeFinder {
 		DesignModel model;
@@ -290,6 +520,18 @@ struct EquivSimpleWorker : public EquivWorker<EquivSimpleConfig>
 			log("    Problem size at t=%d: %d literals, %d clauses\n", step, ez->numCnfVariables(), ez->numCnfClauses());
 	}
 
+	// true if the bits differing in simulation means that the SAT problem for
+	// sequence length 0 is satisfiable
+	bool sim_conclusive(SigBit bit_a, SigBit bit_b)
+	{
+		if (!imported_earlier_steps)
+			return true;
+		for (auto bit : sim->inputs(bit_a, bit_b))
+			if (model.bit2driver.count(bit))
+				return false;
+		return true;
+	}
+
 	bool prove_equiv_cell(Cell* cell)
 	{
 		SigBit bit_a = model.sigmap(cell->getPort(ID::A)).as_bit();
@@ -311,6 +553,10 @@ struct EquivSimpleWorker : public EquivWorker<EquivSimpleConfig>
 			log("  Trying to prove $equiv for %s:", log_signal(cell->getPort(ID::Y)));
 		}
 
+		// A difference in simulation means that the first SAT problem would be
+		// satisfiable, as long as the simulated inputs are unconstrained there.
+		bool sim_differs = sim != nullptr && sim->differs(bit_a, bit_b) && sim_conclusive(bit_a, bit_b);
+
 		int step = cfg.max_seq;
 		while (1)
 		{
@@ -337,17 +583,45 @@ struct EquivSimpleWorker : public EquivWorker<EquivSimpleConfig>
 			for (auto cell : problem_cells) {
 				auto key = pair<Cell*, int>(cell, step+1);
 				if (!imported_cells_cache.count(key) && !satgen.importCell(cell, step+1)) {
-					report_missing_model(cfg.ignore_unknown_cells, cell);
+					report_missing_model(cfg.ignore_unknown_cells, cell, logs);
 				}
 				imported_cells_cache.insert(key);
+				if (step < cfg.max_seq)
+					imported_earlier_steps = true;
 			}
 
 			construct_ezsat(input_bits, step);
 
-			if (!ez->solve(ez_context)) {
+			bool sat;
+			if (step == cfg.max_seq && sim_differs) {
+				if (cfg.verbose)
+					log("    Simulation shows a difference, skipping SAT for sequence length 0.\n");
+				sim_skipped++;
+				sat = true;
+			} else if (step == cfg.max_seq && sim != nullptr) {
+				// keep the counterexample for simulating later $equiv cells
+				std::vector<SigBit> sim_inputs = sim->inputs(bit_a, bit_b);
+				std::vector<int> model_expressions;
+				std::vector<bool> model_values;
+				for (auto bit : sim_inputs)
+					model_expressions.push_back(satgen.importSigBit(bit, step+1));
+				sat = ez->solve(model_expressions, model_values, ez_context);
+				if (sat && !sim_inputs.empty()) {
+					dict<SigBit, bool> cex;
+					for (int i = 0; i < GetSize(sim_inputs); i++)
+						cex[sim_inputs[i]] = model_values[i];
+					sim->add_cex(std::move(cex));
+				}
+			} else
+				sat = ez->solve(ez_context);
+
+			if (!sat) {
 				log("%s", cfg.verbose ? "    Proved equivalence! Marking $equiv cell as proven.\n" : " success!\n");
 				// Replace $equiv cell with a short
-				cell->setPort(ID::B, cell->getPort(ID::A));
+				if (logs)
+					proven_cells.push_back(cell);
+				else
+					cell->setPort(ID::B, cell->getPort(ID::A));
 				ez->assume(ez->NOT(ez_context));
 				return true;
 			}
@@ -431,10 +705,59 @@ struct EquivSimplePass : public Pass {
 		log("%s", EquivSimpleConfig::help("1"));
 		log("\n");
 	}
+	// Merges groups whose combinational input cones share a cell, so that each
+	// partition is proven by one worker with a single incremental solver.
+	static vector<vector<Cell*>> partition_groups(const vector<vector<Cell*>> &groups, const SigMap &sigmap, const dict<SigBit, Cell*> &bit2driver)
+	{
+		mfp<int> partition;
+		dict<Cell*, int> cell_group;
+
+		for (int i = 0; i < GetSize(groups); i++) {
+			partition.lookup(i);
+			vector<SigBit> queue;
+			for (auto cell : groups[i]) {
+				queue.push_back(sigmap(cell->getPort(ID::A)).as_bit());
+				queue.push_back(sigmap(cell->getPort(ID::B)).as_bit());
+			}
+			while (!queue.empty()) {
+				SigBit bit = queue.back();
+				queue.pop_back();
+				auto it = bit2driver.find(bit);
+				if (it == bit2driver.end())
+					continue;
+				Cell *driver = it->second;
+				auto [owner, inserted] = cell_group.emplace(driver, i);
+				if (!inserted) {
+					// the cone beyond this cell was already visited
+					partition.merge(i, owner->second);
+					continue;
+				}
+				if (driver->is_builtin_ff())
+					continue;
+				for (auto &conn : driver->connections())
+					if (driver->input(conn.first))
+						for (auto input : sigmap(conn.second))
+							queue.push_back(input);
+			}
+		}
+
+		dict<int, int> partition_index;
+		vector<vector<Cell*>> partitions;
+		for (int i = 0; i < GetSize(groups); i++) {
+			auto [it, inserted] = partition_index.emplace(partition.find(i), GetSize(partitions));
+			if (inserted)
+				partitions.emplace_back();
+			auto &cells = partitions[it->second];
+			cells.insert(cells.end(), groups[i].begin(), groups[i].end());
+		}
+		return partitions;
+	}
+
 	void execute(std::vector<std::string> args, Design *design) override
 	{
 		EquivSimpleConfig cfg {};
 		int success_counter = 0;
+		int sim_skipped_counter = 0;
 
 		log_header(design, "Executing EQUIV_SIMPLE pass.\n");
 
@@ -489,6 +812,7 @@ struct EquivSimplePass : public Pass {
 			}
 
 			unproven_equiv_cells.sort();
+			vector<vector<Cell*>> groups;
 			for (auto [_, d] : unproven_equiv_cells)
 			{
 				d.sort();
@@ -496,13 +820,64 @@ struct EquivSimplePass : public Pass {
 				vector<Cell*> cells;
 				for (auto [_, cell] : d)
 					cells.push_back(cell);
+				groups.push_back(std::move(cells));
+			}
 
-				EquivSimpleWorker::DesignModel model {sigmap, bit2driver};
-				EquivSimpleWorker worker(cells, assumes, model, cfg);
-				success_counter += worker.run();
+			if (cfg.incremental && GetSize(groups) > 1) {
+				int num_groups = GetSize(groups);
+				groups = partition_groups(groups, sigmap, bit2driver);
+				log("Merged %d groups into %d partitions with shared input cones.\n", num_groups, GetSize(groups));
+			}
+
+			EquivSimpleWorker::DesignModel model {sigmap, bit2driver};
+			int pool_size = cfg.threads > 1 ? ThreadPool::pool_size(0, std::min(cfg.threads, GetSize(groups))) : 0;
+
+			if (pool_size <= 1) {
+				EquivSimulator sim(sigmap, bit2driver);
+				for (auto &cells : groups) {
+					EquivSimpleWorker worker(cells, assumes, model, cfg, cfg.sim ? &sim : nullptr);
+					success_counter += worker.run();
+					sim_skipped_counter += worker.sim_skipped;
+				}
+				continue;
+			}
+
+			// Groups are independent SAT problems. Threads take the next
+			// unsolved group until none are left; the solver of each group is
+			// freed as soon as it is done.
+			struct GroupResult {
+				DeferredLogs logs;
+				vector<Cell*> proven_cells;
+				int sim_skipped;
+			};
+			vector<GroupResult> results(GetSize(groups));
+			std::atomic<int> next_group = 0;
+
+			ParallelDispatchThreadPool thread_pool(pool_size);
+			thread_pool.run([&](const ParallelDispatchThreadPool::RunCtx &) {
+				for (int i = next_group++; i < GetSize(groups); i = next_group++) {
+					// each group simulates on its own, so that the skipped
+					// SAT calls do not depend on the order groups are solved
+					EquivSimulator sim(sigmap, bit2driver);
+					EquivSimpleWorker worker(groups[i], assumes, model, cfg, cfg.sim ? &sim : nullptr, &results[i].logs);
+					worker.run();
+					results[i].proven_cells = std::move(worker.proven_cells);
+					results[i].sim_skipped = worker.sim_skipped;
+				}
+			});
+
+			for (auto &result : results) {
+				result.logs.flush();
+				for (auto cell : result.proven_cells)
+					cell->setPort(ID::B, cell->getPort(ID::A));
+				success_counter += GetSize(result.proven_cells);
+				sim_skipped_counter += result.sim_skipped;
 			}
 		}
 
+		if (sim_skipped_counter > 0)
+			log("Skipped %d SAT calls for $equiv cells that differ in simulation.\n", sim_skipped_counter);
+
 		log("Proved %d previously unproven $equiv cells.\n", success_counter);
 	}
 } EquivSimplePass;
@@ -28,7 +28,6 @@ struct EquivStructWorker
 	Module *module;
 	SigMap sigmap;
 	SigMap equiv_bits;
-	bool mode_fwd;
 	bool mode_icells;
 	int merge_count;
 
@@ -55,8 +54,190 @@ struct EquivStructWorker
 		}
 	};
 
-	dict<merge_key_t, pool<IdString>> merge_cache;
-	pool<merge_key_t> fwd_merge_cache, bwd_merge_cache;
+	// Cells are grouped by a forward key (their inputs) and by backward keys
+	// (each of their output bits, modulo $equiv cells). Both maps are updated
+	// incrementally with the connections added by merges, and only the cells
+	// reading or driving a bit whose representative changed are re-keyed and
+	// may form new groups of mergeable cells.
+	dict<merge_key_t, pool<IdString>> fwd_groups, bwd_groups;
+	dict<IdString, merge_key_t> cell_fwd_key;
+	dict<IdString, vector<merge_key_t>> cell_bwd_keys;
+	pool<merge_key_t> fwd_pending, bwd_pending;
+	pool<IdString> fwd_queue, bwd_queue;
+
+	// cells reading each bit (by sigmap), and driving each class of bits (by equiv_bits)
+	dict<SigBit, pool<IdString>> bit_readers, class_drivers;
+
+	bool handled_cell(Cell *cell)
+	{
+		if (!module->design->selected(module, cell))
+			return false;
+		return cell->type == ID($equiv) || mode_icells || module->design->module(cell->type);
+	}
+
+	// Merges the classes of a and b in `map` and moves the cells indexed under
+	// a representative that changed to the new one and into `queue`.
+	void add_to_map(SigMap &map, dict<SigBit, pool<IdString>> &index, pool<IdString> &queue, SigBit a, SigBit b)
+	{
+		SigBit rep_a = map(a), rep_b = map(b);
+		if (rep_a == rep_b)
+			return;
+		map.add(a, b);
+		SigBit rep = map(a);
+		for (auto old_rep : {rep_a, rep_b}) {
+			if (old_rep == rep)
+				continue;
+			auto it = index.find(old_rep);
+			if (it == index.end())
+				continue;
+			pool<IdString> cells;
+			cells.swap(it->second);
+			index.erase(old_rep);
+			for (auto name : cells)
+				queue.insert(name);
+			auto &rep_cells = index[rep];
+			rep_cells.insert(cells.begin(), cells.end());
+		}
+	}
+
+	void connect(const SigSpec &sig_a, const SigSpec &sig_b)
+	{
+		module->connect(sig_a, sig_b);
+		for (int i = 0; i < GetSize(sig_a); i++) {
+			add_to_map(sigmap, bit_readers, fwd_queue, sig_a[i], sig_b[i]);
+			add_to_map(equiv_bits, class_drivers, bwd_queue, sig_a[i], sig_b[i]);
+		}
+	}
+
+	void add_cell(Cell *cell)
+	{
+		for (auto &conn : cell->connections()) {
+			if (cell->input(conn.first))
+				for (auto bit : sigmap(conn.second))
+					bit_readers[bit].insert(cell->name);
+			if (cell->output(conn.first))
+				for (auto bit : equiv_bits(conn.second))
+					class_drivers[bit].insert(cell->name);
+		}
+		fwd_queue.insert(cell->name);
+		bwd_queue.insert(cell->name);
+	}
+
+	void add_equiv(Cell *cell)
+	{
+		SigBit sig_a = cell->getPort(ID::A).as_bit();
+		SigBit sig_b = cell->getPort(ID::B).as_bit();
+		add_to_map(equiv_bits, class_drivers, bwd_queue, sig_b, sig_a);
+		add_cell(cell);
+		// the drivers of the inputs may now be redundant $equiv cells
+		for (auto bit : {sig_a, sig_b}) {
+			auto it = class_drivers.find(equiv_bits(bit));
+			if (it != class_drivers.end())
+				fwd_queue.insert(it->second.begin(), it->second.end());
+		}
+	}
+
+	bool is_equiv_input(SigBit bit)
+	{
+		auto it = bit_readers.find(bit);
+		if (it == bit_readers.end())
+			return false;
+		for (auto name : it->second) {
+			Cell *cell = module->cell(name);
+			if (cell != nullptr && cell->type == ID($equiv) &&
+					(sigmap(cell->getPort(ID::A).as_bit()) == bit || sigmap(cell->getPort(ID::B).as_bit()) == bit))
+				return true;
+		}
+		return false;
+	}
+
+	merge_key_t base_key(Cell *cell)
+	{
+		merge_key_t key;
+		key.type = cell->type;
+
+		for (auto &it : cell->parameters)
+			key.parameters.push_back(it);
+		std::sort(key.parameters.begin(), key.parameters.end());
+
+		for (auto &it : cell->connections())
+			key.port_sizes.push_back(make_pair(it.first, GetSize(it.second)));
+		std::sort(key.port_sizes.begin(), key.port_sizes.end());
+
+		return key;
+	}
+
+	void update_fwd_key(IdString cell_name)
+	{
+		auto old_key = cell_fwd_key.find(cell_name);
+		if (old_key != cell_fwd_key.end()) {
+			fwd_groups[old_key->second].erase(cell_name);
+			cell_fwd_key.erase(old_key);
+		}
+
+		Cell *cell = module->cell(cell_name);
+		if (cell == nullptr)
+			return;
+
+		if (cell->type == ID($equiv)) {
+			SigBit sig_a = sigmap(cell->getPort(ID::A).as_bit());
+			SigBit sig_b = sigmap(cell->getPort(ID::B).as_bit());
+			SigBit sig_y = sigmap(cell->getPort(ID::Y).as_bit());
+			if (sig_a == sig_b && is_equiv_input(sig_y)) {
+				log("    Purging redundant $equiv cell %s.\n", cell);
+				bwd_queue.insert(cell_name);
+				connect(sig_y, sig_a);
+				module->remove(cell);
+				merge_count++;
+				return;
+			}
+		}
+
+		merge_key_t key = base_key(cell);
+		for (auto &conn : cell->connections())
+			if (cell->input(conn.first)) {
+				SigSpec sig = sigmap(conn.second);
+				for (int i = 0; i < GetSize(sig); i++)
+					key.connections.push_back(make_tuple(conn.first, i, sig[i]));
+			}
+		std::sort(key.connections.begin(), key.connections.end());
+
+		auto &group = fwd_groups[key];
+		group.insert(cell_name);
+		if (GetSize(group) > 1)
+			fwd_pending.insert(key);
+		cell_fwd_key[cell_name] = std::move(key);
+	}
+
+	void update_bwd_keys(IdString cell_name)
+	{
+		auto old_keys = cell_bwd_keys.find(cell_name);
+		if (old_keys != cell_bwd_keys.end()) {
+			for (auto &key : old_keys->second)
+				bwd_groups[key].erase(cell_name);
+			cell_bwd_keys.erase(old_keys);
+		}
+
+		Cell *cell = module->cell(cell_name);
+		if (cell == nullptr || fwonly_cells.count(cell->type))
+			return;
+
+		merge_key_t key = base_key(cell);
+		auto &keys = cell_bwd_keys[cell_name];
+		for (auto &conn : cell->connections())
+			if (cell->output(conn.first)) {
+				SigSpec sig = equiv_bits(conn.second);
+				for (int i = 0; i < GetSize(sig); i++) {
+					key.connections.clear();
+					key.connections.push_back(make_tuple(conn.first, i, sig[i]));
+					auto &group = bwd_groups[key];
+					group.insert(cell_name);
+					if (GetSize(group) > 1)
+						bwd_pending.insert(key);
+					keys.push_back(key);
+				}
+			}
+	}
 
 	void merge_cell_pair(Cell *cell_a, Cell *cell_b)
 	{
@@ -83,12 +264,13 @@ struct EquivStructWorker
 					}
 		}
 
+		vector<Cell*> new_equiv_cells;
 		for (int i = 0; i < GetSize(inputs_a); i++) {
 			SigBit bit_a = inputs_a[i], bit_b = inputs_b[i];
 			SigBit bit_y = module->addWire(NEW_ID);
 			log("        New $equiv for input %s: A: %s, B: %s, Y: %s\n",
 					input_names[i].c_str(), log_signal(bit_a), log_signal(bit_b), log_signal(bit_y));
-			module->addEquiv(NEW_ID, bit_a, bit_b, bit_y);
+			new_equiv_cells.push_back(module->addEquiv(NEW_ID, bit_a, bit_b, bit_y));
 			merged_map.add(bit_a, bit_y);
 			merged_map.add(bit_b, bit_y);
 		}
@@ -107,177 +289,171 @@ struct EquivStructWorker
 		for (auto &pn : outport_names) {
 			SigSpec sig_a = cell_a->getPort(pn);
 			SigSpec sig_b = cell_b->getPort(pn);
-			module->connect(sig_b, sig_a);
+			connect(sig_b, sig_a);
 		}
 
 		auto merged_attr = cell_b->get_strpool_attribute(ID::equiv_merged);
 		merged_attr.insert(cell_b->name.unescape());
 		cell_a->add_strpool_attribute(ID::equiv_merged, merged_attr);
+		fwd_queue.insert(cell_b->name);
+		bwd_queue.insert(cell_b->name);
 		module->remove(cell_b);
+
+		add_cell(cell_a);
+		for (auto cell : new_equiv_cells)
+			if (handled_cell(cell))
+				add_equiv(cell);
 	}
 
-	EquivStructWorker(Module *module, bool mode_fwd, bool mode_icells, const pool<IdString> &fwonly_cells, int iter_num) :
-			module(module), sigmap(module), equiv_bits(module),
-			mode_fwd(mode_fwd), mode_icells(mode_icells), merge_count(0), fwonly_cells(fwonly_cells)
+	void merge_groups(int phase)
 	{
-		log("  Starting iteration %d.\n", iter_num);
+		auto &groups = phase ? bwd_groups : fwd_groups;
+		pool<merge_key_t> queue;
+		queue.swap(phase ? bwd_pending : fwd_pending);
 
-		pool<SigBit> equiv_inputs;
-		pool<IdString> cells;
+		for (auto &key : queue)
+		{
+			const char *strategy = nullptr;
+			vector<Cell*> gold_cells, gate_cells, other_cells;
+			vector<pair<Cell*, Cell*>> cell_pairs;
+			IdString cells_type;
 
-		for (auto cell : module->selected_cells())
-			if (cell->type == ID($equiv)) {
-				SigBit sig_a = sigmap(cell->getPort(ID::A).as_bit());
-				SigBit sig_b = sigmap(cell->getPort(ID::B).as_bit());
-				equiv_bits.add(sig_b, sig_a);
-				equiv_inputs.insert(sig_a);
-				equiv_inputs.insert(sig_b);
-				cells.insert(cell->name);
-			} else {
-				if (mode_icells || module->design->module(cell->type))
-					cells.insert(cell->name);
-			}
+			auto group = groups.find(key);
+			if (group == groups.end())
+				continue;
 
-		for (auto cell : module->selected_cells())
-			if (cell->type == ID($equiv)) {
-				SigBit sig_a = sigmap(cell->getPort(ID::A).as_bit());
-				SigBit sig_b = sigmap(cell->getPort(ID::B).as_bit());
-				SigBit sig_y = sigmap(cell->getPort(ID::Y).as_bit());
-				if (sig_a == sig_b && equiv_inputs.count(sig_y)) {
-					log("    Purging redundant $equiv cell %s.\n", cell);
-					module->connect(sig_y, sig_a);
-					module->remove(cell);
-					merge_count++;
+			for (auto cell_name : group->second) {
+				Cell *c = module->cell(cell_name);
+				if (c != nullptr) {
+					string n = cell_name.str();
+					cells_type = c->type;
+					if (GetSize(n) > 5 && n.compare(GetSize(n)-5, std::string::npos, "_gold") == 0)
+						gold_cells.push_back(c);
+					else if (GetSize(n) > 5 && n.compare(GetSize(n)-5, std::string::npos, "_gate") == 0)
+						gate_cells.push_back(c);
+					else
+						other_cells.push_back(c);
 				}
 			}
 
-		if (merge_count > 0)
-			return;
-
-		for (auto cell_name : cells)
-		{
-			merge_key_t key;
-			vector<tuple<IdString, int, SigBit>> fwd_connections;
-
-			Cell *cell = module->cell(cell_name);
-			key.type = cell->type;
-
-			for (auto &it : cell->parameters)
-				key.parameters.push_back(it);
-			std::sort(key.parameters.begin(), key.parameters.end());
-
-			for (auto &it : cell->connections())
-				key.port_sizes.push_back(make_pair(it.first, GetSize(it.second)));
-			std::sort(key.port_sizes.begin(), key.port_sizes.end());
+			if (GetSize(gold_cells) > 1 || GetSize(gate_cells) > 1 || GetSize(other_cells) > 1)
+			{
+				strategy = "deduplicate";
+				for (int i = 0; i+1 < GetSize(gold_cells); i += 2)
+					cell_pairs.push_back(make_pair(gold_cells[i], gold_cells[i+1]));
+				for (int i = 0; i+1 < GetSize(gate_cells); i += 2)
+					cell_pairs.push_back(make_pair(gate_cells[i], gate_cells[i+1]));
+				for (int i = 0; i+1 < GetSize(other_cells); i += 2)
+					cell_pairs.push_back(make_pair(other_cells[i], other_cells[i+1]));
+				goto run_strategy;
+			}
 
-			for (auto &conn : cell->connections())
+			if (GetSize(gold_cells) == 1 && GetSize(gate_cells) == 1)
 			{
-				if (cell->input(conn.first)) {
-					SigSpec sig = sigmap(conn.second);
-					for (int i = 0; i < GetSize(sig); i++)
-						fwd_connections.push_back(make_tuple(conn.first, i, sig[i]));
-				}
+				strategy = "gold-gate-pairs";
+				cell_pairs.push_back(make_pair(gold_cells[0], gate_cells[0]));
+				goto run_strategy;
+			}
 
-				if (cell->output(conn.first)) {
-					SigSpec sig = equiv_bits(conn.second);
-					for (int i = 0; i < GetSize(sig); i++) {
-						key.connections.clear();
-						key.connections.push_back(make_tuple(conn.first, i, sig[i]));
+			if (GetSize(gold_cells) == 1 && GetSize(other_cells) == 1)
+			{
+				strategy = "gold-guess";
+				cell_pairs.push_back(make_pair(gold_cells[0], other_cells[0]));
+				goto run_strategy;
+			}
 
-						if (merge_cache.count(key))
-							bwd_merge_cache.insert(key);
-						merge_cache[key].insert(cell_name);
-					}
-				}
+			if (GetSize(other_cells) == 1 && GetSize(gate_cells) == 1)
+			{
+				strategy = "gate-guess";
+				cell_pairs.push_back(make_pair(other_cells[0], gate_cells[0]));
+				goto run_strategy;
 			}
 
-			std::sort(fwd_connections.begin(), fwd_connections.end());
-			key.connections.swap(fwd_connections);
+			log_assert(GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells) < 2);
+			continue;
 
-			if (merge_cache.count(key))
-				fwd_merge_cache.insert(key);
-			merge_cache[key].insert(cell_name);
+		run_strategy:
+			int total_group_size = GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells);
+			log("    %s merging %d %s cells (from group of %d) using strategy %s:\n", phase ? "Bwd" : "Fwd",
+					2*GetSize(cell_pairs), cells_type.unescape(), total_group_size, strategy);
+			for (auto it : cell_pairs) {
+				log("      Merging cells %s and %s.\n", it.first,  it.second);
+				merge_cell_pair(it.first, it.second);
+			}
 		}
+	}
 
-		for (int phase = 0; phase < 2; phase++)
-		{
-			auto &queue = phase ? bwd_merge_cache : fwd_merge_cache;
-
-			for (auto &key : queue)
-			{
-				const char *strategy = nullptr;
-				vector<Cell*> gold_cells, gate_cells, other_cells;
-				vector<pair<Cell*, Cell*>> cell_pairs;
-				IdString cells_type;
-
-				for (auto cell_name : merge_cache[key]) {
-					Cell *c = module->cell(cell_name);
-					if (c != nullptr) {
-						string n = cell_name.str();
-						cells_type = c->type;
-						if (GetSize(n) > 5 && n.compare(GetSize(n)-5, std::string::npos, "_gold") == 0)
-							gold_cells.push_back(c);
-						else if (GetSize(n) > 5 && n.compare(GetSize(n)-5, std::string::npos, "_gate") == 0)
-							gate_cells.push_back(c);
-						else
-							other_cells.push_back(c);
-					}
+	EquivStructWorker(Module *module, bool mode_icells, const pool<IdString> &fwonly_cells) :
+			module(module), sigmap(module), equiv_bits(module),
+			mode_icells(mode_icells), merge_count(0), fwonly_cells(fwonly_cells)
+	{
+		vector<Cell*> cells;
+		for (auto cell : module->selected_cells())
+			if (handled_cell(cell)) {
+				if (cell->type == ID($equiv)) {
+					SigBit sig_a = sigmap(cell->getPort(ID::A).as_bit());
+					SigBit sig_b = sigmap(cell->getPort(ID::B).as_bit());
+					equiv_bits.add(sig_b, sig_a);
 				}
+				cells.push_back(cell);
+			}
 
-				if (phase && fwonly_cells.count(cells_type))
-					continue;
-
-				if (GetSize(gold_cells) > 1 || GetSize(gate_cells) > 1 || GetSize(other_cells) > 1)
-				{
-					strategy = "deduplicate";
-					for (int i = 0; i+1 < GetSize(gold_cells); i += 2)
-						cell_pairs.push_back(make_pair(gold_cells[i], gold_cells[i+1]));
-					for (int i = 0; i+1 < GetSize(gate_cells); i += 2)
-						cell_pairs.push_back(make_pair(gate_cells[i], gate_cells[i+1]));
-					for (int i = 0; i+1 < GetSize(other_cells); i += 2)
-						cell_pairs.push_back(make_pair(other_cells[i], other_cells[i+1]));
-					goto run_strategy;
-				}
+		for (auto cell : cells)
+			add_cell(cell);
+	}
 
-				if (GetSize(gold_cells) == 1 && GetSize(gate_cells) == 1)
-				{
-					strategy = "gold-gate-pairs";
-					cell_pairs.push_back(make_pair(gold_cells[0], gate_cells[0]));
-					goto run_strategy;
-				}
+	// drops pending keys whose group was split up again by re-keying
+	static void prune_pending(pool<merge_key_t> &pending, dict<merge_key_t, pool<IdString>> &groups)
+	{
+		pool<merge_key_t> keys;
+		for (auto &key : pending)
+			if (GetSize(groups.at(key)) > 1)
+				keys.insert(key);
+		pending.swap(keys);
+	}
 
-				if (GetSize(gold_cells) == 1 && GetSize(other_cells) == 1)
-				{
-					strategy = "gold-guess";
-					cell_pairs.push_back(make_pair(gold_cells[0], other_cells[0]));
-					goto run_strategy;
+	// Forward merges are done until none are left, then backward merges
+	// until forward merges are possible again. Each batch of merges of the
+	// currently pending groups counts as one iteration.
+	void run(bool mode_fwd, int max_iter)
+	{
+		for (int iter = 0;; iter++)
+		{
+			pool<IdString> queue;
+			while (!fwd_queue.empty()) {
+				queue.swap(fwd_queue);
+				for (auto cell_name : queue)
+					update_fwd_key(cell_name);
+				queue.clear();
+			}
+			prune_pending(fwd_pending, fwd_groups);
+
+			int phase = 0;
+			if (fwd_pending.empty()) {
+				if (!mode_fwd) {
+					while (!bwd_queue.empty()) {
+						queue.swap(bwd_queue);
+						for (auto cell_name : queue)
+							update_bwd_keys(cell_name);
+						queue.clear();
+					}
+					prune_pending(bwd_pending, bwd_groups);
 				}
-
-				if (GetSize(other_cells) == 1 && GetSize(gate_cells) == 1)
-				{
-					strategy = "gate-guess";
-					cell_pairs.push_back(make_pair(other_cells[0], gate_cells[0]));
-					goto run_strategy;
+				if (bwd_pending.empty()) {
+					log("    Nothing to merge.\n");
+					break;
 				}
+				phase = 1;
+			}
 
-				log_assert(GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells) < 2);
-				continue;
-
-			run_strategy:
-				int total_group_size = GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells);
-				log("    %s merging %d %s cells (from group of %d) using strategy %s:\n", phase ? "Bwd" : "Fwd",
-						2*GetSize(cell_pairs), cells_type.unescape(), total_group_size, strategy);
-				for (auto it : cell_pairs) {
-					log("      Merging cells %s and %s.\n", it.first,  it.second);
-					merge_cell_pair(it.first, it.second);
-				}
+			if (iter == max_iter) {
+				log("  Reached iteration limit of %d.\n", iter);
+				break;
 			}
 
-			if (merge_count > 0)
-				return;
+			log("  Starting iteration %d.\n", iter+1);
+			merge_groups(phase);
 		}
-
-		log("    Nothing to merge.\n");
 	}
 };
 
@@ -346,20 +522,11 @@ struct EquivStructPass : public Pass {
 		extra_args(args, argidx, design);
 
 		for (auto module : design->selected_modules()) {
-			int module_merge_count = 0;
 			log("Running equiv_struct on module %s:\n", module);
-			for (int iter = 0;; iter++) {
-				if (iter == max_iter) {
-					log("  Reached iteration limit of %d.\n", iter);
-					break;
-				}
-				EquivStructWorker worker(module, mode_fwd, mode_icells, fwonly_cells, iter+1);
-				if (worker.merge_count == 0)
-					break;
-				module_merge_count += worker.merge_count;
-			}
-			if (module_merge_count)
-				log("  Performed a total of %d merges in module %s.\n", module_merge_count, module);
+			EquivStructWorker worker(module, mode_icells, fwonly_cells);
+			worker.run(mode_fwd, max_iter);
+			if (worker.merge_count)
+				log("  Performed a total of %d merges in module %s.\n", worker.merge_count, module);
 		}
 	}
 } EquivStructPass;
@@ -0,0 +1,615 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/gatesim.h"
+#include "passes/equiv/equiv.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct EquivSweepConfig : EquivBasicConfig {
+	bool verbose = false;
+	int64_t prop_limit = 0;
+
+	bool parse(const std::vector<std::string>& args, size_t& idx) {
+		if (args[idx] == "-set-assumes") {
+			set_assumes = true;
+			return true;
+		}
+		if (args[idx] == "-ignore-unknown-cells") {
+			ignore_unknown_cells = true;
+			return true;
+		}
+		if (args[idx] == "-v") {
+			verbose = true;
+			return true;
+		}
+		if (args[idx] == "-prop-limit" && idx+1 < args.size()) {
+			prop_limit = atoll(args[++idx].c_str());
+			return true;
+		}
+		return false;
+	}
+};
+
+// SAT sweeping of the combinational input cones of all unproven $equiv cells
+// in a module. Outputs of flip-flops and undriven bits are free inputs.
+//
+// The output bits of all fine-grained gates in the cones are simulated with
+// random patterns and grouped into candidate classes of bits with equal (or
+// complementary) signatures. The gates are then encoded in topological order
+// as ezSAT expressions of the literals of their inputs, in a single
+// incremental solver, and each candidate is checked against the first bit of
+// its class. A proven bit is replaced by the literal of its representative in
+// its fanout. ezSAT hashes expressions structurally, so gates of the fanout
+// that become identical by this are merged, and a candidate whose expression
+// is already the one of its representative is proven without a SAT call. A
+// counterexample is simulated on the cones and splits all classes by the
+// values of their bits. Other cells of the cones are imported with SatGen.
+//
+// Finally, the two sides of an $equiv cell are proven equal either because
+// they ended up with the same literal, or with one more SAT call.
+struct EquivSweepWorker : public EquivWorker<EquivSweepConfig>
+{
+	const SigMap &sigmap;
+	const dict<SigBit, Cell*> &bit2driver;
+	vector<Cell*> equiv_cells;
+
+	// cells of the input cones in topological order
+	vector<Cell*> cone_cells;
+	pool<Cell*> cone_set;
+
+	// offset of the simulated words of each bit in `sim.words`, -1 if unsupported
+	dict<SigBit, int> values;
+	GateSim sim{4};
+	// free inputs of the simulation, the values of a counterexample are read for them
+	vector<SigBit> inputs;
+	vector<int> input_lits;
+
+	// literals of the encoded gate outputs, after replacing proven bits
+	dict<SigBit, int> bit_lit;
+	// gate outputs that are inputs of cells imported with SatGen, their SatGen
+	// variables are tied to the literals of the gates
+	pool<SigBit> linked;
+
+	// candidate bits in topological order
+	vector<SigBit> nodes;
+	dict<SigBit, int> node_index;
+	vector<int> node_lit;
+	// signature polarity of a node relative to its canonical signature
+	vector<bool> node_phase;
+	vector<int> node_class;
+	// proven representative of a node and whether it is its complement
+	vector<int> node_root;
+	vector<bool> node_inv;
+	// members of each class in topological order, the first is the representative
+	vector<vector<int>> classes;
+
+	int sat_calls = 0;
+	int proven_nodes = 0;
+	int hashed_nodes = 0;
+	int refuted_nodes = 0;
+	int limited_nodes = 0;
+
+	EquivSweepWorker(Module *module, const SigMap &sigmap, const dict<SigBit, Cell*> &bit2driver,
+			const vector<Cell*> &equiv_cells, EquivSweepConfig cfg) :
+			EquivWorker<EquivSweepConfig>(module, &sigmap, cfg), sigmap(sigmap), bit2driver(bit2driver),
+			equiv_cells(equiv_cells) {}
+
+	static bool is_gate(Cell *cell)
+	{
+		return GateSim::is_gate(cell->type) || cell->type == ID($equiv);
+	}
+
+	// driver of a bit, or nullptr if the bit is a free input of the cones
+	Cell *driver(SigBit bit) const
+	{
+		auto it = bit2driver.find(bit);
+		if (it == bit2driver.end() || it->second->is_builtin_ff())
+			return nullptr;
+		return it->second;
+	}
+
+	// Collects the cells of the input cones of `roots` in topological order
+	// with an iterative depth-first search. Combinational loops are broken at
+	// an arbitrary edge, the SAT model still contains all their cells.
+	void find_cones(const vector<SigBit> &roots)
+	{
+		pool<Cell*> visiting;
+		vector<std::pair<Cell*, bool>> stack;
+
+		for (auto root : roots) {
+			Cell *cell = driver(root);
+			if (cell == nullptr || cone_set.count(cell))
+				continue;
+			stack.push_back({cell, false});
+			while (!stack.empty()) {
+				auto [cell, expanded] = stack.back();
+				stack.pop_back();
+				if (expanded) {
+					visiting.erase(cell);
+					cone_cells.push_back(cell);
+					continue;
+				}
+				if (cone_set.count(cell))
+					continue;
+				cone_set.insert(cell);
+				visiting.insert(cell);
+				stack.push_back({cell, true});
+				for (auto &conn : cell->connections())
+					if (yosys_celltypes.cell_input(cell->type, conn.first))
+						for (auto bit : sigmap(conn.second)) {
+							Cell *next = driver(bit);
+							if (next != nullptr && !cone_set.count(next))
+								stack.push_back({next, false});
+						}
+			}
+		}
+	}
+
+	int value_of(SigBit bit)
+	{
+		auto it = values.find(bit);
+		if (it != values.end())
+			return it->second;
+
+		int v = -1;
+		if (bit.wire == nullptr || driver(bit) == nullptr) {
+			v = sim.add_input(bit);
+			if (bit.wire != nullptr)
+				inputs.push_back(bit);
+		}
+		// bits driven by cells that were not simulated (yet) stay unsupported
+		values[bit] = v;
+		return v;
+	}
+
+	void simulate_cell(Cell *cell)
+	{
+		SigBit y = sigmap(cell->getPort(ID::Y)).as_bit();
+		if (values.count(y))
+			return;
+		values[y] = sim.eval_cell(cell, [&](SigBit input) { return value_of(sigmap(input)); });
+	}
+
+	void add_node(SigBit bit)
+	{
+		if (node_index.count(bit))
+			return;
+		node_index[bit] = GetSize(nodes);
+		nodes.push_back(bit);
+	}
+
+	// Simulates the cones and groups the simulated bits into candidate classes.
+	void build_classes()
+	{
+		add_node(State::S0);
+		add_node(State::S1);
+		int simulated = 0;
+		for (auto cell : cone_cells) {
+			if (!is_gate(cell))
+				continue;
+			simulate_cell(cell);
+			SigBit y = sigmap(cell->getPort(ID::Y)).as_bit();
+			if (values.at(y) >= 0) {
+				add_node(y);
+				simulated++;
+			}
+		}
+
+		dict<vector<uint64_t>, int> class_index;
+		for (int i = 0; i < GetSize(nodes); i++) {
+			const uint64_t *w = sim.words.data() + value_of(nodes[i]);
+			// bit 0 of the first word is the value for the all-zeros pattern
+			bool phase = w[0] & 1;
+			vector<uint64_t> sig(w, w + sim.num_words);
+			if (phase)
+				for (auto &x : sig)
+					x = ~x;
+			auto [it, inserted] = class_index.emplace(sig, GetSize(classes));
+			if (inserted)
+				classes.emplace_back();
+			classes[it->second].push_back(i);
+			node_class.push_back(it->second);
+			node_phase.push_back(phase);
+			node_root.push_back(i);
+			node_inv.push_back(false);
+		}
+
+		int candidates = 0, candidate_classes = 0;
+		for (auto &members : classes)
+			if (GetSize(members) > 1) {
+				candidates += GetSize(members);
+				candidate_classes++;
+			}
+
+		log("Simulated %d of %d cone cells, found %d candidate classes with %d signal bits.\n",
+				simulated, GetSize(cone_cells), candidate_classes, candidates);
+	}
+
+	// Splits every class with members that are not proven yet by the values
+	// of its members for a counterexample, which are found by simulating the
+	// values of the free inputs in the model.
+	void refine(const vector<bool> &model)
+	{
+		GateSim cex_sim(1);
+		dict<SigBit, int> offsets;
+		for (int i = 0; i < GetSize(inputs); i++) {
+			offsets[inputs[i]] = GetSize(cex_sim.words);
+			cex_sim.words.push_back(model[i] ? ~uint64_t(0) : 0);
+		}
+		auto offset_of = [&](SigBit bit) {
+			bit = sigmap(bit);
+			auto it = offsets.find(bit);
+			if (it != offsets.end())
+				return it->second;
+			log_assert(bit.wire == nullptr);
+			return offsets[bit] = cex_sim.add_input(bit);
+		};
+
+		// values of the nodes relative to their canonical signatures
+		vector<bool> node_value(GetSize(nodes));
+		node_value[1] = true != node_phase[1];
+		for (int n = 2; n < GetSize(nodes); n++) {
+			int y = cex_sim.eval_cell(driver(nodes[n]), offset_of);
+			offsets[nodes[n]] = y;
+			node_value[n] = (cex_sim.words[y] & 1) != node_phase[n];
+		}
+
+		int num_classes = GetSize(classes);
+		for (int cls = 0; cls < num_classes; cls++) {
+			if (GetSize(classes[cls]) < 2)
+				continue;
+			vector<int> keep, split;
+			for (auto n : classes[cls]) {
+				// proven members follow their representative
+				bool v = node_value[node_root[n]];
+				if (v == node_value[classes[cls].front()])
+					keep.push_back(n);
+				else
+					split.push_back(n);
+			}
+			if (split.empty())
+				continue;
+			classes[cls].swap(keep);
+			for (auto n : split)
+				node_class[n] = GetSize(classes);
+			classes.push_back(std::move(split));
+		}
+	}
+
+	// the complement of a literal, without stacking negations
+	int negate(int lit) const
+	{
+		if (lit < 0) {
+			ezSAT::OpId op;
+			const vector<int> &args = ez->lookup_expression(lit, op);
+			if (op == ezSAT::OpNot)
+				return args[0];
+		}
+		return ez->NOT(lit);
+	}
+
+	int lit_of(SigBit bit)
+	{
+		auto it = bit_lit.find(bit);
+		if (it != bit_lit.end())
+			return it->second;
+		// a gate output that is not encoded yet, on a combinational loop
+		Cell *cell = driver(bit);
+		if (cell != nullptr && is_gate(cell))
+			linked.insert(bit);
+		return satgen.importSigBit(bit, 1);
+	}
+
+	// Encodes a gate as an expression of the literals of its inputs.
+	int encode_gate(Cell *cell)
+	{
+		int a = 0, b = 0, c = 0, d = 0;
+		for (auto &conn : cell->connections()) {
+			if (conn.first == ID::Y)
+				continue;
+			int lit = lit_of(sigmap(conn.second).as_bit());
+			if (conn.first == ID::A) a = lit;
+			else if (conn.first == ID::B) b = lit;
+			else if (conn.first.in(ID::C, ID::S)) c = lit;
+			else if (conn.first == ID::D) d = lit;
+		}
+
+		IdString type = cell->type;
+		if (type.in(ID($_BUF_), ID($equiv))) return a;
+		if (type == ID($_NOT_)) return negate(a);
+		if (type == ID($_AND_)) return ez->AND(a, b);
+		if (type == ID($_NAND_)) return negate(ez->AND(a, b));
+		if (type == ID($_OR_)) return ez->OR(a, b);
+		if (type == ID($_NOR_)) return negate(ez->OR(a, b));
+		if (type == ID($_XOR_)) return ez->XOR(a, b);
+		if (type == ID($_XNOR_)) return negate(ez->XOR(a, b));
+		if (type == ID($_ANDNOT_)) return ez->AND(a, negate(b));
+		if (type == ID($_ORNOT_)) return ez->OR(a, negate(b));
+		if (type == ID($_MUX_)) return ez->ITE(c, b, a);
+		if (type == ID($_NMUX_)) return negate(ez->ITE(c, b, a));
+		if (type == ID($_AOI3_)) return negate(ez->OR(ez->AND(a, b), c));
+		if (type == ID($_OAI3_)) return negate(ez->AND(ez->OR(a, b), c));
+		if (type == ID($_AOI4_)) return negate(ez->OR(ez->AND(a, b), ez->AND(c, d)));
+		if (type == ID($_OAI4_)) return negate(ez->AND(ez->OR(a, b), ez->OR(c, d)));
+		log_abort();
+	}
+
+	// Checks a candidate against the representative of its class until it is
+	// proven or becomes a representative itself, and returns the literal that
+	// replaces it in its fanout.
+	int sweep_node(int n, int lit)
+	{
+		node_lit[n] = lit;
+		while (true)
+		{
+			int r = classes[node_class[n]].front();
+			if (r == n)
+				return lit;
+
+			bool inv = node_phase[n] != node_phase[r];
+			int lit_r = inv ? negate(node_lit[r]) : node_lit[r];
+
+			bool proven = lit == lit_r;
+			if (proven) {
+				hashed_nodes++;
+			} else {
+				vector<bool> model;
+				if (cfg.prop_limit > 0)
+					ez->setSolverPropLimit(cfg.prop_limit);
+				sat_calls++;
+				bool sat = ez->solve(input_lits, model, ez->XOR(lit_r, lit));
+
+				if (!sat && cfg.prop_limit > 0 && ez->getSolverPropLimitStatus()) {
+					// give up on this node, it stays a representative of its own
+					auto &members = classes[node_class[n]];
+					members.erase(std::find(members.begin(), members.end(), n));
+					node_class[n] = GetSize(classes);
+					classes.push_back({n});
+					limited_nodes++;
+					return lit;
+				}
+
+				if (sat) {
+					refuted_nodes++;
+					refine(model);
+					log_assert(node_class[n] != node_class[r]);
+					continue;
+				}
+			}
+
+			node_root[n] = r;
+			node_inv[n] = inv;
+			proven_nodes++;
+			if (cfg.verbose)
+				log("  %s %s%s equal to %s.\n", proven ? "Merged" : "Proved", inv ? "complement of " : "",
+						log_signal(nodes[n]), log_signal(nodes[r]));
+			return lit_r;
+		}
+	}
+
+	void sweep()
+	{
+		for (auto bit : inputs)
+			input_lits.push_back(satgen.importSigBit(bit, 1));
+
+		node_lit.resize(GetSize(nodes));
+		node_lit[0] = ez->CONST_FALSE;
+		node_lit[1] = ez->CONST_TRUE;
+
+		for (auto cell : cone_cells)
+		{
+			if (!is_gate(cell))
+				continue;
+			SigBit y = sigmap(cell->getPort(ID::Y)).as_bit();
+			int lit = encode_gate(cell);
+			auto it = node_index.find(y);
+			if (it != node_index.end())
+				lit = sweep_node(it->second, lit);
+			bit_lit[y] = lit;
+			if (linked.count(y))
+				ez->assume(ez->IFF(satgen.importSigBit(y, 1), lit));
+		}
+		if (cfg.prop_limit > 0)
+			ez->setSolverPropLimit(0);
+
+		log("Proved %d (%d by structural hashing) and refuted %d candidate equivalences with %d SAT calls",
+				proven_nodes, hashed_nodes, refuted_nodes, sat_calls);
+		if (limited_nodes > 0)
+			log(", %d checks reached the propagation limit", limited_nodes);
+		log(".\n");
+	}
+
+	// whether simulation shows that two bits differ
+	bool sim_differs(SigBit a, SigBit b) const
+	{
+		auto it_a = values.find(a), it_b = values.find(b);
+		if (it_a == values.end() || it_b == values.end() || it_a->second < 0 || it_b->second < 0)
+			return false;
+		auto words = sim.words.begin();
+		return !std::equal(words + it_a->second, words + it_a->second + sim.num_words, words + it_b->second);
+	}
+
+	int run()
+	{
+		vector<SigBit> roots;
+		for (auto cell : equiv_cells) {
+			roots.push_back(sigmap(cell->getPort(ID::A)).as_bit());
+			roots.push_back(sigmap(cell->getPort(ID::B)).as_bit());
+		}
+		if (cfg.set_assumes)
+			for (auto cell : module->cells())
+				if (cell->type == ID($assume)) {
+					roots.push_back(sigmap(cell->getPort(ID::A)).as_bit());
+					roots.push_back(sigmap(cell->getPort(ID::EN)).as_bit());
+					cone_cells.push_back(cell);
+					cone_set.insert(cell);
+				}
+		find_cones(roots);
+		build_classes();
+
+		// gates are encoded by sweep(), all other cells are imported here
+		for (auto cell : cone_cells) {
+			if (is_gate(cell))
+				continue;
+			for (auto &conn : cell->connections())
+				if (yosys_celltypes.cell_input(cell->type, conn.first))
+					for (auto bit : sigmap(conn.second)) {
+						Cell *next = driver(bit);
+						if (next != nullptr && is_gate(next))
+							linked.insert(bit);
+					}
+			if (!satgen.importCell(cell, 1))
+				report_missing_model(cfg.ignore_unknown_cells, cell);
+		}
+
+		if (cfg.set_assumes) {
+			RTLIL::SigSpec assumes_a, assumes_en;
+			satgen.getAssumes(assumes_a, assumes_en, 1);
+			for (int i = 0; i < GetSize(assumes_a); i++)
+				log("Import constraint from assume cell: %s when %s.\n", log_signal(assumes_a[i]), log_signal(assumes_en[i]));
+			ez->assume(satgen.importAssumes(1));
+		}
+
+		sweep();
+
+		int swept = 0, solved = 0;
+		vector<Cell*> proven;
+		for (auto cell : equiv_cells)
+		{
+			SigBit bit_a = sigmap(cell->getPort(ID::A)).as_bit();
+			SigBit bit_b = sigmap(cell->getPort(ID::B)).as_bit();
+
+			int lit_a = lit_of(bit_a);
+			int lit_b = lit_of(bit_b);
+			if (lit_a == lit_b) {
+				swept++;
+			} else {
+				if (!cfg.set_assumes && sim_differs(bit_a, bit_b))
+					// refuted by simulation, there are no assumptions the patterns could violate
+					continue;
+				sat_calls++;
+				if (ez->solve(ez->XOR(lit_a, lit_b)))
+					continue;
+				solved++;
+			}
+			if (cfg.verbose)
+				log("  Proved $equiv cell %s: %s = %s\n", cell, log_signal(bit_a), log_signal(bit_b));
+			proven.push_back(cell);
+		}
+
+		for (auto cell : proven)
+			cell->setPort(ID::B, cell->getPort(ID::A));
+
+		log("Proved %d $equiv cells by sweeping and %d with a final SAT call.\n", swept, solved);
+		return GetSize(proven);
+	}
+};
+
+struct EquivSweepPass : public Pass {
+	EquivSweepPass() : Pass("equiv_sweep", "try proving $equiv cells with SAT sweeping") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    equiv_sweep [options] [selection]\n");
+		log("\n");
+		log("This command tries to prove $equiv cells using SAT sweeping: all internal\n");
+		log("signals in the combinational input cones of the unproven $equiv cells are\n");
+		log("simulated with random patterns, and signals with equal or complementary\n");
+		log("simulation results are checked for equivalence in topological order with a\n");
+		log("single incremental SAT solver. A proven signal is replaced by its equivalent\n");
+		log("in the logic it drives, which is structurally hashed, so that logic made\n");
+		log("identical by this is merged without further SAT calls. Counterexamples refine\n");
+		log("the candidates. The two sides of each $equiv cell are then proven equal by the\n");
+		log("sweep or by a final SAT call.\n");
+		log("\n");
+		log("Outputs of flip-flops are treated as free inputs, like with 'equiv_simple'\n");
+		log("without -seq. Undef states are not modelled.\n");
+		log("\n");
+		log("    -set-assumes\n");
+		log("        set all assumptions provided via $assume cells\n");
+		log("\n");
+		log("    -ignore-unknown-cells\n");
+		log("        ignore all cells that can not be matched to a SAT model\n");
+		log("\n");
+		log("    -prop-limit <N>\n");
+		log("        give up on a candidate equivalence after N propagations of the SAT\n");
+		log("        solver (default: no limit)\n");
+		log("\n");
+		log("    -v\n");
+		log("        verbose output\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, Design *design) override
+	{
+		EquivSweepConfig cfg;
+		int success_counter = 0;
+
+		log_header(design, "Executing EQUIV_SWEEP pass.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (cfg.parse(args, argidx))
+				continue;
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		CellTypes ct;
+		ct.setup_internals();
+		ct.setup_stdcells();
+		ct.setup_internals_ff();
+		ct.setup_stdcells_mem();
+
+		for (auto module : design->selected_modules())
+		{
+			SigMap sigmap(module);
+			dict<SigBit, Cell*> bit2driver;
+			vector<Cell*> equiv_cells;
+
+			for (auto cell : module->selected_cells())
+				if (cell->type == ID($equiv) && cell->getPort(ID::A) != cell->getPort(ID::B))
+					equiv_cells.push_back(cell);
+
+			if (equiv_cells.empty())
+				continue;
+
+			log("Found %d unproven $equiv cells in %s.\n", GetSize(equiv_cells), module);
+
+			for (auto cell : module->cells()) {
+				if (!ct.cell_known(cell->type))
+					continue;
+				for (auto &conn : cell->connections())
+					if (yosys_celltypes.cell_output(cell->type, conn.first))
+						for (auto bit : sigmap(conn.second))
+							bit2driver[bit] = cell;
+			}
+
+			EquivSweepWorker worker(module, sigmap, bit2driver, equiv_cells, cfg);
+			success_counter += worker.run();
+		}
+
+		log("Proved %d previously unproven $equiv cells.\n", success_counter);
+	}
+} EquivSweepPass;
+
+PRIVATE_NAMESPACE_END
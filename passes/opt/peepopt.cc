@@ -105,16 +105,18 @@ struct PeepoptPass : public Pass {
 
 		for (auto module : design->selected_modules())
 		{
+			// the index follows the rewrites through a monitor, so that each
+			// iteration only re-indexes the cells touched by the last one
+			pmgen_module_index index(module);
+			peepopt_pm pm(index);
+			pm.setup();
+
 			did_something = true;
 
 			while (did_something)
 			{
 				did_something = false;
 
-				peepopt_pm pm(module);
-
-				pm.setup(module->selected_cells());
-
 				if (formalclk) {
 					pm.run_formal_clockgateff();
 				} else {
@@ -359,13 +359,186 @@ with open(outfile, "w") as f:
         print("YOSYS_NAMESPACE_BEGIN", file=f)
         print("", file=f)
 
-    print("struct {}_pm {{".format(prefix), file=f)
+    print("#ifndef PMGEN_MODULE_INDEX", file=f)
+    print("#define PMGEN_MODULE_INDEX", file=f)
+    print("// Module-wide part of the matcher indices: the signal map and the users of", file=f)
+    print("// each signal bit. Matchers constructed from the same instance share it. When", file=f)
+    print("// monitored, changes to the module are recorded and applied by update(), and", file=f)
+    print("// the changed cells are logged so that each matcher can catch up its own indices.", file=f)
+    print("//", file=f)
+    print("// The monitor sees every change made through Cell::setPort(), Cell::unsetPort(),", file=f)
+    print("// Module::connect() and Module::remove(). Any other change a matcher depends on,", file=f)
+    print("// like the type, a parameter or an attribute of a cell, or a direct edit of the", file=f)
+    print("// connections of a cell or module, must be reported with changed(cell) before", file=f)
+    print("// the next run of a matcher, otherwise the matcher uses stale index entries.", file=f)
+    print("// Cells re-indexed by a matcher are added to the indices sorted by name, so the", file=f)
+    print("// order of the matches within a run can differ from a fresh matcher.", file=f)
+    print("//", file=f)
+    print("// Setting the scratchpad variable pmgen.full_rebuild rebuilds the index and all", file=f)
+    print("// matcher indices before every run, for comparing against the incremental update.", file=f)
+    print("struct pmgen_module_index : RTLIL::Monitor {", file=f)
+    print("  struct pending_t {", file=f)
+    print("    Cell *cell;", file=f)
+    print("    IdString name;", file=f)
+    print("    SigSpec old_sig, new_sig;", file=f)
+    print("  };", file=f)
+    print("", file=f)
     print("  Module *module;", file=f)
     print("  SigMap sigmap;", file=f)
+    print("  dict<SigBit, pool<Cell*>> sigusers;", file=f)
+    print("  vector<pending_t> pending;", file=f)
+    print("  vector<std::pair<Cell*, bool>> changes;", file=f)
+    print("  bool monitored;", file=f)
+    print("  bool need_rebuild;", file=f)
+    print("  bool full_rebuild;", file=f)
+    print("  int epoch;", file=f)
+    print("", file=f)
+    print("  pmgen_module_index(Module *module, bool monitored = true) :", file=f)
+    print("      module(module), monitored(monitored), need_rebuild(false), epoch(0) {", file=f)
+    print("    full_rebuild = module->design != nullptr && module->design->scratchpad_get_bool(\"pmgen.full_rebuild\");", file=f)
+    print("    build();", file=f)
+    print("    if (monitored)", file=f)
+    print("      module->monitors.insert(this);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  ~pmgen_module_index() {", file=f)
+    print("    if (monitored)", file=f)
+    print("      module->monitors.erase(this);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void build() {", file=f)
+    print("    sigmap.set(module);", file=f)
+    print("    sigusers.clear();", file=f)
+    print("    for (auto port : module->ports)", file=f)
+    print("      add_siguser(module->wire(port), nullptr);", file=f)
+    print("    for (auto cell : module->cells())", file=f)
+    print("      for (auto &conn : cell->connections())", file=f)
+    print("        add_siguser(conn.second, cell);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void add_siguser(const SigSpec &sig, Cell *cell) {", file=f)
+    print("    for (auto bit : sigmap(sig)) {", file=f)
+    print("      if (bit.wire == nullptr) continue;", file=f)
+    print("      sigusers[bit].insert(cell);", file=f)
+    print("    }", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  // for changes the monitor does not see, see above", file=f)
+    print("  void changed(Cell *cell) {", file=f)
+    print("    pending.push_back({cell, cell->name, SigSpec(), SigSpec()});", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void notify_connect(Cell *cell, IdString, const SigSpec &old_sig, const SigSpec &sig) override {", file=f)
+    print("    if (cell->module == module)", file=f)
+    print("      pending.push_back({cell, cell->name, old_sig, sig});", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void notify_connect(Module *mod, const SigSig &conn) override {", file=f)
+    print("    if (mod == module)", file=f)
+    print("      pending.push_back({nullptr, IdString(), conn.first, conn.second});", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void notify_connect(Module *mod, const vector<SigSig>&) override {", file=f)
+    print("    if (mod == module)", file=f)
+    print("      need_rebuild = true;", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void notify_blackout(Module *mod) override {", file=f)
+    print("    if (mod == module)", file=f)
+    print("      need_rebuild = true;", file=f)
+    print("  }", file=f)
+    print("", file=f)
+    print("  void update() {", file=f)
+    print("    if (need_rebuild || full_rebuild) {", file=f)
+    print("      build();", file=f)
+    print("      pending.clear();", file=f)
+    print("      changes.clear();", file=f)
+    print("      need_rebuild = false;", file=f)
+    print("      epoch++;", file=f)
+    print("      return;", file=f)
+    print("    }", file=f)
+    print("", file=f)
+    print("    // cells are only dereferenced through the names recorded while they were alive", file=f)
+    print("    dict<Cell*, bool> alive;", file=f)
+    print("    for (auto &it : pending)", file=f)
+    print("      if (it.cell != nullptr)", file=f)
+    print("        alive[it.cell] = module->cell(it.name) == it.cell;", file=f)
+    print("", file=f)
+    print("    auto changed_users = [&](SigBit bit) {", file=f)
+    print("      auto users = sigusers.find(bit);", file=f)
+    print("      if (users == sigusers.end()) return;", file=f)
+    print("      for (auto user : users->second)", file=f)
+    print("        if (user != nullptr)", file=f)
+    print("          changes.push_back({user, alive.at(user, true)});", file=f)
+    print("    };", file=f)
+    print("", file=f)
+    print("    for (auto &it : pending)", file=f)
+    print("    {", file=f)
+    print("      if (it.cell == nullptr) {", file=f)
+    print("        pool<SigBit> bits;", file=f)
+    print("        for (auto bit : sigmap(it.old_sig))", file=f)
+    print("          if (bit.wire != nullptr) bits.insert(bit);", file=f)
+    print("        for (auto bit : sigmap(it.new_sig))", file=f)
+    print("          if (bit.wire != nullptr) bits.insert(bit);", file=f)
+    print("        for (auto bit : bits)", file=f)
+    print("          changed_users(bit);", file=f)
+    print("        sigmap.add(it.old_sig, it.new_sig);", file=f)
+    print("        for (auto bit : bits) {", file=f)
+    print("          SigBit new_bit = sigmap(bit);", file=f)
+    print("          auto users = sigusers.find(bit);", file=f)
+    print("          if (new_bit == bit || users == sigusers.end()) continue;", file=f)
+    print("          pool<Cell*> moved;", file=f)
+    print("          moved.swap(users->second);", file=f)
+    print("          sigusers.erase(users);", file=f)
+    print("          if (new_bit.wire != nullptr)", file=f)
+    print("            for (auto user : moved)", file=f)
+    print("              sigusers[new_bit].insert(user);", file=f)
+    print("        }", file=f)
+    print("        continue;", file=f)
+    print("      }", file=f)
+    print("", file=f)
+    print("      bool cell_alive = alive.at(it.cell);", file=f)
+    print("      pool<SigBit> cell_bits;", file=f)
+    print("      if (cell_alive)", file=f)
+    print("        for (auto &conn : it.cell->connections())", file=f)
+    print("          for (auto bit : sigmap(conn.second))", file=f)
+    print("            cell_bits.insert(bit);", file=f)
+    print("", file=f)
+    print("      changes.push_back({it.cell, cell_alive});", file=f)
+    print("      for (auto bit : sigmap(it.old_sig)) {", file=f)
+    print("        if (bit.wire == nullptr || cell_bits.count(bit)) continue;", file=f)
+    print("        auto users = sigusers.find(bit);", file=f)
+    print("        if (users == sigusers.end()) continue;", file=f)
+    print("        users->second.erase(it.cell);", file=f)
+    print("        changed_users(bit);", file=f)
+    print("        if (users->second.empty())", file=f)
+    print("          sigusers.erase(users);", file=f)
+    print("      }", file=f)
+    print("      for (auto bit : sigmap(it.new_sig)) {", file=f)
+    print("        if (bit.wire == nullptr || !cell_bits.count(bit)) continue;", file=f)
+    print("        changed_users(bit);", file=f)
+    print("        sigusers[bit].insert(it.cell);", file=f)
+    print("      }", file=f)
+    print("    }", file=f)
+    print("", file=f)
+    print("    pending.clear();", file=f)
+    print("  }", file=f)
+    print("};", file=f)
+    print("#endif", file=f)
+    print("", file=f)
+
+    print("struct {}_pm {{".format(prefix), file=f)
+    print("  Module *module;", file=f)
+    print("  std::unique_ptr<pmgen_module_index> private_index;", file=f)
+    print("  pmgen_module_index &module_index;", file=f)
+    print("  SigMap &sigmap;", file=f)
+    print("  dict<SigBit, pool<Cell*>> &sigusers;", file=f)
     print("  std::function<void()> on_accept;", file=f)
     print("  bool setup_done;", file=f)
     print("  bool generate_mode;", file=f)
     print("  int accept_cnt;", file=f)
+    print("  int index_epoch;", file=f)
+    print("  int index_changes;", file=f)
     print("", file=f)
 
     print("  uint32_t rngseed;", file=f)
@@ -394,7 +567,7 @@ with open(outfile, "w") as f:
             print("  typedef std::tuple<{}> index_{}_key_type;".format(", ".join(index_types), index), file=f)
             print("  typedef std::tuple<{}> index_{}_value_type;".format(", ".join(value_types), index), file=f)
             print("  dict<index_{}_key_type, vector<index_{}_value_type>> index_{};".format(index, index, index), file=f)
-    print("  dict<SigBit, pool<Cell*>> sigusers;", file=f)
+            print("  dict<Cell*, vector<index_{}_key_type>> index_{}_cells;".format(index, index), file=f)
     print("  pool<Cell*> blacklist_cells;", file=f)
     print("  pool<Cell*> autoremove_cells;", file=f)
     print("  dict<Cell*,int> rollback_cache;", file=f)
@@ -423,10 +596,7 @@ with open(outfile, "w") as f:
     print("", file=f)
 
     print("  void add_siguser(const SigSpec &sig, Cell *cell) {", file=f)
-    print("    for (auto bit : sigmap(sig)) {", file=f)
-    print("      if (bit.wire == nullptr) continue;", file=f)
-    print("      sigusers[bit].insert(cell);", file=f)
-    print("    }", file=f)
+    print("    module_index.add_siguser(sig, cell);", file=f)
     print("  }", file=f)
     print("", file=f)
 
@@ -483,13 +653,20 @@ with open(outfile, "w") as f:
     print("", file=f)
 
     print("  {}_pm(Module *module, const vector<Cell*> &cells) :".format(prefix), file=f)
-    print("      module(module), sigmap(module), setup_done(false), generate_mode(false), rngseed(12345678) {", file=f)
+    print("      {}_pm(module) {{".format(prefix), file=f)
     print("    setup(cells);", file=f)
     print("  }", file=f)
     print("", file=f)
 
     print("  {}_pm(Module *module) :".format(prefix), file=f)
-    print("      module(module), sigmap(module), setup_done(false), generate_mode(false), rngseed(12345678) {", file=f)
+    print("      module(module), private_index(new pmgen_module_index(module, false)), module_index(*private_index),", file=f)
+    print("      sigmap(module_index.sigmap), sigusers(module_index.sigusers), setup_done(false), generate_mode(false), rngseed(12345678) {", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  {}_pm(pmgen_module_index &module_index) :".format(prefix), file=f)
+    print("      module(module_index.module), module_index(module_index),", file=f)
+    print("      sigmap(module_index.sigmap), sigusers(module_index.sigusers), setup_done(false), generate_mode(false), rngseed(12345678) {", file=f)
     print("  }", file=f)
     print("", file=f)
 
@@ -503,12 +680,20 @@ with open(outfile, "w") as f:
     current_pattern = None
     print("    log_assert(!setup_done);", file=f)
     print("    setup_done = true;", file=f)
-    print("    for (auto port : module->ports)", file=f)
-    print("      add_siguser(module->wire(port), nullptr);", file=f)
-    print("    for (auto cell : module->cells())", file=f)
-    print("      for (auto &conn : cell->connections())", file=f)
-    print("        add_siguser(conn.second, cell);", file=f)
-    print("    for (auto cell : cells) {", file=f)
+    print("    module_index.update();", file=f)
+    print("    index_epoch = module_index.epoch;", file=f)
+    print("    index_changes = GetSize(module_index.changes);", file=f)
+    print("    for (auto cell : cells)", file=f)
+    print("      index_cell(cell);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void setup() {", file=f)
+    print("    setup(module->selected_cells());", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void index_cell(Cell *cell) {", file=f)
 
     for index in range(len(blocks)):
         block = blocks[index]
@@ -541,11 +726,68 @@ with open(outfile, "w") as f:
             for field, entry in enumerate(block["index"]):
                 print("        std::get<{}>(key) = {};".format(field, entry[1]), file=f)
             print("        index_{}[key].push_back(value);".format(index), file=f)
+            print("        if (module_index.monitored)", file=f)
+            print("          index_{}_cells[cell].push_back(key);".format(index), file=f)
             for i in range(loopcnt):
                 print("        }", file=f)
             print("      } while (0);", file=f)
 
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void unindex_cell(Cell *cell) {", file=f)
+    for index in range(len(blocks)):
+        block = blocks[index]
+        if block["type"] == "match":
+            print("    do {", file=f)
+            print("      auto keys_ptr = index_{}_cells.find(cell);".format(index), file=f)
+            print("      if (keys_ptr == index_{}_cells.end()) break;".format(index), file=f)
+            print("      for (auto &key : keys_ptr->second) {", file=f)
+            print("        auto cells_ptr = index_{}.find(key);".format(index), file=f)
+            print("        if (cells_ptr == index_{}.end()) continue;".format(index), file=f)
+            print("        vector<index_{}_value_type> &cells = cells_ptr->second;".format(index), file=f)
+            print("        cells.erase(std::remove_if(cells.begin(), cells.end(), [&](const index_{}_value_type &value) {{ return std::get<0>(value) == cell; }}), cells.end());".format(index), file=f)
+            print("        if (cells.empty())", file=f)
+            print("          index_{}.erase(cells_ptr);".format(index), file=f)
+            print("      }", file=f)
+            print("      index_{}_cells.erase(keys_ptr);".format(index), file=f)
+            print("    } while (0);", file=f)
+    print("  }", file=f)
+    print("", file=f)
+
+    print("  void update() {", file=f)
+    print("    log_assert(setup_done);", file=f)
+    print("    log_assert(module_index.monitored);", file=f)
+    print("    for (auto cell : autoremove_cells)", file=f)
+    print("      module->remove(cell);", file=f)
+    print("    autoremove_cells.clear();", file=f)
+    print("    blacklist_cells.clear();", file=f)
+    print("    module_index.update();", file=f)
+    print("    if (index_epoch != module_index.epoch) {", file=f)
+    for index in range(len(blocks)):
+        block = blocks[index]
+        if block["type"] == "match":
+            print("      index_{}.clear();".format(index), file=f)
+            print("      index_{}_cells.clear();".format(index), file=f)
+    print("      index_epoch = module_index.epoch;", file=f)
+    print("      index_changes = GetSize(module_index.changes);", file=f)
+    print("      for (auto cell : module->selected_cells())", file=f)
+    print("        index_cell(cell);", file=f)
+    print("      return;", file=f)
+    print("    }", file=f)
+    print("    dict<Cell*, bool> changed;", file=f)
+    print("    for (int i = index_changes; i < GetSize(module_index.changes); i++)", file=f)
+    print("      changed[module_index.changes[i].first] = module_index.changes[i].second;", file=f)
+    print("    index_changes = GetSize(module_index.changes);", file=f)
+    print("    vector<Cell*> reindex;", file=f)
+    print("    for (auto &it : changed) {", file=f)
+    print("      unindex_cell(it.first);", file=f)
+    print("      if (it.second && module->selected(it.first))", file=f)
+    print("        reindex.push_back(it.first);", file=f)
     print("    }", file=f)
+    print("    std::sort(reindex.begin(), reindex.end(), RTLIL::sort_by_name_id<Cell>());", file=f)
+    print("    for (auto cell : reindex)", file=f)
+    print("      index_cell(cell);", file=f)
     print("  }", file=f)
     print("", file=f)
 
@@ -558,6 +800,8 @@ with open(outfile, "w") as f:
     for current_pattern in sorted(patterns.keys()):
         print("  int run_{}(std::function<void()> on_accept_f) {{".format(current_pattern), file=f)
         print("    log_assert(setup_done);", file=f)
+        print("    if (module_index.monitored)", file=f)
+        print("      update();", file=f)
         print("    accept_cnt = 0;", file=f)
         print("    on_accept = on_accept_f;", file=f)
         print("    rollback = 0;", file=f)
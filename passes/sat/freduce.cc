@@ -21,14 +21,16 @@
 #include "kernel/consteval.h"
 #include "kernel/sigtools.h"
 #include "kernel/satgen.h"
+#include "kernel/threading.h"
+#include "kernel/gatesim.h"
 #include "kernel/yosys.h"
 #include "kernel/log_help.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-bool inv_mode;
-int verbose_level, reduce_counter, reduce_stop_at;
+bool inv_mode, sim_mode;
+int verbose_level, reduce_counter, reduce_stop_at, num_threads;
 typedef std::map<RTLIL::SigBit, std::pair<RTLIL::Cell*, std::set<RTLIL::SigBit>>> drivers_t;
 std::string dump_prefix;
 
@@ -64,7 +66,121 @@ struct CountBitUsage
 	}
 };
 
-struct FindReducedInputs
+// Base of the SAT workers. When running on a worker thread, messages are
+// collected in `logs` and printed by the main thread in the order of a serial
+// run. A deferred error sets `failed`, after which the worker stops early.
+struct FreduceLogger
+{
+	DeferredLogs *logs = nullptr;
+	bool failed = false;
+
+	template <typename... Args>
+	void log(FmtString<TypeIdentity<Args>...> fmt, const Args &... args) const
+	{
+		if (logs)
+			logs->log(fmt, args...);
+		else
+			YOSYS_NAMESPACE_PREFIX log(fmt, args...);
+	}
+
+	template <typename... Args>
+	void log_error(FmtString<TypeIdentity<Args>...> fmt, const Args &... args)
+	{
+		if (logs == nullptr)
+			YOSYS_NAMESPACE_PREFIX log_error(fmt, args...);
+		logs->log_error(fmt, args...);
+		failed = true;
+	}
+};
+
+// Bit-parallel simulation of the analyzed logic with random input patterns,
+// used to compute a signature for each signal bit. Equivalent bits have the
+// same signature, up to inversion, so bits with different signatures never
+// need to be compared using SAT.
+//
+// Bits without a driver are the inputs of the simulation. Bits driven by other
+// cells than fine-grained gates, constant x bits, and bits depending on any
+// of those are not simulated, as they may be undefined.
+struct FreduceSimulator : GateSim
+{
+	const SigMap &sigmap;
+	const drivers_t &drivers;
+
+	// offset of the simulated words of each bit in `words`, -1 if unsupported
+	dict<RTLIL::SigBit, int> values;
+	pool<RTLIL::SigBit> visiting;
+
+	FreduceSimulator(const SigMap &sigmap, const drivers_t &drivers) : GateSim(4), sigmap(sigmap), drivers(drivers) { }
+
+	int simulate(RTLIL::SigBit root)
+	{
+		auto found = values.find(root);
+		if (found != values.end())
+			return found->second;
+
+		std::vector<std::pair<RTLIL::SigBit, bool>> stack = {{root, false}};
+		while (!stack.empty())
+		{
+			auto [bit, expanded] = stack.back();
+			if (values.count(bit)) {
+				if (expanded)
+					visiting.erase(bit);
+				stack.pop_back();
+				continue;
+			}
+
+			auto drv = drivers.find(bit);
+			if (bit.wire == NULL || drv == drivers.end()) {
+				bool undef = bit.wire == NULL && bit != RTLIL::State::S0 && bit != RTLIL::State::S1;
+				values[bit] = undef ? -1 : add_input(bit);
+				stack.pop_back();
+				continue;
+			}
+
+			RTLIL::Cell *cell = drv->second.first;
+			if (!is_gate(cell->type) || (!expanded && visiting.count(bit))) {
+				// unsupported cell or logic loop
+				values[bit] = -1;
+				stack.pop_back();
+				continue;
+			}
+
+			if (!expanded) {
+				visiting.insert(bit);
+				stack.back().second = true;
+				for (auto &conn : cell->connections())
+					if (conn.first != ID::Y) {
+						RTLIL::SigBit input = sigmap(conn.second).as_bit();
+						if (!values.count(input))
+							stack.push_back({input, false});
+					}
+				continue;
+			}
+
+			visiting.erase(bit);
+			values[bit] = eval_cell(cell, [&](RTLIL::SigBit input) { return values.at(sigmap(input)); });
+			stack.pop_back();
+		}
+
+		return values.at(root);
+	}
+
+	// Simulated values of the bit, inverted if the first pattern is 1. Returns
+	// false if the bit is not simulated.
+	bool signature(RTLIL::SigBit bit, std::vector<uint64_t> &sig)
+	{
+		int offset = simulate(bit);
+		if (offset < 0)
+			return false;
+		uint64_t mask = (words[offset] & 1) ? ~uint64_t(0) : 0;
+		sig.clear();
+		for (int i = 0; i < num_words; i++)
+			sig.push_back(words[offset+i] ^ mask);
+		return true;
+	}
+};
+
+struct FindReducedInputs : FreduceLogger
 {
 	SigMap &sigmap;
 	drivers_t &drivers;
@@ -76,10 +192,12 @@ struct FindReducedInputs
 	std::map<RTLIL::SigBit, int> sat_pi;
 	std::vector<int> sat_pi_uniq_bitvec;
 
-	FindReducedInputs(SigMap &sigmap, drivers_t &drivers) :
+	FindReducedInputs(SigMap &sigmap, drivers_t &drivers, DeferredLogs *logs = nullptr) :
 			sigmap(sigmap), drivers(drivers), satgen(ez.get(), &sigmap)
 	{
+		this->logs = logs;
 		satgen.model_undef = true;
+		satgen.cnf_templates = true;
 	}
 
 	int get_bits(int val)
@@ -138,8 +256,10 @@ struct FindReducedInputs
 			std::pair<RTLIL::Cell*, std::set<RTLIL::SigBit>> &drv = drivers.at(out);
 			if (ez_cells.count(drv.first) == 0) {
 				satgen.setContext(&sigmap, "A");
-				if (!satgen.importCell(drv.first))
+				if (!satgen.importCell(drv.first)) {
 					log_error("Can't create SAT model for cell %s (%s)!\n", drv.first, drv.first->type.unescape());
+					return;
+				}
 				satgen.setContext(&sigmap, "B");
 				if (!satgen.importCell(drv.first))
 					log_abort();
@@ -169,6 +289,9 @@ struct FindReducedInputs
 		std::vector<RTLIL::SigBit> pi;
 		register_cone(pi, output);
 
+		if (failed)
+			return;
+
 		if (verbose_level >= 1)
 			log("         Found %d input signals and %d cells.\n", int(pi.size()), int(ez_cells.size()));
 
@@ -220,7 +343,7 @@ struct FindReducedInputs
 	}
 };
 
-struct PerformReduction
+struct PerformReduction : FreduceLogger
 {
 	SigMap &sigmap;
 	drivers_t &drivers;
@@ -248,6 +371,7 @@ struct PerformReduction
 			for (auto loop_bit : recursion_guard)
 				loop_signals += string(" ") + log_signal(loop_bit);
 			log_error("Found logic loop:%s\n", loop_signals);
+			return 0;
 		}
 
 		recursion_guard.insert(out);
@@ -274,10 +398,13 @@ struct PerformReduction
 		return sigdepth.at(out);
 	}
 
-	PerformReduction(SigMap &sigmap, drivers_t &drivers, std::set<std::pair<RTLIL::SigBit, RTLIL::SigBit>> &inv_pairs, std::vector<RTLIL::SigBit> &bits, int cone_size) :
+	PerformReduction(SigMap &sigmap, drivers_t &drivers, std::set<std::pair<RTLIL::SigBit, RTLIL::SigBit>> &inv_pairs, std::vector<RTLIL::SigBit> &bits, int cone_size,
+			DeferredLogs *logs = nullptr) :
 			sigmap(sigmap), drivers(drivers), inv_pairs(inv_pairs), satgen(ez.get(), &sigmap), out_bits(bits), cone_size(cone_size)
 	{
+		this->logs = logs;
 		satgen.model_undef = true;
+		satgen.cnf_templates = true;
 
 		std::set<RTLIL::Cell*> celldone;
 		std::map<RTLIL::SigBit, int> sigdepth;
@@ -288,9 +415,14 @@ struct PerformReduction
 			sat_def.push_back(ez->NOT(satgen.importUndefSigSpec(bit).front()));
 		}
 
+		if (failed)
+			return;
+
 		if (inv_mode && cone_size > 0) {
-			if (!ez->solve(sat_out, out_inverted, ez->expression(ezSAT::OpAnd, sat_def)))
+			if (!ez->solve(sat_out, out_inverted, ez->expression(ezSAT::OpAnd, sat_def))) {
 				log_error("Solving for initial model failed!\n");
+				return;
+			}
 			for (size_t i = 0; i < sat_out.size(); i++)
 				if (out_inverted.at(i))
 					sat_out[i] = ez->NOT(sat_out[i]);
@@ -300,6 +432,9 @@ struct PerformReduction
 
 	void analyze_const(std::vector<std::vector<equiv_bit_t>> &results, int idx)
 	{
+		if (failed)
+			return;
+
 		if (verbose_level == 1)
 			log("    Finding const value for %s.\n", log_signal(out_bits[idx]));
 
@@ -485,6 +620,9 @@ struct PerformReduction
 
 	void analyze(std::vector<std::vector<equiv_bit_t>> &results, int perc)
 	{
+		if (failed)
+			return;
+
 		std::vector<int> bucket;
 		for (size_t i = 0; i < sat_out.size(); i++)
 			bucket.push_back(i);
@@ -593,6 +731,31 @@ struct FreduceWorker
 		return find_bit_in_cone(celldone, needle, haystack);
 	}
 
+	// Runs work(i, logs) for all items, on up to -j threads. Messages of the
+	// items are printed in item order after all items are done.
+	void run_parallel(int num_items, const std::function<void(int, DeferredLogs*)> &work)
+	{
+		int pool_size = num_threads > 1 ? ThreadPool::pool_size(0, std::min(num_threads, num_items)) : 0;
+
+		if (pool_size <= 1) {
+			for (int i = 0; i < num_items; i++)
+				work(i, nullptr);
+			return;
+		}
+
+		std::vector<DeferredLogs> logs(num_items);
+		std::atomic<int> next_item = 0;
+
+		ParallelDispatchThreadPool thread_pool(pool_size);
+		thread_pool.run([&](const ParallelDispatchThreadPool::RunCtx &) {
+			for (int i = next_item++; i < num_items; i = next_item++)
+				work(i, &logs[i]);
+		});
+
+		for (auto &item_logs : logs)
+			item_logs.flush();
+	}
+
 	void dump()
 	{
 		std::string filename = stringf("%s_%s_%05d.il", dump_prefix, module, reduce_counter);
@@ -635,9 +798,11 @@ struct FreduceWorker
 				inv_pairs.insert(std::pair<RTLIL::SigBit, RTLIL::SigBit>(sigmap(cell->getPort(ID::A)), sigmap(cell->getPort(ID::Y))));
 		}
 
+		// bits of the selected batches, with the progress at each bit
+		std::vector<RTLIL::SigSpec> work_batch_sigs;
+		std::vector<std::vector<std::pair<RTLIL::SigBit, int>>> work_batches;
 		int bits_count = 0;
 		int bits_full_count = 0;
-		std::map<std::vector<RTLIL::SigBit>, std::vector<RTLIL::SigBit>> buckets;
 		for (auto &batch : batches)
 		{
 			for (auto &bit : batch)
@@ -647,40 +812,139 @@ struct FreduceWorker
 			continue;
 
 		found_selected_wire:
-			log("  Finding reduced input cone for signal batch %s%c\n",
-					log_signal(batch), verbose_level ? ':' : '.');
-
-			FindReducedInputs infinder(sigmap, drivers);
+			work_batch_sigs.push_back(batch);
+			work_batches.emplace_back();
 			for (auto &bit : batch) {
-				std::vector<RTLIL::SigBit> inputs;
-				infinder.analyze(inputs, bit, 100 * bits_full_count / bits_full_total);
-				buckets[inputs].push_back(bit);
+				work_batches.back().push_back({bit, 100 * bits_full_count / bits_full_total});
 				bits_full_count++;
-				bits_count++;
 			}
 		}
+
+		dict<RTLIL::SigBit, std::vector<uint64_t>> signatures;
+		if (sim_mode)
+		{
+			FreduceSimulator sim(sigmap, drivers);
+			dict<std::vector<uint64_t>, int> signature_count;
+			bool all_simulated = true;
+			int sim_bits_count = 0;
+
+			for (auto &work : work_batches)
+				for (auto &it : work) {
+					std::vector<uint64_t> sig;
+					if (sim.signature(it.first, sig)) {
+						signature_count[sig]++;
+						signatures[it.first] = std::move(sig);
+					} else
+						all_simulated = false;
+					sim_bits_count++;
+				}
+
+			// A bit with a unique signature can only be equivalent to bits
+			// that are not simulated, so it is not analyzed if there are none.
+			if (all_simulated) {
+				int unique_count = 0;
+				for (auto &work : work_batches) {
+					auto unique_begin = std::remove_if(work.begin(), work.end(), [&](const std::pair<RTLIL::SigBit, int> &it) {
+						return signature_count.at(signatures.at(it.first)) == 1;
+					});
+					unique_count += work.end() - unique_begin;
+					work.erase(unique_begin, work.end());
+				}
+				log("  Simulation separated %d of %d signal bits from all other signal bits.\n", unique_count, sim_bits_count);
+			}
+		}
+
+		// The SAT problems of different batches, and later of different
+		// buckets, are independent and solved in parallel with -j. Results are
+		// collected per batch or bucket and merged in a fixed order.
+		std::vector<std::vector<std::vector<RTLIL::SigBit>>> reduced_inputs(GetSize(work_batches));
+		run_parallel(GetSize(work_batches), [&](int i, DeferredLogs *logs) {
+			if (work_batches[i].empty())
+				return;
+			FindReducedInputs infinder(sigmap, drivers, logs);
+			infinder.log("  Finding reduced input cone for signal batch %s%c\n",
+					log_signal(work_batch_sigs[i]), verbose_level ? ':' : '.');
+			for (auto &it : work_batches[i]) {
+				reduced_inputs[i].emplace_back();
+				infinder.analyze(reduced_inputs[i].back(), it.first, it.second);
+				if (infinder.failed)
+					break;
+			}
+		});
+
+		std::map<std::vector<RTLIL::SigBit>, std::vector<RTLIL::SigBit>> buckets;
+		for (int i = 0; i < GetSize(work_batches); i++)
+			for (int j = 0; j < GetSize(reduced_inputs[i]); j++) {
+				buckets[reduced_inputs[i][j]].push_back(work_batches[i][j].first);
+				bits_count++;
+			}
 		log("  Sorted %d signal bits into %d buckets.\n", bits_count, int(buckets.size()));
 
-		int bucket_count = 0;
-		std::vector<std::vector<equiv_bit_t>> equiv;
+		struct ReductionBucket {
+			std::vector<RTLIL::SigBit> bits;
+			int cone_size;
+			int perc;
+		};
+
+		int bucket_count = 0, split_count = 0;
+		std::vector<ReductionBucket> reduction_buckets;
 		for (auto &bucket : buckets)
 		{
 			bucket_count++;
+			int perc = 100 * bucket_count / (buckets.size() + 1);
 
 			if (bucket.second.size() == 1)
 				continue;
 
-			if (bucket.first.size() == 0) {
-				log("  Finding const values for bucket %s%c\n", log_signal(bucket.second), verbose_level ? ':' : '.');
-				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.second, bucket.first.size());
-				for (size_t idx = 0; idx < bucket.second.size(); idx++)
-					worker.analyze_const(equiv, idx);
-			} else {
-				log("  Trying to shatter bucket %s%c\n", log_signal(bucket.second), verbose_level ? ':' : '.');
-				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.second, bucket.first.size());
-				worker.analyze(equiv, 100 * bucket_count / (buckets.size() + 1));
+			// equivalent bits have the same signature, so buckets of simulated
+			// bits are split by signature before any SAT calls
+			bool split = !bucket.first.empty();
+			for (auto &bit : bucket.second)
+				if (signatures.count(bit) == 0)
+					split = false;
+
+			if (!split) {
+				reduction_buckets.push_back({bucket.second, GetSize(bucket.first), perc});
+				continue;
 			}
+
+			dict<std::vector<uint64_t>, int> sub_bucket_index;
+			std::vector<std::vector<RTLIL::SigBit>> sub_buckets;
+			for (auto &bit : bucket.second) {
+				auto it = sub_bucket_index.emplace(signatures.at(bit), GetSize(sub_buckets));
+				if (it.second)
+					sub_buckets.emplace_back();
+				sub_buckets[it.first->second].push_back(bit);
+			}
+			if (GetSize(sub_buckets) > 1)
+				split_count++;
+			for (auto &sub_bucket : sub_buckets)
+				if (sub_bucket.size() > 1)
+					reduction_buckets.push_back({std::move(sub_bucket), GetSize(bucket.first), perc});
 		}
+		if (split_count > 0)
+			log("  Split %d buckets by simulation signature.\n", split_count);
+
+		std::vector<std::vector<std::vector<equiv_bit_t>>> bucket_equiv(GetSize(reduction_buckets));
+		run_parallel(GetSize(reduction_buckets), [&](int i, DeferredLogs *logs) {
+			ReductionBucket &bucket = reduction_buckets[i];
+			FreduceLogger logger;
+			logger.logs = logs;
+			if (bucket.cone_size == 0) {
+				logger.log("  Finding const values for bucket %s%c\n", log_signal(bucket.bits), verbose_level ? ':' : '.');
+				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.bits, bucket.cone_size, logs);
+				for (size_t idx = 0; idx < bucket.bits.size(); idx++)
+					worker.analyze_const(bucket_equiv[i], idx);
+			} else {
+				logger.log("  Trying to shatter bucket %s%c\n", log_signal(bucket.bits), verbose_level ? ':' : '.');
+				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.bits, bucket.cone_size, logs);
+				worker.analyze(bucket_equiv[i], bucket.perc);
+			}
+		});
+
+		std::vector<std::vector<equiv_bit_t>> equiv;
+		for (auto &result : bucket_equiv)
+			equiv.insert(equiv.end(), result.begin(), result.end());
 
 		std::map<RTLIL::SigBit, int> bitusage;
 		CountBitUsage bitusage_worker(sigmap, bitusage);
@@ -777,6 +1041,15 @@ struct FreducePass : public Pass {
 		log("    -inv\n");
 		log("        enable explicit handling of inverted signals\n");
 		log("\n");
+		log("    -nosim\n");
+		log("        do not simulate the circuit with random patterns. by default, signals\n");
+		log("        that differ in simulation are never compared using the SAT solver.\n");
+		log("\n");
+		log("    -j <N>\n");
+		log("        solve the SAT problems of up to N signal batches or buckets in\n");
+		log("        parallel, each with its own SAT solver. the circuit is rewired after\n");
+		log("        all problems are solved, in the same order as without -j.\n");
+		log("\n");
 		log("    -stop <n>\n");
 		log("        stop after <n> reduction operations. this is mostly used for\n");
 		log("        debugging the freduce command itself.\n");
@@ -797,7 +1070,9 @@ struct FreducePass : public Pass {
 		reduce_counter = 0;
 		reduce_stop_at = 0;
 		verbose_level = 0;
+		num_threads = 1;
 		inv_mode = false;
+		sim_mode = true;
 		dump_prefix = std::string();
 
 		log_header(design, "Executing FREDUCE pass (perform functional reduction).\n");
@@ -816,6 +1091,14 @@ struct FreducePass : public Pass {
 				inv_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-nosim") {
+				sim_mode = false;
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
 			if (args[argidx] == "-stop" && argidx+1 < args.size()) {
 				reduce_stop_at = atoi(args[++argidx].c_str());
 				continue;
@@ -0,0 +1,138 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/satgen.h"
+#include "libs/ezsat/ezipasir.h"
+
+#ifdef YOSYS_ENABLE_PLUGINS
+#  include <dlfcn.h>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct IpasirSatSolver : public SatSolver
+{
+	ezIpasirApi api;
+	void *handle;
+
+	IpasirSatSolver(std::string name, void *handle, const ezIpasirApi &api) : SatSolver(name), api(api), handle(handle) { }
+
+	ezSAT *create() override {
+		return new ezIpasirSAT(api);
+	}
+};
+
+// Solvers stay registered until Yosys exits, the library is never unloaded.
+static std::vector<std::unique_ptr<IpasirSatSolver>> ipasir_solvers;
+
+struct IpasirPass : public Pass {
+	IpasirPass() : Pass("ipasir", "load an IPASIR SAT solver library") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    ipasir [options] <library>\n");
+		log("\n");
+		log("This command loads a shared library implementing the IPASIR incremental SAT\n");
+		log("solver interface (for example a build of CaDiCaL or Kissat) and registers it\n");
+		log("as a SAT solver. It can then be selected with 'sat -select-solver <name>'.\n");
+		log("\n");
+		log("    -name <name>\n");
+		log("        name of the registered solver (default: ipasir)\n");
+		log("\n");
+		log("    -default\n");
+		log("        use the solver for all commands that solve SAT problems, such as\n");
+		log("        equiv_simple, equiv_induct or freduce\n");
+		log("\n");
+		log("The solver does not support the propagation limit of 'sat -prop-limit'.\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design*) override
+	{
+		std::string name = "ipasir";
+		bool make_default = false;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-name" && argidx+1 < args.size()) {
+				name = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-default") {
+				make_default = true;
+				continue;
+			}
+			break;
+		}
+		if (argidx+1 != args.size())
+			cmd_error(args, argidx, "Expected exactly one library name.");
+		std::string filename = args[argidx];
+
+		log_header(nullptr, "Executing IPASIR pass (loading SAT solver library).\n");
+
+		for (auto solver = yosys_satsolver_list; solver != nullptr; solver = solver->next)
+			if (solver->name == name)
+				log_cmd_error("A SAT solver named '%s' is already registered.\n", name);
+
+#ifdef YOSYS_ENABLE_PLUGINS
+		rewrite_filename(filename);
+		if (filename.find('/') == std::string::npos)
+			filename = "./" + filename;
+
+		void *handle = dlopen(filename.c_str(), RTLD_LAZY|RTLD_LOCAL);
+		if (handle == nullptr)
+			log_cmd_error("Can't load IPASIR library `%s': %s\n", filename, dlerror());
+
+		auto lookup = [&](const char *symbol, bool required = true) {
+			void *ptr = dlsym(handle, symbol);
+			if (ptr == nullptr && required) {
+				dlclose(handle);
+				log_cmd_error("IPASIR library `%s' does not export `%s'.\n", filename, symbol);
+			}
+			return ptr;
+		};
+
+		ezIpasirApi api;
+		api.signature = (const char *(*)())lookup("ipasir_signature");
+		api.init = (void *(*)())lookup("ipasir_init");
+		api.release = (void (*)(void*))lookup("ipasir_release");
+		api.add = (void (*)(void*, int32_t))lookup("ipasir_add");
+		api.assume = (void (*)(void*, int32_t))lookup("ipasir_assume");
+		api.solve = (int (*)(void*))lookup("ipasir_solve");
+		api.val = (int32_t (*)(void*, int32_t))lookup("ipasir_val");
+		api.set_terminate = (void (*)(void*, void*, int (*)(void*)))lookup("ipasir_set_terminate", false);
+
+		log("Registered SAT solver '%s': %s\n", name, api.signature());
+		if (api.set_terminate == nullptr)
+			log_warning("IPASIR library `%s' does not support terminating the solver, -timeout is ignored.\n", filename);
+
+		ipasir_solvers.push_back(std::make_unique<IpasirSatSolver>(name, handle, api));
+		if (make_default) {
+			yosys_satsolver = ipasir_solvers.back().get();
+			log("Using '%s' as the default SAT solver.\n", name);
+		}
+#else
+		log_cmd_error("This version of Yosys cannot load shared libraries.\n");
+#endif
+	}
+} IpasirPass;
+
+PRIVATE_NAMESPACE_END
@@ -27,6 +27,7 @@
 #include "kernel/satgen.h"
 #include "kernel/yosys.h"
 #include "kernel/log_help.h"
+#include "kernel/threading.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -47,6 +48,127 @@ static std::string list_satsolvers()
 	return result;
 }
 
+// Runs differently configured MiniSat solvers on the CNF generated by this
+// instance and takes the answer of the first one that finishes. The first
+// solver has the default configuration, runs on the calling thread and is the
+// only one with a timeout or propagation limit. The others vary the random
+// seed, the restart strategy and the SimpSolver preprocessing, each on its own
+// worker thread.
+struct ezPortfolioSAT : public ezSAT
+{
+	std::vector<std::unique_ptr<ezMiniSAT>> members;
+	std::set<int> frozen_vars;
+
+	ezPortfolioSAT(int size)
+	{
+		size = 1 + ThreadPool::pool_size(1, size - 1);
+		for (int i = 0; i < size; i++) {
+			auto member = std::make_unique<ezMiniSAT>();
+			if (i > 0) {
+				member->randomSeed = 91648253 + 7919 * i;
+				member->randomVarFreq = 0.01 * (i % 3);
+				member->lubyRestart = i % 2 == 0;
+				member->restartFirst = i % 4 < 2 ? 100 : 300;
+				member->simplification = i % 3 != 1;
+			}
+			members.push_back(std::move(member));
+		}
+
+		freeze(CONST_TRUE);
+		freeze(CONST_FALSE);
+	}
+
+	void freeze(int id) override
+	{
+		if (!mode_non_incremental())
+			frozen_vars.insert(bind(id));
+	}
+
+	bool eliminated(int idx) override
+	{
+		for (auto &member : members)
+			if (member->eliminated(idx))
+				return true;
+		return false;
+	}
+
+	bool solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions) override
+	{
+		preSolverCallback();
+
+		solverTimeoutStatus = false;
+		solverPropLimitStatus = false;
+		solverProps = 0;
+
+		std::vector<int> assumption_idx, model_idx;
+		for (auto id : assumptions)
+			assumption_idx.push_back(bind(id));
+		for (auto id : modelExpressions)
+			model_idx.push_back(bind(id));
+
+		std::vector<std::vector<int>> cnf;
+		consumeCnf(cnf);
+
+		int size = GetSize(members);
+		std::vector<std::set<int>> member_frozen_vars(size, frozen_vars);
+		std::vector<std::vector<bool>> member_values(size);
+		std::vector<char> member_results(size);
+		std::atomic<int> winner = -1;
+		frozen_vars.clear();
+
+		for (auto &member : members) {
+			member->initSolver();
+			member->clearInterrupt();
+		}
+		members[0]->setSolverTimeout(solverTimeout);
+		members[0]->setSolverPropLimit(solverPropLimit);
+
+		auto run = [&](int i) {
+			ezMiniSAT *member = members[i].get();
+			member_results[i] = member->solveCnf(cnf, numCnfVariables(), member_frozen_vars[i], assumption_idx, model_idx, member_values[i]);
+			if (member->solverInterrupted || member->getSolverTimeoutStatus() || member->getSolverPropLimitStatus())
+				return;
+			int expected = -1;
+			if (winner.compare_exchange_strong(expected, i))
+				for (int j = 0; j < size; j++)
+					if (j != i)
+						members[j]->interrupt();
+		};
+
+		{
+			ThreadPool pool(size - 1, [&](int thread) { run(thread + 1); });
+			run(0);
+			// the first solver reached its timeout or propagation limit
+			if (winner < 0)
+				for (int j = 1; j < size; j++)
+					members[j]->interrupt();
+		}
+
+		int i = winner;
+		if (i < 0) {
+			solverTimeoutStatus = members[0]->getSolverTimeoutStatus();
+			solverPropLimitStatus = members[0]->getSolverPropLimitStatus();
+			solverProps = members[0]->getSolverProps();
+			return false;
+		}
+
+		solverProps = members[i]->getSolverProps();
+		if (!member_results[i])
+			return false;
+		modelValues = member_values[i];
+		return true;
+	}
+};
+
+struct PortfolioSatSolver : public SatSolver
+{
+	int size;
+	PortfolioSatSolver(int size) : SatSolver(stringf("minisat-portfolio-%d", size)), size(size) { }
+	ezSAT *create() override {
+		return new ezPortfolioSAT(size);
+	}
+};
+
 struct SatHelper
 {
 	RTLIL::Design *design;
@@ -76,6 +198,9 @@ struct SatHelper
 	int max_timestep, timeout;
 	bool gotTimeout;
 
+	// wall clock time spent in solve(), shared by the helpers of one sat call
+	std::atomic<int64_t> *solve_ns = nullptr;
+
 	SatHelper(RTLIL::Design *design, RTLIL::Module *module, SatSolver *solver, bool enable_undef, bool set_def_formal) :
 		design(design), module(module), sigmap(module), ct(design), ez(solver), satgen(ez.get(), &sigmap)
 	{
@@ -452,7 +577,10 @@ struct SatHelper
 	{
 		log_assert(gotTimeout == false);
 		ez->setSolverTimeout(timeout);
+		auto start = std::chrono::steady_clock::now();
 		bool success = ez->solve(modelExpressions, modelValues, assumptions);
+		if (solve_ns != nullptr)
+			*solve_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 		if (ez->getSolverTimeoutStatus())
 			gotTimeout = true;
 		return success;
@@ -462,7 +590,10 @@ struct SatHelper
 	{
 		log_assert(gotTimeout == false);
 		ez->setSolverTimeout(timeout);
+		auto start = std::chrono::steady_clock::now();
 		bool success = ez->solve(modelExpressions, modelValues, a, b, c, d, e, f);
+		if (solve_ns != nullptr)
+			*solve_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 		if (ez->getSolverTimeoutStatus())
 			gotTimeout = true;
 		return success;
@@ -1049,6 +1180,10 @@ struct SatPass : public Pass {
 		log("        -maxsteps <N>\". Use -initsteps if you just want to set a\n");
 		log("        minimal induction length.\n");
 		log("\n");
+		log("    -tempinduct-parallel\n");
+		log("        Solve the base case and the induction step of each induction length\n");
+		log("        concurrently. Not supported together with -timeout.\n");
+		log("\n");
 		log("    -prove <signal> <value>\n");
 		log("        Attempt to proof that <signal> is always <value>.\n");
 		log("\n");
@@ -1081,6 +1216,13 @@ struct SatPass : public Pass {
 		log("    -select-solver <name>\n");
 		log("        Select SAT solver implementation for this invocation.\n");
 		log("        If not given, uses scratchpad key 'sat.solver' if set, otherwise default.\n");
+		log("        Additional solvers can be loaded with the 'ipasir' command.\n");
+		log("\n");
+		log("    -portfolio <N>\n");
+		log("        Run up to <N> differently configured MiniSat solvers on each SAT\n");
+		log("        problem on concurrent threads and use the first answer. The solvers\n");
+		log("        vary the random seed, the restart strategy and the preprocessing.\n");
+		log("        Only the first solver is subject to -timeout.\n");
 		log("\n");
 		log("    -verify\n");
 		log("        Return an error and stop the synthesis script if the proof fails.\n");
@@ -1108,7 +1250,8 @@ struct SatPass : public Pass {
 		bool show_regs = false, show_public = false, show_all = false;
 		bool ignore_unknown_cells = false, falsify = false, tempinduct_def = false, set_init_def = false;
 		bool tempinduct_baseonly = false, tempinduct_inductonly = false, set_assumes = false;
-		int tempinduct_skip = 0, stepsize = 1;
+		int tempinduct_skip = 0, stepsize = 1, portfolio = 0;
+		bool tempinduct_parallel = false;
 		std::string vcd_file_name, json_file_name, cnf_file_name;
 
 		log_header(design, "Executing SAT pass (solving SAT problems in the circuit).\n");
@@ -1235,6 +1378,15 @@ struct SatPass : public Pass {
 				tempinduct_skip = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-tempinduct-parallel") {
+				tempinduct = true;
+				tempinduct_parallel = true;
+				continue;
+			}
+			if (args[argidx] == "-portfolio" && argidx+1 < args.size()) {
+				portfolio = atoi(args[++argidx].c_str());
+				continue;
+			}
 			if (args[argidx] == "-prove" && argidx+2 < args.size()) {
 				std::string lhs = args[++argidx];
 				std::string rhs = args[++argidx];
@@ -1366,6 +1518,17 @@ struct SatPass : public Pass {
 						solver_name, list_satsolvers());
 		}
 
+		std::unique_ptr<PortfolioSatSolver> portfolio_solver;
+		if (portfolio > 1) {
+			if (solver->name != "minisat")
+				log_cmd_error("Option -portfolio is only supported with the minisat solver.\n");
+			portfolio_solver = std::make_unique<PortfolioSatSolver>(portfolio);
+			solver = portfolio_solver.get();
+		}
+
+		if (tempinduct_parallel && timeout > 0)
+			log_cmd_error("Options -tempinduct-parallel and -timeout don't work with each other.\n");
+
 		RTLIL::Module *module = NULL;
 		for (auto mod : design->selected_modules()) {
 			if (module)
@@ -1429,6 +1592,7 @@ struct SatPass : public Pass {
 		}
 
 		log("Using SAT solver `%s`.\n", solver->name.c_str());
+		std::atomic<int64_t> solve_ns{0};
 
 		if (tempinduct)
 		{
@@ -1447,6 +1611,7 @@ struct SatPass : public Pass {
 			basecase.unsets_at = unsets_at;
 			basecase.shows = shows;
 			basecase.timeout = timeout;
+			basecase.solve_ns = &solve_ns;
 			basecase.sets_def = sets_def;
 			basecase.sets_any_undef = sets_any_undef;
 			basecase.sets_all_undef = sets_all_undef;
@@ -1471,6 +1636,7 @@ struct SatPass : public Pass {
 			inductstep.prove_asserts = prove_asserts;
 			inductstep.shows = shows;
 			inductstep.timeout = timeout;
+			inductstep.solve_ns = &solve_ns;
 			inductstep.sets_def = sets_def;
 			inductstep.sets_any_undef = sets_any_undef;
 			inductstep.sets_all_undef = sets_all_undef;
@@ -1487,16 +1653,53 @@ struct SatPass : public Pass {
 				inductstep.ez->assume(inductstep.ez->NOT(inductstep.ez->expression(ezSAT::OpOr, undef_state)));
 			}
 
+			// With -tempinduct-parallel the base case is solved on a worker
+			// thread while the induction step is set up and solved on this one.
+			// Its result is still reported first.
+			int base_threads = 0;
+			if (tempinduct_parallel && !tempinduct_baseonly && !tempinduct_inductonly)
+				base_threads = ThreadPool::pool_size(1, 1);
+
 			for (int inductlen = 1; inductlen <= maxsteps || maxsteps == 0; inductlen++)
 			{
 				log("\n** Trying induction with length %d **\n", inductlen);
 
+				bool base_solving = false, base_sat = false;
+				int base_property = 0;
+				std::optional<ThreadPool> base_thread;
+
+				// 0: proven, 1: model found, 2: timeout
+				auto finish_base_case = [&]() {
+					if (!base_solving)
+						return 0;
+					base_thread.reset();
+					base_solving = false;
+
+					if (base_sat) {
+						log("SAT temporal induction proof finished - model found for base case: FAIL!\n");
+						print_proof_failed();
+						basecase.print_model();
+						if(!vcd_file_name.empty())
+							basecase.dump_model_to_vcd(vcd_file_name);
+						if(!json_file_name.empty())
+							basecase.dump_model_to_json(json_file_name);
+						return 1;
+					}
+
+					if (basecase.gotTimeout)
+						return 2;
+
+					log("Base case for induction length %d proven.\n", inductlen);
+					basecase.ez->assume(base_property);
+					return 0;
+				};
+
 				// phase 1: proving base case
 
 				if (!tempinduct_inductonly)
 				{
 					basecase.setup(seq_len + inductlen, seq_len + inductlen == 1);
-					int property = basecase.setup_proof(seq_len + inductlen);
+					base_property = basecase.setup_proof(seq_len + inductlen);
 					basecase.generate_model();
 
 					if (inductlen > 1)
@@ -1508,21 +1711,12 @@ struct SatPass : public Pass {
 								inductlen, basecase.ez->numCnfVariables(), basecase.ez->numCnfClauses());
 						log_flush();
 
-						if (basecase.solve(basecase.ez->NOT(property))) {
-							log("SAT temporal induction proof finished - model found for base case: FAIL!\n");
-							print_proof_failed();
-							basecase.print_model();
-							if(!vcd_file_name.empty())
-								basecase.dump_model_to_vcd(vcd_file_name);
-							if(!json_file_name.empty())
-								basecase.dump_model_to_json(json_file_name);
-							goto tip_failed;
-						}
-
-						if (basecase.gotTimeout)
-							goto timeout;
-
-						log("Base case for induction length %d proven.\n", inductlen);
+						int assumption = basecase.ez->NOT(base_property);
+						base_solving = true;
+						if (base_threads > 0)
+							base_thread.emplace(base_threads, [&, assumption](int) { base_sat = basecase.solve(assumption); });
+						else
+							base_sat = basecase.solve(assumption);
 					}
 					else
 					{
@@ -1530,8 +1724,15 @@ struct SatPass : public Pass {
 								inductlen, tempinduct_skip);
 						log("\n[base case %d] Problem size so far: %d variables and %d clauses.\n",
 								inductlen, basecase.ez->numCnfVariables(), basecase.ez->numCnfClauses());
+						basecase.ez->assume(base_property);
+					}
+				}
+
+				if (!base_thread) {
+					switch (finish_base_case()) {
+						case 1: goto tip_failed;
+						case 2: goto timeout;
 					}
-					basecase.ez->assume(property);
 				}
 
 				// phase 2: proving induction step
@@ -1580,7 +1781,14 @@ struct SatPass : public Pass {
 								inductlen, inductstep.ez->numCnfVariables(), inductstep.ez->numCnfClauses());
 						log_flush();
 
-						if (!inductstep.solve(inductstep.ez->NOT(property))) {
+						bool induct_sat = inductstep.solve(inductstep.ez->NOT(property));
+
+						switch (finish_base_case()) {
+							case 1: goto tip_failed;
+							case 2: goto timeout;
+						}
+
+						if (!induct_sat) {
 							if (inductstep.gotTimeout)
 								goto timeout;
 							log("Induction step proven: SUCCESS!\n");
@@ -1593,6 +1801,11 @@ struct SatPass : public Pass {
 						inductstep.print_model();
 					}
 				}
+
+				switch (finish_base_case()) {
+					case 1: goto tip_failed;
+					case 2: goto timeout;
+				}
 			}
 
 			if (tempinduct_baseonly) {
@@ -1636,6 +1849,7 @@ struct SatPass : public Pass {
 			sathelper.unsets_at = unsets_at;
 			sathelper.shows = shows;
 			sathelper.timeout = timeout;
+			sathelper.solve_ns = &solve_ns;
 			sathelper.sets_def = sets_def;
 			sathelper.sets_any_undef = sets_any_undef;
 			sathelper.sets_all_undef = sets_all_undef;
@@ -1768,6 +1982,8 @@ struct SatPass : public Pass {
 			if (fail_on_timeout)
 				log_error("Called with -verify and proof did time out!\n");
 		}
+
+		log("\nTime spent in the SAT solver: %.3f seconds.\n", solve_ns / 1e9);
 	}
 } SatPass;
 
@@ -28,6 +28,8 @@
 #include "kernel/json.h"
 #include "kernel/fmt.h"
 #include "kernel/drivertools.h"
+#include "kernel/threading.h"
+#include "passes/sat/sim_compiled.h"
 
 #include <ctime>
 
@@ -143,6 +145,19 @@ struct SimShared
 	bool initstate = true;
 	bool undriven_check = true;
 	bool undriven_warning = false;
+	bool compiled = false;
+	// set up by SimWorker when the hierarchy is large enough to update in parallel
+	std::unique_ptr<ParallelDispatchThreadPool> thread_pool;
+};
+
+// Side effects of updating instances on a worker thread, replayed on the main
+// thread in the order a serial update would have produced them.
+struct SimDeferred
+{
+	DeferredLogs logs;
+	std::vector<std::tuple<SimInstance*, IdString, int>> memory_addrs;
+
+	void flush();
 };
 
 void zinit(Const &v)
@@ -167,6 +182,7 @@ struct SimInstance
 	dict<SigBit, State> state_nets;
 	dict<SigBit, pool<Cell*>> upd_cells;
 	dict<SigBit, pool<Wire*>> upd_outports;
+	dict<SigBit, pool<Wire*>> upd_signals;
 
 	dict<SigBit, SigBit> in_parent_drivers;
 	dict<SigBit, SigBit> clk2fflogic_drivers;
@@ -176,6 +192,14 @@ struct SimInstance
 	pool<IdString> dirty_memories;
 	pool<SimInstance*> dirty_children;
 
+	// traced signals and memories that may have changed since the last output step
+	pool<Wire*> dirty_signals;
+	pool<IdString> dirty_trace_memories;
+
+	// output port values to be applied to the parent after update_ph1()
+	std::vector<std::pair<SigSpec, Const>> parent_updates;
+	SimDeferred *deferred = nullptr;
+
 	struct ff_state_t
 	{
 		Const past_d;
@@ -470,6 +494,10 @@ struct SimInstance
 			if (value[i] != State::Sa && state_nets.at(sig[i]) != value[i]) {
 				state_nets.at(sig[i]) = value[i];
 				dirty_bits.insert(sig[i]);
+				auto it = upd_signals.find(sig[i]);
+				if (it != upd_signals.end())
+					for (auto wire : it->second)
+						dirty_signals.insert(wire);
 				did_something = true;
 			}
 
@@ -515,8 +543,10 @@ struct SimInstance
 				if (state.data[i+offset] != data[i])
 					dirty = true, state.data.set(i+offset, data[i]);
 
-		if (dirty)
+		if (dirty) {
 			dirty_memories.insert(memid);
+			dirty_trace_memories.insert(memid);
+		}
 	}
 
 	void set_memory_state_bit(IdString memid, int offset, State data)
@@ -527,6 +557,7 @@ struct SimInstance
 		if (state.data[offset] != data) {
 			state.data.set(offset, data);
 			dirty_memories.insert(memid);
+			dirty_trace_memories.insert(memid);
 		}
 	}
 
@@ -595,7 +626,9 @@ struct SimInstance
 			else
 				err = true;
 
-			if (err)
+			if (err && deferred)
+				deferred->logs.log_warning("Unsupported evaluable cell type: %s (%s.%s)\n", cell->type.unescape(), module, cell);
+			else if (err)
 				log_warning("Unsupported evaluable cell type: %s (%s.%s)\n", cell->type.unescape(), module, cell);
 			else
 				set_state(sig_y, eval_state);
@@ -605,7 +638,10 @@ struct SimInstance
 		if (cell->type == ID($print))
 			return;
 
-		log_error("Unsupported cell type: %s (%s.%s)\n", cell->type.unescape(), module, cell);
+		if (deferred)
+			deferred->logs.log_error("Unsupported cell type: %s (%s.%s)\n", cell->type.unescape(), module, cell);
+		else
+			log_error("Unsupported cell type: %s (%s.%s)\n", cell->type.unescape(), module, cell);
 	}
 
 	void update_memory(IdString id) {
@@ -618,8 +654,13 @@ struct SimInstance
 			Const addr = get_state(port.addr);
 			Const data = Const(State::Sx, mem.width << port.wide_log2);
 
-			if (port.clk_enable)
+			if (port.clk_enable) {
+				if (deferred) {
+					deferred->logs.log_error("Memory %s.%s has clocked read ports. Run 'memory_nordff' to transform the circuit to remove those.\n", module, mem.memid.unescape());
+					return;
+				}
 				log_error("Memory %s.%s has clocked read ports. Run 'memory_nordff' to transform the circuit to remove those.\n", module, mem.memid.unescape());
+			}
 
 			if (addr.is_fully_def()) {
 				int addr_int = addr.as_int();
@@ -674,22 +715,82 @@ struct SimInstance
 			for (auto wire : queue_outports)
 				if (instance->hasPort(wire->name)) {
 					Const value = get_state(wire);
-					parent->set_state(instance->getPort(wire->name), value);
+					parent_updates.emplace_back(instance->getPort(wire->name), value);
 				}
 
 			queue_outports.clear();
 
-			for (auto child : dirty_children)
-				child->update_ph1();
-
-			dirty_children.clear();
+			update_children_ph1();
 
 			if (dirty_bits.empty())
 				break;
 		}
 	}
 
+	// Sibling instances only communicate through this instance, so they are
+	// updated in parallel and their output ports are applied afterwards.
+	void update_children_ph1()
+	{
+		std::vector<SimInstance*> queue(dirty_children.begin(), dirty_children.end());
+		dirty_children.clear();
+
+		if (GetSize(queue) > 1 && shared->thread_pool && !Multithreading::active()) {
+			std::vector<SimDeferred> children_deferred(GetSize(queue));
+			for (int i = 0; i < GetSize(queue); i++)
+				queue[i]->set_deferred(&children_deferred[i]);
+			ParallelDispatchThreadPool::Subpool subpool(*shared->thread_pool, GetSize(queue));
+			subpool.run([&queue](const ParallelDispatchThreadPool::RunCtx &ctx) {
+				for (int i : ctx.item_range(GetSize(queue)))
+					queue[i]->update_ph1();
+			});
+			for (int i = 0; i < GetSize(queue); i++) {
+				queue[i]->set_deferred(nullptr);
+				children_deferred[i].flush();
+			}
+		} else {
+			for (auto child : queue)
+				child->update_ph1();
+		}
+
+		for (auto child : queue) {
+			for (auto &it : child->parent_updates)
+				set_state(it.first, it.second);
+			child->parent_updates.clear();
+		}
+	}
+
+	void set_deferred(SimDeferred *d)
+	{
+		deferred = d;
+		for (auto child : children)
+			child.second->set_deferred(d);
+	}
+
+	// all instances in this hierarchy in pre-order, with the index of their parent
+	void get_instances(std::vector<SimInstance*> &instances, std::vector<int> &parents, int parent_index = -1)
+	{
+		int index = GetSize(instances);
+		instances.push_back(this);
+		parents.push_back(parent_index);
+		for (auto child : children)
+			child.second->get_instances(instances, parents, index);
+	}
+
 	bool update_ph2(bool gclk, bool stable_past_update = false)
+	{
+		bool did_something = update_ph2_local(gclk, stable_past_update);
+
+		for (auto it : children)
+			if (it.second->update_ph2(gclk, stable_past_update)) {
+				dirty_children.insert(it.second);
+				did_something = true;
+			}
+
+		return did_something;
+	}
+
+	// update_ph2() without visiting the children
+	bool update_ph2_local(bool gclk, bool stable_past_update)
 	{
 		bool did_something = false;
 
@@ -793,6 +894,7 @@ struct SimInstance
 							if (enable[i] == State::S1 && mdb.data.at(index*mem.width+i) != data[i]) {
 								mdb.data.set(index*mem.width+i, data[i]);
 								dirty_memories.insert(mem.memid);
+								dirty_trace_memories.insert(mem.memid);
 								did_something = true;
 							}
 
@@ -802,12 +904,6 @@ struct SimInstance
 			}
 		}
 
-		for (auto it : children)
-			if (it.second->update_ph2(gclk, stable_past_update)) {
-				dirty_children.insert(it.second);
-				did_something = true;
-			}
-
 		return did_something;
 	}
 
@@ -835,7 +931,23 @@ struct SimInstance
 		}
 	}
 
-	void update_ph3(bool gclk_trigger)
+	void update_ph3(bool gclk_trigger, bool sample_past = true)
+	{
+		if (sample_past)
+			update_ph3_past();
+
+		// Do prints *before* assertions
+		update_ph3_prints(gclk_trigger);
+
+		if (gclk_trigger)
+			update_ph3_checks();
+
+		for (auto it : children)
+			it.second->update_ph3(gclk_trigger, sample_past);
+	}
+
+	// sample the values used by the next update_ph2()
+	void update_ph3_past()
 	{
 		for (auto &it : ff_database)
 		{
@@ -869,8 +981,10 @@ struct SimInstance
 				mem.past_wr_data[i] = get_state(port.data);
 			}
 		}
+	}
 
-		// Do prints *before* assertions
+	void update_ph3_prints(bool gclk_trigger)
+	{
 		for (auto &print : print_database) {
 			Cell *cell = print.cell;
 			bool triggered = false;
@@ -925,40 +1039,37 @@ struct SimInstance
 			print.past_args = args;
 			print.initial_done = true;
 		}
+	}
 
-		if (gclk_trigger)
+	void update_ph3_checks()
+	{
+		for (auto cell : formal_database)
 		{
-			for (auto cell : formal_database)
-			{
-				string label = cell->name.unescape();
-				if (cell->attributes.count(ID::src))
-					label = cell->attributes.at(ID::src).decode_string();
+			string label = cell->name.unescape();
+			if (cell->attributes.count(ID::src))
+				label = cell->attributes.at(ID::src).decode_string();
 
-				State a = get_state(cell->getPort(ID::A))[0];
-				State en = get_state(cell->getPort(ID::EN))[0];
+			State a = get_state(cell->getPort(ID::A))[0];
+			State en = get_state(cell->getPort(ID::EN))[0];
 
-				if (en == State::S1 && (cell->type == ID($cover) ? a == State::S1 : a != State::S1)) {
-					shared->triggered_assertions.emplace_back(shared->step, this, cell);
-				}
+			if (en == State::S1 && (cell->type == ID($cover) ? a == State::S1 : a != State::S1)) {
+				shared->triggered_assertions.emplace_back(shared->step, this, cell);
+			}
 
-				if (cell->type == ID($cover) && en == State::S1 && a == State::S1)
-					log("Cover %s.%s (%s) reached.\n", hiername(), cell, label);
+			if (cell->type == ID($cover) && en == State::S1 && a == State::S1)
+				log("Cover %s.%s (%s) reached.\n", hiername(), cell, label);
 
-				if (cell->type == ID($assume) && en == State::S1 && a != State::S1)
-					log("Assumption %s.%s (%s) failed.\n", hiername(), cell, label);
+			if (cell->type == ID($assume) && en == State::S1 && a != State::S1)
+				log("Assumption %s.%s (%s) failed.\n", hiername(), cell, label);
 
-				if (cell->type == ID($assert) && en == State::S1 && a != State::S1) {
-					log_cell_w_hierarchy("Failed assertion", cell);
-					if (shared->serious_asserts)
-						log_error("Assertion %s.%s (%s) failed.\n", hiername(), cell, label);
-					else
-						log_warning("Assertion %s.%s (%s) failed.\n", hiername(), cell, label);
-				}
+			if (cell->type == ID($assert) && en == State::S1 && a != State::S1) {
+				log_cell_w_hierarchy("Failed assertion", cell);
+				if (shared->serious_asserts)
+					log_error("Assertion %s.%s (%s) failed.\n", hiername(), cell, label);
+				else
+					log_warning("Assertion %s.%s (%s) failed.\n", hiername(), cell, label);
 			}
 		}
-
-		for (auto it : children)
-			it.second->update_ph3(gclk_trigger);
 	}
 
 	void set_initstate_outputs(State state)
@@ -1020,6 +1131,10 @@ struct SimInstance
 				continue;
 
 			signal_database[wire] = {id, Const(), sigmap(wire)};
+			for (auto bit : signal_database[wire].mapped_sig)
+				if (bit.wire != nullptr)
+					upd_signals[bit].insert(wire);
+			dirty_signals.insert(wire);
 			id++;
 		}
 
@@ -1110,6 +1225,11 @@ struct SimInstance
 
 	void register_memory_addr(IdString memid, int addr)
 	{
+		if (deferred) {
+			// output ids are assigned in the order addresses are first seen
+			deferred->memory_addrs.emplace_back(this, memid, addr);
+			return;
+		}
 		auto &mdb = mem_database.at(memid);
 		auto &mem = *mdb.mem;
 		int index = addr - mem.start_offset;
@@ -1129,14 +1249,16 @@ struct SimInstance
 			shared->output_data.front().second.emplace(output_id, data);
 		}
 		trace_mem_database[memid].emplace(index, make_pair(output_id, data));
+		dirty_trace_memories.insert(memid);
 
 	}
 
 	void register_output_step_values(std::map<int,Const> *data)
 	{
-		for (auto &it : signal_database)
+		// only signals with a changed bit since the last step need to be compared
+		for (auto wire : dirty_signals)
 		{
-			signal_entry_t &entry = it.second;
+			signal_entry_t &entry = signal_database.at(wire);
 			Const value = get_state_mapped(entry.mapped_sig);
 
 			if (entry.last_value == value)
@@ -1145,13 +1267,16 @@ struct SimInstance
 			entry.last_value = value;
 			data->emplace(entry.id, value);
 		}
+		dirty_signals.clear();
 
-		for (auto &trace_mem : trace_mem_database)
+		for (auto memid : dirty_trace_memories)
 		{
-			auto memid = trace_mem.first;
+			auto trace_mem = trace_mem_database.find(memid);
+			if (trace_mem == trace_mem_database.end())
+				continue;
 			auto &mdb = mem_database.at(memid);
 			auto &mem = *mdb.mem;
-			for (auto &trace_index : trace_mem.second)
+			for (auto &trace_index : trace_mem->second)
 			{
 				int output_id = trace_index.second.first;
 				int index = trace_index.first;
@@ -1165,6 +1290,7 @@ struct SimInstance
 				data->emplace(output_id, value);
 			}
 		}
+		dirty_trace_memories.clear();
 
 		for (auto child : children)
 			child.second->register_output_step_values(data);
@@ -1220,6 +1346,20 @@ struct SimInstance
 			child.second->addAdditionalInputs();
 	}
 
+	void getFstReadHandles(std::vector<fstHandle> &handles)
+	{
+		for (auto &item : fst_handles)
+			if (item.second != 0)
+				handles.push_back(item.second);
+		for (auto &item : fst_inputs)
+			handles.push_back(item.second);
+		for (auto &mem : fst_memories)
+			for (auto &data : mem.second)
+				handles.push_back(data.second);
+		for (auto child : children)
+			child.second->getFstReadHandles(handles);
+	}
+
 	// Preconditions / assumptions:
 	// 1) fst_handles is populated for this instance (0 handle means not in trace).
 	// 2) fst_inputs is finalized (top-level inputs + addAdditionalInputs() for $anyseq).
@@ -1352,6 +1492,14 @@ struct SimInstance
 	}
 };
 
+void SimDeferred::flush()
+{
+	for (auto &it : memory_addrs)
+		std::get<0>(it)->register_memory_addr(std::get<1>(it), std::get<2>(it));
+	memory_addrs.clear();
+	logs.flush();
+}
+
 struct SimWorker : SimShared
 {
 	SimInstance *top = nullptr;
@@ -1362,12 +1510,93 @@ struct SimWorker : SimShared
 	std::string summary_filename;
 	std::string scope;
 
+	// state of -compiled mode, set up on the first update of the top instance
+	std::unique_ptr<CompiledSim> compiled_sim;
+	std::vector<std::pair<int, Wire*>> compiled_inputs;
+	std::vector<std::pair<int, Wire*>> compiled_outputs;
+	std::vector<std::pair<int, Cell*>> compiled_checks;
+	std::vector<std::pair<int, SigSpec>> compiled_ffs;
+	std::vector<std::pair<int, IdString>> compiled_mems;
+	dict<SigBit, int> compiled_q_bits;
+	int compiled_initstate = -1;
+	bool compiled_settled = false;
+
+	// all instances in pre-order, when updating them in parallel
+	std::vector<SimInstance*> instances;
+	std::vector<int> instance_parents;
+
 	~SimWorker()
 	{
 		outputfiles.clear();
+		thread_pool.reset();
 		delete top;
 	}
 
+	void setup_threads()
+	{
+		if (!instances.empty() || debug)
+			return;
+
+		top->get_instances(instances, instance_parents);
+		if (GetSize(instances) < 2) {
+			instances.clear();
+			instance_parents.clear();
+			return;
+		}
+
+		int num_cells = 0;
+		for (auto inst : instances)
+			num_cells += GetSize(inst->module->cells());
+		int pool_size = ThreadPool::work_pool_size(0, num_cells, 1000);
+		if (pool_size > 1)
+			thread_pool = std::make_unique<ParallelDispatchThreadPool>(pool_size);
+	}
+
+	// Instances only communicate through ports, which are not evaluated
+	// in this phase, so all of them are updated at once.
+	bool update_ph2(bool gclk, bool stable_past_update = false)
+	{
+		if (!thread_pool)
+			return top->update_ph2(gclk, stable_past_update);
+
+		int num_instances = GetSize(instances);
+		std::vector<char> changed(num_instances);
+		std::vector<SimDeferred> instances_deferred(num_instances);
+		for (int i = 0; i < num_instances; i++)
+			instances[i]->deferred = &instances_deferred[i];
+		thread_pool->run([&](const ParallelDispatchThreadPool::RunCtx &ctx) {
+			for (int i : ctx.item_range(num_instances))
+				changed[i] = instances[i]->update_ph2_local(gclk, stable_past_update);
+		});
+		for (int i = 0; i < num_instances; i++) {
+			instances[i]->deferred = nullptr;
+			instances_deferred[i].flush();
+		}
+
+		for (int i = num_instances - 1; i > 0; i--)
+			if (changed[i])
+				changed[instance_parents[i]] = true;
+		for (int i = 1; i < num_instances; i++)
+			if (changed[i])
+				instances[instance_parents[i]]->dirty_children.insert(instances[i]);
+		return changed[0];
+	}
+
+	void update_ph3(bool gclk)
+	{
+		if (!thread_pool) {
+			top->update_ph3(gclk);
+			return;
+		}
+
+		int num_instances = GetSize(instances);
+		thread_pool->run([&](const ParallelDispatchThreadPool::RunCtx &ctx) {
+			for (int i : ctx.item_range(num_instances))
+				instances[i]->update_ph3_past();
+		});
+		top->update_ph3(gclk, false);
+	}
+
 	void register_signals()
 	{
 		next_output_id = 1;
@@ -1400,17 +1629,175 @@ struct SimWorker : SimShared
 		for(auto& writer : outputfiles)
 			writer->write(use_signal);
 
+		if (compiled_sim)
+			store_compiled_memories();
+
 		if (writeback) {
 			pool<Module*> wbmods;
 			top->writeback(wbmods);
 		}
 	}
 
+	void setup_compiled()
+	{
+		if (!top->children.empty())
+			log_error("Compiled simulation requires a flattened design. Run 'flatten' first.\n");
+
+		// every wire that is traced, compared against a simulation file or
+		// read back is made available as an output of the functional IR
+		pool<Wire*> observed;
+		for (auto &it : top->signal_database)
+			observed.insert(it.first);
+		for (auto &it : top->fst_handles)
+			observed.insert(it.first);
+
+		log("Generating functional IR for module %s.\n", log_id(top->module));
+		Functional::IR ir = Functional::IR::from_module(top->module, observed);
+		compiled_sim = std::make_unique<CompiledSim>(ir);
+		auto &c = *compiled_sim;
+		log("Compiled simulation uses %d instructions on %d words of state.\n", c.num_insns(), c.num_words());
+
+		for (int i = 0; i < GetSize(c.inputs); i++)
+			if (c.inputs[i].kind == ID($input))
+				compiled_inputs.emplace_back(i, top->module->wire(c.inputs[i].name));
+
+		for (int i = 0; i < GetSize(c.outputs); i++) {
+			auto &output = c.outputs[i];
+			if (output.kind.in(ID($output), ID($observe)))
+				compiled_outputs.emplace_back(i, top->module->wire(output.name));
+			else if (output.kind.in(ID($assert), ID($assume)))
+				compiled_checks.emplace_back(i, top->module->cell(output.name));
+		}
+
+		for (int i = 0; i < GetSize(c.states); i++) {
+			auto &state = c.states[i];
+			if (state.name == ID($initstate)) {
+				compiled_initstate = i;
+				continue;
+			}
+			Cell *cell = top->module->cell(state.name);
+			log_assert(cell != nullptr);
+			if (state.is_memory) {
+				compiled_mems.emplace_back(i, top->mem_cells.at(cell));
+			} else {
+				SigSpec sig_q = top->sigmap(top->ff_database.at(cell).data.sig_q);
+				for (int j = 0; j < GetSize(sig_q); j++)
+					compiled_q_bits[sig_q[j]] = GetSize(compiled_ffs);
+				compiled_ffs.emplace_back(i, sig_q);
+			}
+		}
+	}
+
+	void store_compiled_memories()
+	{
+		auto &c = *compiled_sim;
+		for (auto &it : compiled_mems) {
+			auto &mdb = top->mem_database.at(it.second);
+			for (int i = 0; i < mdb.mem->size; i++)
+				if (((mdb.mem->start_offset + i) >> c.states[it.first].addr_width) == 0)
+					top->set_memory_state(it.second, mdb.mem->start_offset + i, c.get_memory_word(it.first, mdb.mem->start_offset + i));
+		}
+	}
+
+	void update_compiled(bool gclk)
+	{
+		if (!compiled_sim)
+			setup_compiled();
+		auto &c = *compiled_sim;
+
+		if (debug)
+			log("\n-- compiled --\n");
+
+		// pick up state that was changed from outside, e.g. when replaying
+		// a simulation file; x bits keep the value of the compiled state
+		pool<int> reload_ffs;
+		for (auto bit : top->dirty_bits) {
+			auto it = compiled_q_bits.find(bit);
+			if (it != compiled_q_bits.end())
+				reload_ffs.insert(it->second);
+		}
+		for (int idx : reload_ffs) {
+			auto &ff = compiled_ffs[idx];
+			Const value = c.get_state(ff.first);
+			Const external = top->get_state(ff.second);
+			for (int i = 0; i < GetSize(value); i++)
+				if (external[i] == State::S0 || external[i] == State::S1)
+					value.set(i, external[i]);
+			c.set_state(ff.first, value);
+		}
+		for (auto &it : compiled_mems) {
+			if (!top->dirty_memories.count(it.second))
+				continue;
+			auto &mdb = top->mem_database.at(it.second);
+			for (int i = 0; i < mdb.mem->size; i++)
+				if (((mdb.mem->start_offset + i) >> c.states[it.first].addr_width) == 0)
+					c.set_memory_word(it.first, mdb.mem->start_offset + i, mdb.data.extract(i * mdb.mem->width, mdb.mem->width));
+		}
+
+		if (gclk) {
+			// the next state is only known once the design has been evaluated
+			if (!compiled_settled) {
+				for (auto &it : compiled_inputs)
+					c.set_input(it.first, top->get_state(it.second));
+				c.eval();
+			}
+			c.commit();
+		}
+
+		if (compiled_initstate >= 0 && !top->initstate_database.empty()) {
+			Const value = top->get_state((*top->initstate_database.begin())->getPort(ID::Y));
+			if (value.is_fully_def())
+				c.set_state(compiled_initstate, value);
+		}
+
+		for (auto &it : compiled_inputs)
+			c.set_input(it.first, top->get_state(it.second));
+
+		c.eval();
+		compiled_settled = true;
+
+		for (auto &it : compiled_outputs)
+			top->set_state(it.second, c.get_output(it.first));
+		for (auto &it : compiled_ffs)
+			top->set_state(it.second, c.get_state(it.first));
+
+		if (gclk) {
+			for (auto &it : compiled_checks) {
+				if (c.get_output(it.first)[0] == State::S1)
+					continue;
+				Cell *cell = it.second;
+				string label = cell->name.unescape();
+				if (cell->attributes.count(ID::src))
+					label = cell->attributes.at(ID::src).decode_string();
+				triggered_assertions.emplace_back(step, top, cell);
+				if (cell->type == ID($assume)) {
+					log("Assumption %s.%s (%s) failed.\n", top->hiername(), cell, label);
+				} else {
+					top->log_cell_w_hierarchy("Failed assertion", cell);
+					if (serious_asserts)
+						log_error("Assertion %s.%s (%s) failed.\n", top->hiername(), cell, label);
+					else
+						log_warning("Assertion %s.%s (%s) failed.\n", top->hiername(), cell, label);
+				}
+			}
+		}
+
+		top->dirty_bits.clear();
+		top->dirty_memories.clear();
+	}
+
 	void update(bool gclk)
 	{
 		if (gclk)
 			step += 1;
 
+		if (compiled) {
+			update_compiled(gclk);
+			return;
+		}
+
+		setup_threads();
+
 		while (1)
 		{
 			if (debug)
@@ -1421,18 +1808,24 @@ struct SimWorker : SimShared
 			if (debug)
 				log("\n-- ph2 --\n");
 
-			if (!top->update_ph2(gclk))
+			if (!update_ph2(gclk))
 				break;
 		}
 
 		if (debug)
 			log("\n-- ph3 --\n");
 
-		top->update_ph3(gclk);
+		update_ph3(gclk);
 	}
 
 	void initialize_stable_past()
 	{
+		if (compiled) {
+			update_compiled(false);
+			return;
+		}
+
+		setup_threads();
 
 		while (1)
 		{
@@ -1444,13 +1837,13 @@ struct SimWorker : SimShared
 			if (debug)
 				log("\n-- ph2 (initialize) --\n");
 
-			if (!top->update_ph2(false, true))
+			if (!update_ph2(false, true))
 				break;
 		}
 
 		if (debug)
 			log("\n-- ph3 (initialize) --\n");
-		top->update_ph3(true);
+		update_ph3(true);
 	}
 
 	void set_inports(pool<IdString> ports, State value)
@@ -1627,7 +2020,13 @@ struct SimWorker : SimShared
 		bool all_samples = fst_clock.empty();
 		unsigned int end_cycle = cycles_set ? numcycles*2 : INT_MAX;
 
-		fst->reconstructAllAtTimes(fst_clock, startCount, stopCount, end_cycle, [&](uint64_t time) {
+		std::vector<fstHandle> read_handles;
+		top->getFstReadHandles(read_handles);
+		fst->setReadHandles(read_handles);
+
+		uint64_t time;
+		fst->beginSamples(fst_clock, startCount, stopCount, end_cycle);
+		while (fst->nextSample(time)) {
 			if (verbose)
 				log("Co-simulating %s %d [%lu%s].\n", (all_samples ? "sample" : "cycle"), cycle, (unsigned long)time, fst->getTimescaleString());
 			bool did_something = top->setInputs();
@@ -1645,7 +2044,7 @@ struct SimWorker : SimShared
 			if (status)
 				log_error("Signal difference\n");
 			cycle++;
-		});
+		}
 
 		write_output_files();
 		delete fst;
@@ -2319,7 +2718,19 @@ struct SimWorker : SimShared
 		std::ofstream data_file(tb_filename+".txt");
 		std::stringstream initstate;
 		unsigned int end_cycle = cycles_set ? numcycles*2 : INT_MAX;
-		fst->reconstructAllAtTimes(fst_clock, startCount, stopCount, end_cycle, [&](uint64_t time) {
+		std::vector<fstHandle> read_handles;
+		for(auto &item : inputs)
+			read_handles.push_back(item.second);
+		for(auto &item : outputs)
+			read_handles.push_back(item.second);
+		for(auto var : fst->getVars())
+			if (var.is_reg && (var.scope == scope || var.scope.find(scope+".")==0))
+				read_handles.push_back(var.id);
+		fst->setReadHandles(read_handles);
+
+		uint64_t time;
+		fst->beginSamples(fst_clock, startCount, stopCount, end_cycle);
+		while (fst->nextSample(time)) {
 			for(auto &item : clocks)
 				data_file << stringf("%s",fst->valueOf(item.second));
 			for(auto &item : inputs)
@@ -2342,7 +2753,7 @@ struct SimWorker : SimShared
 			}
 			cycle++;
 			prev_time = time;
-		});
+		}
 
 		f << stringf("\treg [0:%d] data [0:%d];\n", data_len-1, cycle-1);
 		f << "\tinitial begin;\n";
@@ -2396,6 +2807,21 @@ std::string form_vcd_name(const char *name, int size, Wire *w)
 	return full_name;
 }
 
+static void append_value(std::string &out, const Const &value)
+{
+	for (int i = GetSize(value)-1; i >= 0; i--) {
+		switch (value[i]) {
+			case State::S0: out += '0'; break;
+			case State::S1: out += '1'; break;
+			case State::Sx: out += 'x'; break;
+			default: out += 'z';
+		}
+	}
+}
+
+// size at which formatted output is handed off to the file or compressor
+static const size_t output_buffer_size = 1 << 20;
+
 struct VCDWriter : public OutputWriter
 {
 	VCDWriter(SimWorker *worker, std::string filename) : OutputWriter(worker) {
@@ -2434,25 +2860,28 @@ struct VCDWriter : public OutputWriter
 
 		vcdfile << stringf("$enddefinitions $end\n");
 
+		std::string buffer;
+		buffer.reserve(output_buffer_size + 4096);
 		for(auto& d : worker->output_data)
 		{
-			vcdfile << stringf("#%d\n", d.first);
+			buffer += '#';
+			buffer += std::to_string(d.first);
+			buffer += '\n';
 			for (auto &data : d.second)
 			{
 				if (!use_signal.at(data.first)) continue;
-				Const value = data.second;
-				vcdfile << "b";
-				for (int i = GetSize(value)-1; i >= 0; i--) {
-					switch (value[i]) {
-						case State::S0: vcdfile << "0"; break;
-						case State::S1: vcdfile << "1"; break;
-						case State::Sx: vcdfile << "x"; break;
-						default: vcdfile << "z";
-					}
-				}
-				vcdfile << stringf(" n%d\n", data.first);
+				buffer += 'b';
+				append_value(buffer, data.second);
+				buffer += " n";
+				buffer += std::to_string(data.first);
+				buffer += '\n';
+			}
+			if (buffer.size() >= output_buffer_size) {
+				vcdfile.write(buffer.data(), buffer.size());
+				buffer.clear();
 			}
 		}
+		vcdfile.write(buffer.data(), buffer.size());
 	}
 
 	std::ofstream vcdfile;
@@ -2496,25 +2925,59 @@ struct FSTWriter : public OutputWriter
 			}
 		);
 
+		// Values are formatted into chunks on this thread, while a background
+		// thread (if available) owns the FST context from here on and does the
+		// compression when emitting them.
+		ConcurrentQueue<std::unique_ptr<Chunk>> queue(4);
+		ThreadPool compressor(ThreadPool::pool_size(1, 1), [this, &queue](int) {
+			while (std::optional<std::unique_ptr<Chunk>> chunk = queue.pop_front())
+				emit(**chunk);
+		});
+		bool background = compressor.num_threads() > 0;
+
+		auto chunk = std::make_unique<Chunk>();
 		for(auto& d : worker->output_data)
 		{
-			fstWriterEmitTimeChange(fstfile, d.first);
+			chunk->changes.push_back({0, (uint64_t)d.first, 0});
 			for (auto &data : d.second)
 			{
 				if (!use_signal.at(data.first)) continue;
-				Const value = data.second;
-				std::stringstream ss;
-				for (int i = GetSize(value)-1; i >= 0; i--) {
-					switch (value[i]) {
-						case State::S0: ss << "0"; break;
-						case State::S1: ss << "1"; break;
-						case State::Sx: ss << "x"; break;
-						default: ss << "z";
-					}
-				}
-				fstWriterEmitValueChange(fstfile, mapping[data.first], ss.str().c_str());
+				chunk->changes.push_back({mapping.at(data.first), 0, chunk->text.size()});
+				append_value(chunk->text, data.second);
+				chunk->text += '\0';
+			}
+			if (chunk->text.size() >= output_buffer_size) {
+				if (background)
+					queue.push_back(std::move(chunk));
+				else
+					emit(*chunk);
+				chunk = std::make_unique<Chunk>();
 			}
 		}
+		if (background) {
+			queue.push_back(std::move(chunk));
+			queue.close();
+		} else
+			emit(*chunk);
+	}
+
+	struct Chunk {
+		struct Change {
+			fstHandle handle; // 0 for a time change
+			uint64_t time;
+			size_t offset;    // of the value in text
+		};
+		std::vector<Change> changes;
+		std::string text;
+	};
+
+	void emit(const Chunk &chunk)
+	{
+		for (auto &change : chunk.changes)
+			if (change.handle == 0)
+				fstWriterEmitTimeChange(fstfile, change.time);
+			else
+				fstWriterEmitValueChange(fstfile, change.handle, chunk.text.data() + change.offset);
 	}
 
 	struct fstWriterContext *fstfile = nullptr;
@@ -2702,6 +3165,14 @@ struct SimPass : public Pass {
 		log("    -noinitstate\n");
 		log("        do not activate $initstate cells during the first cycle\n");
 		log("\n");
+		log("    -compiled\n");
+		log("        instead of interpreting the design cell by cell, translate the\n");
+		log("        functional IR of the top module (as used by write_functional_cxx)\n");
+		log("        into a flat instruction list and evaluate that once per update.\n");
+		log("        the design must be accepted by the functional backend, so it has\n");
+		log("        to be flattened and prepared with e.g. clk2fflogic. simulation is\n");
+		log("        two-valued (x is simulated as 0) and $print cells are unsupported.\n");
+		log("\n");
 		log("    -a\n");
 		log("        use all nets in VCD/FST operations, not just those with public names\n");
 		log("\n");
@@ -2821,6 +3292,10 @@ struct SimPass : public Pass {
 				worker.initstate = false;
 				continue;
 			}
+			if (args[argidx] == "-compiled") {
+				worker.compiled = true;
+				continue;
+			}
 			if (args[argidx] == "-rstlen" && argidx+1 < args.size()) {
 				worker.rstlen = atoi(args[++argidx].c_str());
 				continue;
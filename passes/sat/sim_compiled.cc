@@ -0,0 +1,649 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "passes/sat/sim_compiled.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+using Functional::Fn;
+using Functional::Node;
+
+// memories are stored densely, so refuse anything that would not fit comfortably
+static constexpr int max_memory_addr_width = 24;
+
+static inline int word_count(int width) { return std::max(1, (width + 63) / 64); }
+static inline uint64_t width_mask(int width) { return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1; }
+static inline uint64_t top_mask(int width) { return width % 64 ? (uint64_t(1) << (width % 64)) - 1 : ~uint64_t(0); }
+static inline int64_t sign_extend64(uint64_t v, int width) { return (int64_t)(v << (64 - width)) >> (64 - width); }
+static inline bool get_bit(const uint64_t *v, int pos) { return (v[pos / 64] >> (pos % 64)) & 1; }
+
+static inline uint64_t parity64(uint64_t v)
+{
+	v ^= v >> 32;
+	v ^= v >> 16;
+	v ^= v >> 8;
+	v ^= v >> 4;
+	v ^= v >> 2;
+	v ^= v >> 1;
+	return v & 1;
+}
+
+// bits [pos, pos+64) of a value with n words
+static inline uint64_t extract64(const uint64_t *v, int n, int pos)
+{
+	int idx = pos / 64, sh = pos % 64;
+	uint64_t result = idx < n ? v[idx] >> sh : 0;
+	if (sh != 0 && idx + 1 < n)
+		result |= v[idx + 1] << (64 - sh);
+	return result;
+}
+
+// or `bits' into [pos, pos+64) of a value with n words
+static inline void deposit64(uint64_t *v, int n, int pos, uint64_t bits)
+{
+	int idx = pos / 64, sh = pos % 64;
+	if (idx < n)
+		v[idx] |= bits << sh;
+	if (sh != 0 && idx + 1 < n)
+		v[idx + 1] |= bits >> (64 - sh);
+}
+
+static inline int compare_unsigned(const uint64_t *a, const uint64_t *b, int n)
+{
+	for (int i = n - 1; i >= 0; i--)
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	return 0;
+}
+
+// shift amounts that do not fit into a single word are clamped
+static inline uint64_t shift_amount(const uint64_t *v, int width)
+{
+	for (int i = 1; i < word_count(width); i++)
+		if (v[i] != 0)
+			return ~uint64_t(0);
+	return v[0];
+}
+
+static inline uint64_t get_limb(const uint64_t *v, int i) { return (v[i / 2] >> (32 * (i % 2))) & 0xffffffff; }
+
+static inline void set_limb(uint64_t *v, int i, uint64_t limb)
+{
+	int sh = 32 * (i % 2);
+	v[i / 2] = (v[i / 2] & ~(uint64_t(0xffffffff) << sh)) | (limb << sh);
+}
+
+struct CompiledSim::Builder : Functional::AbstractVisitor<void>
+{
+	CompiledSim &sim;
+	std::vector<int> &node_slot;
+	std::vector<int> &node_mem;
+	dict<std::pair<IdString, IdString>, int> &input_slot;
+	dict<std::pair<IdString, IdString>, int> &state_slot;
+
+	Builder(CompiledSim &sim, std::vector<int> &node_slot, std::vector<int> &node_mem,
+			dict<std::pair<IdString, IdString>, int> &input_slot, dict<std::pair<IdString, IdString>, int> &state_slot) :
+			sim(sim), node_slot(node_slot), node_mem(node_mem), input_slot(input_slot), state_slot(state_slot) { }
+
+	int slot(Node n) { return node_slot[n.id()]; }
+
+	void emit(Node self, int a, int a_width, int b = 0, int b_width = 0, int c = 0, int offset = 0, bool narrow = true)
+	{
+		Insn insn;
+		insn.fn = self.fn();
+		insn.width = self.width();
+		insn.a_width = a_width;
+		insn.b_width = b_width;
+		insn.offset = offset;
+		insn.narrow = narrow && insn.width <= 64 && a_width <= 64 && b_width <= 64;
+		insn.dst = sim.alloc(insn.width);
+		insn.a = a;
+		insn.b = b;
+		insn.c = c;
+		node_slot[self.id()] = insn.dst;
+		sim.program.push_back(insn);
+	}
+
+	void unary(Node self, Node a) { emit(self, slot(a), a.width()); }
+	void binary(Node self, Node a, Node b) { emit(self, slot(a), a.width(), slot(b), b.width()); }
+
+	void buf(Node self, Node n) override
+	{
+		if (n.sort().is_memory())
+			node_mem[self.id()] = node_mem[n.id()];
+		else
+			node_slot[self.id()] = slot(n);
+	}
+	void slice(Node self, Node a, int offset, int) override { emit(self, slot(a), a.width(), 0, 0, 0, offset); }
+	void zero_extend(Node self, Node a, int) override { unary(self, a); }
+	void sign_extend(Node self, Node a, int) override { unary(self, a); }
+	void concat(Node self, Node a, Node b) override { binary(self, a, b); }
+	void add(Node self, Node a, Node b) override { binary(self, a, b); }
+	void sub(Node self, Node a, Node b) override { binary(self, a, b); }
+	void mul(Node self, Node a, Node b) override { binary(self, a, b); }
+	void unsigned_div(Node self, Node a, Node b) override { binary(self, a, b); }
+	void unsigned_mod(Node self, Node a, Node b) override { binary(self, a, b); }
+	void bitwise_and(Node self, Node a, Node b) override { binary(self, a, b); }
+	void bitwise_or(Node self, Node a, Node b) override { binary(self, a, b); }
+	void bitwise_xor(Node self, Node a, Node b) override { binary(self, a, b); }
+	void bitwise_not(Node self, Node a) override { unary(self, a); }
+	void unary_minus(Node self, Node a) override { unary(self, a); }
+	void reduce_and(Node self, Node a) override { unary(self, a); }
+	void reduce_or(Node self, Node a) override { unary(self, a); }
+	void reduce_xor(Node self, Node a) override { unary(self, a); }
+	void equal(Node self, Node a, Node b) override { binary(self, a, b); }
+	void not_equal(Node self, Node a, Node b) override { binary(self, a, b); }
+	void signed_greater_than(Node self, Node a, Node b) override { binary(self, a, b); }
+	void signed_greater_equal(Node self, Node a, Node b) override { binary(self, a, b); }
+	void unsigned_greater_than(Node self, Node a, Node b) override { binary(self, a, b); }
+	void unsigned_greater_equal(Node self, Node a, Node b) override { binary(self, a, b); }
+	void logical_shift_left(Node self, Node a, Node b) override { binary(self, a, b); }
+	void logical_shift_right(Node self, Node a, Node b) override { binary(self, a, b); }
+	void arithmetic_shift_right(Node self, Node a, Node b) override { binary(self, a, b); }
+	void mux(Node self, Node a, Node b, Node s) override
+	{
+		if (self.sort().is_memory())
+			log_error("Compiled simulation does not support multiplexing memories (node %s).\n", self.name().unescape());
+		emit(self, slot(a), a.width(), slot(b), b.width(), slot(s));
+	}
+	void constant(Node self, RTLIL::Const const &value) override
+	{
+		int dst = sim.alloc(self.width());
+		sim.store(dst, self.width(), value);
+		node_slot[self.id()] = dst;
+	}
+	void input(Node self, IdString name, IdString kind) override
+	{
+		int dst = sim.alloc(self.width());
+		input_slot[{name, kind}] = dst;
+		node_slot[self.id()] = dst;
+	}
+	void state(Node self, IdString name, IdString kind) override
+	{
+		if (self.sort().is_memory()) {
+			node_mem[self.id()] = add_memory(name, self.sort());
+			state_slot[{name, kind}] = node_mem[self.id()];
+		} else {
+			int dst = sim.alloc(self.width());
+			state_slot[{name, kind}] = dst;
+			node_slot[self.id()] = dst;
+		}
+	}
+	void memory_read(Node self, Node mem, Node addr) override
+	{
+		emit(self, node_mem[mem.id()], 0, slot(addr), addr.width(), 0, 0, false);
+	}
+	void memory_write(Node self, Node mem, Node addr, Node data) override
+	{
+		MemNode node;
+		node.memory = sim.mem_nodes[node_mem[mem.id()]].memory;
+		node.base = node_mem[mem.id()];
+		node.addr = slot(addr);
+		node.data = slot(data);
+		node_mem[self.id()] = GetSize(sim.mem_nodes);
+		sim.mem_nodes.push_back(node);
+	}
+
+	// creates the storage for a memory state and returns its root memory node
+	int add_memory(IdString name, Functional::Sort sort)
+	{
+		if (sort.addr_width() > max_memory_addr_width)
+			log_error("Memory %s has %d address bits, compiled simulation supports at most %d.\n",
+					name.unescape(), sort.addr_width(), max_memory_addr_width);
+		Memory memory;
+		memory.addr_width = sort.addr_width();
+		memory.data_width = sort.data_width();
+		memory.contents.resize((size_t(1) << memory.addr_width) * word_count(memory.data_width));
+		MemNode node;
+		node.memory = GetSize(sim.memories);
+		node.base = -1;
+		node.addr = 0;
+		node.data = 0;
+		sim.memories.push_back(std::move(memory));
+		sim.mem_nodes.push_back(node);
+		return GetSize(sim.mem_nodes) - 1;
+	}
+};
+
+CompiledSim::CompiledSim(Functional::IR &ir)
+{
+	// slot 0 always holds zero and stands in for absent operands
+	words.push_back(0);
+
+	std::vector<int> node_slot(ir.size(), -1), node_mem(ir.size(), -1);
+	dict<std::pair<IdString, IdString>, int> input_slot, state_slot;
+	Builder builder(*this, node_slot, node_mem, input_slot, state_slot);
+	for (auto node : ir)
+		node.visit(builder);
+
+	for (auto input : ir.all_inputs()) {
+		auto it = input_slot.find({input->name, input->kind});
+		int slot = it != input_slot.end() ? it->second : alloc(input->sort.width());
+		inputs.push_back({input->name, input->kind, input->sort.width(), slot});
+	}
+
+	for (auto output : ir.all_outputs()) {
+		Node value = output->value();
+		if (output->sort.is_memory())
+			log_error("Compiled simulation does not support memory outputs (output %s).\n", output->name.unescape());
+		outputs.push_back({output->name, output->kind, output->sort.width(), node_slot[value.id()]});
+	}
+
+	for (auto ir_state : ir.all_states()) {
+		StateVar state;
+		state.name = ir_state->name;
+		state.kind = ir_state->kind;
+		state.is_memory = ir_state->sort.is_memory();
+		auto it = state_slot.find({state.name, state.kind});
+		if (state.is_memory) {
+			int root = it != state_slot.end() ? it->second : builder.add_memory(state.name, ir_state->sort);
+			state.width = ir_state->sort.data_width();
+			state.addr_width = ir_state->sort.addr_width();
+			state.slot = mem_nodes[root].memory;
+			state.next = ir_state->has_next_value() ? node_mem[ir_state->next_value().id()] : root;
+			std::vector<int> chain;
+			for (int node = state.next; mem_nodes[node].base >= 0; node = mem_nodes[node].base)
+				chain.push_back(node);
+			std::reverse(chain.begin(), chain.end());
+			write_chains.push_back(std::move(chain));
+		} else {
+			state.width = ir_state->sort.width();
+			state.addr_width = 0;
+			state.slot = it != state_slot.end() ? it->second : alloc(state.width);
+			state.next = ir_state->has_next_value() ? node_slot[ir_state->next_value().id()] : state.slot;
+			write_chains.emplace_back();
+		}
+		states.push_back(state);
+
+		int index = GetSize(states) - 1;
+		if (state.is_memory) {
+			const MemContents &init = ir_state->initial_value_memory();
+			int size = 1 << state.addr_width;
+			for (int addr = 0; addr < size; addr++)
+				set_memory_word(index, addr, init.default_value());
+			for (auto range : init)
+				for (MemContents::addr_t addr = range.base(); addr < range.limit(); addr++)
+					set_memory_word(index, addr, range[addr]);
+		} else {
+			set_state(index, ir_state->initial_value_signal());
+		}
+	}
+}
+
+int CompiledSim::alloc(int width)
+{
+	int slot = GetSize(words);
+	words.resize(slot + word_count(width));
+	return slot;
+}
+
+void CompiledSim::store(int slot, int width, const Const &value)
+{
+	uint64_t *v = &words[slot];
+	std::fill(v, v + word_count(width), 0);
+	int size = std::min(width, GetSize(value));
+	for (int i = 0; i < size; i++)
+		if (value[i] == State::S1)
+			v[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+Const CompiledSim::load(int slot, int width) const
+{
+	const uint64_t *v = &words[slot];
+	Const::Builder builder(width);
+	for (int i = 0; i < width; i++)
+		builder.push_back(get_bit(v, i) ? State::S1 : State::S0);
+	return builder.build();
+}
+
+void CompiledSim::set_state(int index, const Const &value)
+{
+	log_assert(!states[index].is_memory);
+	store(states[index].slot, states[index].width, value);
+}
+
+Const CompiledSim::get_state(int index) const
+{
+	log_assert(!states[index].is_memory);
+	return load(states[index].slot, states[index].width);
+}
+
+void CompiledSim::set_memory_word(int index, int addr, const Const &value)
+{
+	const StateVar &state = states[index];
+	log_assert(state.is_memory);
+	Memory &memory = memories[state.slot];
+	int n = word_count(memory.data_width);
+	uint64_t *v = &memory.contents[size_t(addr) * n];
+	std::fill(v, v + n, 0);
+	int size = std::min(memory.data_width, GetSize(value));
+	for (int i = 0; i < size; i++)
+		if (value[i] == State::S1)
+			v[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+Const CompiledSim::get_memory_word(int index, int addr) const
+{
+	const StateVar &state = states[index];
+	log_assert(state.is_memory);
+	const Memory &memory = memories[state.slot];
+	const uint64_t *v = &memory.contents[size_t(addr) * word_count(memory.data_width)];
+	Const::Builder builder(memory.data_width);
+	for (int i = 0; i < memory.data_width; i++)
+		builder.push_back(get_bit(v, i) ? State::S1 : State::S0);
+	return builder.build();
+}
+
+void CompiledSim::read_memory(int node, uint64_t addr, uint64_t *dst) const
+{
+	const Memory &memory = memories[mem_nodes[node].memory];
+	int n = word_count(memory.data_width);
+	for (; mem_nodes[node].base >= 0; node = mem_nodes[node].base) {
+		const MemNode &write = mem_nodes[node];
+		if (words[write.addr] == addr) {
+			std::copy_n(&words[write.data], n, dst);
+			return;
+		}
+	}
+	std::copy_n(&memory.contents[addr * n], n, dst);
+}
+
+void CompiledSim::commit()
+{
+	for (int i = 0; i < GetSize(states); i++) {
+		if (!states[i].is_memory)
+			continue;
+		Memory &memory = memories[states[i].slot];
+		int n = word_count(memory.data_width);
+		for (int node : write_chains[i]) {
+			const MemNode &write = mem_nodes[node];
+			std::copy_n(&words[write.data], n, &memory.contents[words[write.addr] * n]);
+		}
+	}
+
+	// next values may refer to other states, so gather them before writing any
+	scratch.clear();
+	for (auto &state : states)
+		if (!state.is_memory)
+			scratch.insert(scratch.end(), &words[state.next], &words[state.next] + word_count(state.width));
+	auto it = scratch.begin();
+	for (auto &state : states)
+		if (!state.is_memory) {
+			std::copy_n(it, word_count(state.width), &words[state.slot]);
+			it += word_count(state.width);
+		}
+}
+
+void CompiledSim::eval()
+{
+	uint64_t *w = words.data();
+	for (auto const &insn : program)
+	{
+		if (!insn.narrow) {
+			eval_wide(insn);
+			continue;
+		}
+
+		uint64_t a = w[insn.a], b = w[insn.b];
+		uint64_t mask = width_mask(insn.width);
+		uint64_t &y = w[insn.dst];
+
+		switch (insn.fn)
+		{
+		case Fn::zero_extend: y = a; break;
+		case Fn::sign_extend: y = (uint64_t)sign_extend64(a, insn.a_width) & mask; break;
+		case Fn::slice: y = (a >> insn.offset) & mask; break;
+		case Fn::concat: y = insn.a_width < 64 ? a | (b << insn.a_width) : a; break;
+		case Fn::add: y = (a + b) & mask; break;
+		case Fn::sub: y = (a - b) & mask; break;
+		case Fn::mul: y = (a * b) & mask; break;
+		case Fn::unsigned_div: y = b ? a / b : 0; break;
+		case Fn::unsigned_mod: y = b ? a % b : 0; break;
+		case Fn::bitwise_and: y = a & b; break;
+		case Fn::bitwise_or: y = a | b; break;
+		case Fn::bitwise_xor: y = a ^ b; break;
+		case Fn::bitwise_not: y = ~a & mask; break;
+		case Fn::unary_minus: y = (0 - a) & mask; break;
+		case Fn::reduce_and: y = a == width_mask(insn.a_width); break;
+		case Fn::reduce_or: y = a != 0; break;
+		case Fn::reduce_xor: y = parity64(a); break;
+		case Fn::equal: y = a == b; break;
+		case Fn::not_equal: y = a != b; break;
+		case Fn::signed_greater_than: y = sign_extend64(a, insn.a_width) > sign_extend64(b, insn.a_width); break;
+		case Fn::signed_greater_equal: y = sign_extend64(a, insn.a_width) >= sign_extend64(b, insn.a_width); break;
+		case Fn::unsigned_greater_than: y = a > b; break;
+		case Fn::unsigned_greater_equal: y = a >= b; break;
+		case Fn::logical_shift_left: y = b < (uint64_t)insn.width ? (a << b) & mask : 0; break;
+		case Fn::logical_shift_right: y = b < (uint64_t)insn.width ? a >> b : 0; break;
+		case Fn::arithmetic_shift_right: y = (uint64_t)(sign_extend64(a, insn.width) >> std::min<uint64_t>(b, 63)) & mask; break;
+		case Fn::mux: y = w[insn.c] ? b : a; break;
+		default: log_abort();
+		}
+	}
+}
+
+void CompiledSim::eval_wide(const Insn &insn)
+{
+	uint64_t *y = &words[insn.dst];
+	const uint64_t *a = &words[insn.a], *b = &words[insn.b];
+	int n = word_count(insn.width), na = word_count(insn.a_width);
+
+	switch (insn.fn)
+	{
+	case Fn::zero_extend:
+		for (int i = 0; i < n; i++)
+			y[i] = i < na ? a[i] : 0;
+		break;
+	case Fn::sign_extend:
+		for (int i = 0; i < n; i++)
+			y[i] = i < na ? a[i] : 0;
+		if (get_bit(a, insn.a_width - 1)) {
+			y[na - 1] |= ~top_mask(insn.a_width);
+			for (int i = na; i < n; i++)
+				y[i] = ~uint64_t(0);
+		}
+		break;
+	case Fn::slice:
+		for (int i = 0; i < n; i++)
+			y[i] = extract64(a, na, insn.offset + 64 * i);
+		break;
+	case Fn::concat:
+		for (int i = 0; i < n; i++)
+			y[i] = i < na ? a[i] : 0;
+		for (int i = 0; i < word_count(insn.b_width); i++)
+			deposit64(y, n, insn.a_width + 64 * i, b[i]);
+		break;
+	case Fn::add: {
+		uint64_t carry = 0;
+		for (int i = 0; i < n; i++) {
+			uint64_t sum = a[i] + carry;
+			carry = sum < carry;
+			y[i] = sum + b[i];
+			carry |= y[i] < sum;
+		}
+		break;
+	}
+	case Fn::sub:
+	case Fn::unary_minus: {
+		// unary_minus is computed as 0 - a
+		const uint64_t *rhs = insn.fn == Fn::sub ? b : a;
+		uint64_t borrow = 0;
+		for (int i = 0; i < n; i++) {
+			uint64_t lhs = insn.fn == Fn::sub ? a[i] : 0;
+			uint64_t diff = lhs - rhs[i];
+			uint64_t next_borrow = (lhs < rhs[i]) | (diff < borrow);
+			y[i] = diff - borrow;
+			borrow = next_borrow;
+		}
+		break;
+	}
+	case Fn::mul:
+		std::fill(y, y + n, 0);
+		for (int i = 0; i < 2 * n; i++) {
+			uint64_t ai = get_limb(a, i), carry = 0;
+			if (ai == 0)
+				continue;
+			for (int j = 0; i + j < 2 * n; j++) {
+				uint64_t t = ai * get_limb(b, j) + get_limb(y, i + j) + carry;
+				set_limb(y, i + j, t & 0xffffffff);
+				carry = t >> 32;
+			}
+		}
+		break;
+	case Fn::unsigned_div:
+	case Fn::unsigned_mod: {
+		std::vector<uint64_t> q(n, 0), r(n + 1, 0), d(b, b + n);
+		d.push_back(0);
+		bool zero = true;
+		for (int i = 0; i < n; i++)
+			zero &= b[i] == 0;
+		if (zero) {
+			std::fill(y, y + n, 0);
+			break;
+		}
+		for (int i = insn.width - 1; i >= 0; i--) {
+			for (int k = n; k > 0; k--)
+				r[k] = (r[k] << 1) | (r[k - 1] >> 63);
+			r[0] = (r[0] << 1) | get_bit(a, i);
+			if (compare_unsigned(r.data(), d.data(), n + 1) >= 0) {
+				uint64_t borrow = 0;
+				for (int k = 0; k <= n; k++) {
+					uint64_t diff = r[k] - d[k];
+					uint64_t next_borrow = (r[k] < d[k]) | (diff < borrow);
+					r[k] = diff - borrow;
+					borrow = next_borrow;
+				}
+				q[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+		std::copy_n(insn.fn == Fn::unsigned_div ? q.data() : r.data(), n, y);
+		break;
+	}
+	case Fn::bitwise_and:
+		for (int i = 0; i < n; i++)
+			y[i] = a[i] & b[i];
+		break;
+	case Fn::bitwise_or:
+		for (int i = 0; i < n; i++)
+			y[i] = a[i] | b[i];
+		break;
+	case Fn::bitwise_xor:
+		for (int i = 0; i < n; i++)
+			y[i] = a[i] ^ b[i];
+		break;
+	case Fn::bitwise_not:
+		for (int i = 0; i < n; i++)
+			y[i] = ~a[i];
+		break;
+	case Fn::reduce_and: {
+		bool all = true;
+		for (int i = 0; i < na; i++)
+			all &= a[i] == (i == na - 1 ? top_mask(insn.a_width) : ~uint64_t(0));
+		y[0] = all;
+		break;
+	}
+	case Fn::reduce_or: {
+		bool any = false;
+		for (int i = 0; i < na; i++)
+			any |= a[i] != 0;
+		y[0] = any;
+		break;
+	}
+	case Fn::reduce_xor: {
+		uint64_t x = 0;
+		for (int i = 0; i < na; i++)
+			x ^= a[i];
+		y[0] = parity64(x);
+		break;
+	}
+	case Fn::equal:
+		y[0] = compare_unsigned(a, b, na) == 0;
+		break;
+	case Fn::not_equal:
+		y[0] = compare_unsigned(a, b, na) != 0;
+		break;
+	case Fn::unsigned_greater_than:
+		y[0] = compare_unsigned(a, b, na) > 0;
+		break;
+	case Fn::unsigned_greater_equal:
+		y[0] = compare_unsigned(a, b, na) >= 0;
+		break;
+	case Fn::signed_greater_than:
+	case Fn::signed_greater_equal: {
+		bool sign_a = get_bit(a, insn.a_width - 1), sign_b = get_bit(b, insn.a_width - 1);
+		int cmp = compare_unsigned(a, b, na);
+		if (sign_a != sign_b)
+			y[0] = sign_b;
+		else
+			y[0] = insn.fn == Fn::signed_greater_than ? cmp > 0 : cmp >= 0;
+		break;
+	}
+	case Fn::logical_shift_left: {
+		uint64_t amount = shift_amount(b, insn.b_width);
+		if (amount >= (uint64_t)insn.width) {
+			std::fill(y, y + n, 0);
+			break;
+		}
+		int ws = amount / 64, bs = amount % 64;
+		for (int i = n - 1; i >= 0; i--) {
+			int j = i - ws;
+			uint64_t v = j >= 0 ? a[j] << bs : 0;
+			if (bs != 0 && j - 1 >= 0)
+				v |= a[j - 1] >> (64 - bs);
+			y[i] = v;
+		}
+		break;
+	}
+	case Fn::logical_shift_right:
+	case Fn::arithmetic_shift_right: {
+		uint64_t amount = shift_amount(b, insn.b_width);
+		bool fill = insn.fn == Fn::arithmetic_shift_right && get_bit(a, insn.width - 1);
+		if (amount >= (uint64_t)insn.width) {
+			std::fill(y, y + n, fill ? ~uint64_t(0) : 0);
+			break;
+		}
+		int ws = amount / 64, bs = amount % 64;
+		for (int i = 0; i < n; i++) {
+			int j = i + ws;
+			uint64_t v = j < n ? a[j] >> bs : 0;
+			if (bs != 0 && j + 1 < n)
+				v |= a[j + 1] << (64 - bs);
+			y[i] = v;
+		}
+		if (fill) {
+			int pos = insn.width - amount;
+			for (int i = pos / 64; i < n; i++)
+				y[i] |= 64 * i >= pos ? ~uint64_t(0) : ~uint64_t(0) << (pos % 64);
+		}
+		break;
+	}
+	case Fn::mux:
+		std::copy_n(words[insn.c] ? b : a, n, y);
+		break;
+	case Fn::memory_read:
+		read_memory(insn.a, b[0], y);
+		break;
+	default:
+		log_abort();
+	}
+
+	y[n - 1] &= top_mask(insn.width);
+}
+
+YOSYS_NAMESPACE_END
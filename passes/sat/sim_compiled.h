@@ -0,0 +1,124 @@
+/* -*- c++ -*-
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef SIM_COMPILED_H
+#define SIM_COMPILED_H
+
+#include "kernel/yosys.h"
+#include "kernel/functional.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// CompiledSim evaluates the functional IR of a module (see kernel/functional.h)
+// by translating it once into a flat list of instructions operating on 64-bit
+// words. All values are two-valued; x bits are read as 0.
+//
+// Every signal node owns a slot of (width+63)/64 words in a single buffer,
+// with the bits above the node's width always kept at zero. Constants are
+// stored into their slots when the program is built, input and state nodes
+// are written directly by the caller, so eval() only runs the remaining
+// operations in topological order.
+//
+// Memory writes are not copied: a memory_write node is an overlay on top of
+// the memory it was derived from, and memory_read walks this chain before
+// falling back to the dense contents of the memory state. commit() applies
+// the chain of each memory's next value to its contents.
+struct CompiledSim
+{
+	struct Port {
+		IdString name;
+		IdString kind;
+		int width;
+		int slot;
+	};
+
+	struct StateVar {
+		IdString name;
+		IdString kind;
+		bool is_memory;
+		int width;        // data width for memories
+		int addr_width;   // memories only
+		int slot;         // state slot (signals) or memory index (memories)
+		int next;         // next value slot (signals) or memory node (memories)
+	};
+
+	std::vector<Port> inputs;
+	std::vector<Port> outputs;
+	std::vector<StateVar> states;
+
+	CompiledSim(Functional::IR &ir);
+
+	// evaluate all nodes for the current inputs and states
+	void eval();
+	// replace each state by its next value computed by the last eval()
+	void commit();
+
+	void set_input(int index, const Const &value) { store(inputs[index].slot, inputs[index].width, value); }
+	Const get_output(int index) const { return load(outputs[index].slot, outputs[index].width); }
+	void set_state(int index, const Const &value);
+	Const get_state(int index) const;
+	void set_memory_word(int index, int addr, const Const &value);
+	Const get_memory_word(int index, int addr) const;
+
+	int num_words() const { return GetSize(words); }
+	int num_insns() const { return GetSize(program); }
+
+private:
+	struct Insn {
+		Functional::Fn fn;
+		bool narrow;
+		int width;
+		int a_width;
+		int b_width;
+		int offset;
+		int dst, a, b, c;
+	};
+
+	struct MemNode {
+		int memory;       // index into memories
+		int base;         // memory node this one was derived from, -1 for the state itself
+		int addr;         // address slot of the write
+		int data;         // data slot of the write
+	};
+
+	struct Memory {
+		int addr_width;
+		int data_width;
+		std::vector<uint64_t> contents;
+	};
+
+	std::vector<uint64_t> words;
+	std::vector<Insn> program;
+	std::vector<MemNode> mem_nodes;
+	std::vector<Memory> memories;
+	std::vector<std::vector<int>> write_chains;
+	std::vector<uint64_t> scratch;
+
+	struct Builder;
+	int alloc(int width);
+
+	void store(int slot, int width, const Const &value);
+	Const load(int slot, int width) const;
+	void eval_wide(const Insn &insn);
+	void read_memory(int node, uint64_t addr, uint64_t *dst) const;
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
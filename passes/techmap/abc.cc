@@ -67,8 +67,8 @@
 #include <wasi/libc.h>
 #endif
 
-#include "frontends/blif/blifparse.h"
 #include "liberty_cache.h"
+#include "abc_cache.h"
 
 #ifdef YOSYS_LINK_ABC
 namespace abc {
@@ -76,6 +76,13 @@ namespace abc {
 }
 #endif
 
+// With a linked ABC, the files of each run are anonymous in-memory files that
+// ABC opens through /proc, so no temp directory is created for the run.
+#if defined(YOSYS_LINK_ABC) && defined(__linux__)
+#  include <sys/mman.h>
+#  define ABC_IN_MEMORY_FILES
+#endif
+
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
@@ -136,6 +143,10 @@ struct AbcConfig
 	bool map_mux8 = false;
 	bool map_mux16 = false;
 	bool markgroups = false;
+	bool result_cache = false;
+	std::string result_cache_dir;
+	// paths and content hashes of the library files, computed once per call
+	std::string result_cache_files;
 	pool<std::string> enabled_gates;
 	bool cmos_cost = false;
 
@@ -281,18 +292,87 @@ struct RunAbcState {
 	const AbcConfig &config;
 
 	std::string per_run_tempdir_name;
+	std::string input_file, output_file, script_file, stdouterr_file;
+	bool in_memory = false;
+	std::vector<int> memfds;
 	std::vector<gate_t> signal_list;
 	bool did_run = false;
 	bool err = false;
+	bool cache_hit = false;
 	DeferredLogs logs;
 	dict<int, std::string> pi_map, po_map;
 	std::string abc_script;
 	std::string dont_use_args;
 
 	RunAbcState(const AbcConfig &config) : config(config) {}
+	std::string add_run_file(const char *name);
+	void close_run_files();
+	std::string result_cache_key() const;
 	void run(ConcurrentStack<AbcProcess> &process_pool);
 };
 
+std::string RunAbcState::add_run_file(const char *name)
+{
+#ifdef ABC_IN_MEMORY_FILES
+	if (in_memory) {
+		int fd = memfd_create(name, MFD_CLOEXEC);
+		if (fd < 0)
+			log_error("Creating in-memory file %s failed: %s\n", name, strerror(errno));
+		memfds.push_back(fd);
+		return stringf("%s/%d", per_run_tempdir_name, fd);
+	}
+#endif
+	return stringf("%s/%s", per_run_tempdir_name, name);
+}
+
+void RunAbcState::close_run_files()
+{
+	for (int fd : memfds)
+		close(fd);
+	memfds.clear();
+}
+
+// Hashes everything the result of the run depends on: the extracted netlist,
+// the script, the files read by the script and the ABC and Yosys builds. The
+// netlist names signals by their index only, so identical logic extracted
+// from different places has the same key.
+std::string RunAbcState::result_cache_key() const
+{
+	std::string hash_input = yosys_version_str;
+	hash_input += "|";
+	hash_input += yosys_build_datetime_str;
+	hash_input += "|abc:" + abc_cache_file_identity(config.exe_file);
+
+	std::string script = abc_script;
+	for (auto &it : {std::make_pair(input_file, "<input>"), std::make_pair(output_file, "<output>"),
+			std::make_pair(config.global_tempdir_name, "<global>")})
+		for (size_t pos = script.find(it.first); pos != std::string::npos; pos = script.find(it.first, pos))
+			script.replace(pos, it.first.size(), it.second);
+	hash_input += "|script:" + script;
+
+	if (!config.lut_costs.empty())
+		hash_input += "|lutdefs:" + abc_cache_file_contents(config.global_tempdir_name + "/lutdefs.txt");
+	else if (config.liberty_files.empty() && config.genlib_files.empty())
+		hash_input += "|genlib:" + abc_cache_file_contents(config.global_tempdir_name + "/stdcells.genlib");
+	hash_input += config.result_cache_files;
+
+	hash_input += "|netlist:" + abc_cache_file_contents(input_file, "# ");
+	return sha1(hash_input);
+}
+
+// A cell of the mapped netlist, connected to wires of the module it is added to.
+struct AbcMappedCell {
+	RTLIL::IdString type;
+	std::string name;
+	dict<RTLIL::IdString, RTLIL::SigSpec> ports;
+	dict<RTLIL::IdString, RTLIL::Const> parameters;
+	RTLIL::State init = RTLIL::State::Sx;
+	// set for `.names`, whose truth table rows follow on the next lines
+	bool is_names = false;
+	// a `.names` without rows is constant 0
+	RTLIL::State lut_default = RTLIL::State::S0;
+};
+
 struct AbcModuleState {
 	RunAbcState run_abc;
 
@@ -300,6 +380,7 @@ struct AbcModuleState {
 	int map_autoidx = 0;
 	std::vector<RTLIL::SigBit> signal_bits;
 	dict<RTLIL::SigBit, int> signal_map;
+	dict<std::string, RTLIL::Wire*> mapped_wires;
 	FfInitVals &initvals;
 	bool had_init = false;
 
@@ -318,11 +399,14 @@ struct AbcModuleState {
 	int map_signal(const AbcSigMap &assign_map, RTLIL::SigBit bit, gate_type_t gate_type = G(NONE), int in1 = -1, int in2 = -1, int in3 = -1, int in4 = -1);
 	void mark_port(const AbcSigMap &assign_map, RTLIL::SigSpec sig);
 	bool extract_cell(const AbcSigMap &assign_map, RTLIL::Module *module, RTLIL::Cell *cell, bool keepff);
-	std::string remap_name(RTLIL::IdString abc_name, RTLIL::Wire **orig_wire = nullptr);
+	std::string remap_name(const std::string &abc_name, RTLIL::Wire **orig_wire = nullptr);
 	void dump_loop_graph(FILE *f, int &nr, dict<int, pool<int>> &edges, pool<int> &workpool, std::vector<int> &in_counts);
 	void handle_loops(AbcSigMap &assign_map, RTLIL::Module *module);
 	void prepare_module(RTLIL::Design *design, RTLIL::Module *module, AbcSigMap &assign_map, const std::vector<RTLIL::Cell*> &cells,
 		bool dff_mode, std::string clk_str);
+	RTLIL::Wire *mapped_wire(RTLIL::Design *design, RTLIL::Module *module, const std::string &net);
+	void emit_mapped_cell(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL::Module *module, AbcMappedCell &c,
+		dict<std::string, int> &cell_stats);
 	void extract(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL::Module *module);
 	void finish();
 };
@@ -585,9 +669,9 @@ bool AbcModuleState::extract_cell(const AbcSigMap &assign_map, RTLIL::Module *mo
 	return false;
 }
 
-std::string AbcModuleState::remap_name(RTLIL::IdString abc_name, RTLIL::Wire **orig_wire)
+std::string AbcModuleState::remap_name(const std::string &abc_name, RTLIL::Wire **orig_wire)
 {
-	std::string abc_sname = abc_name.substr(1);
+	std::string abc_sname = abc_name;
 	bool isnew = false;
 	if (abc_sname.compare(0, 4, "new_") == 0)
 	{
@@ -621,7 +705,7 @@ std::string AbcModuleState::remap_name(RTLIL::IdString abc_name, RTLIL::Wire **o
 			}
 		}
 	}
-	return stringf("$abc$%d$%s", map_autoidx, abc_name.substr(1));
+	return stringf("$abc$%d$%s", map_autoidx, abc_name);
 }
 
 void AbcModuleState::dump_loop_graph(FILE *f, int &nr, dict<int, pool<int>> &edges, pool<int> &workpool, std::vector<int> &in_counts)
@@ -1003,16 +1087,31 @@ void AbcModuleState::prepare_module(RTLIL::Design *design, RTLIL::Module *module
 		log_cmd_error("Clock domain %s not found.\n", clk_str);
 
 	const AbcConfig &config = run_abc.config;
-	if (config.cleanup)
-		run_abc.per_run_tempdir_name = get_base_tmpdir() + "/";
-	else
-		run_abc.per_run_tempdir_name = "_tmp_";
-	run_abc.per_run_tempdir_name += proc_program_prefix() + "yosys-abc-XXXXXX";
-	run_abc.per_run_tempdir_name = make_temp_dir(run_abc.per_run_tempdir_name);
-	log_header(design, "Extracting gate netlist of module `%s' to `%s/input.blif'..\n",
-			module->name.c_str(), replace_tempdir(run_abc.per_run_tempdir_name, config.global_tempdir_name, run_abc.per_run_tempdir_name, config.show_tempdir).c_str());
+#ifdef ABC_IN_MEMORY_FILES
+	// `dress` derives the file format from the file name extension
+	run_abc.in_memory = config.cleanup && !config.abc_dress;
+#endif
+	if (run_abc.in_memory) {
+		run_abc.per_run_tempdir_name = "/proc/self/fd";
+		log_header(design, "Extracting gate netlist of module `%s' to an in-memory file..\n", module->name.c_str());
+	} else {
+		if (config.cleanup)
+			run_abc.per_run_tempdir_name = get_base_tmpdir() + "/";
+		else
+			run_abc.per_run_tempdir_name = "_tmp_";
+		run_abc.per_run_tempdir_name += proc_program_prefix() + "yosys-abc-XXXXXX";
+		run_abc.per_run_tempdir_name = make_temp_dir(run_abc.per_run_tempdir_name);
+		log_header(design, "Extracting gate netlist of module `%s' to `%s/input.blif'..\n",
+				module->name.c_str(), replace_tempdir(run_abc.per_run_tempdir_name, config.global_tempdir_name, run_abc.per_run_tempdir_name, config.show_tempdir).c_str());
+	}
+	run_abc.input_file = run_abc.add_run_file("input.blif");
+	run_abc.output_file = run_abc.add_run_file("output.blif");
+	run_abc.script_file = run_abc.add_run_file("abc.script");
+#ifdef YOSYS_LINK_ABC
+	run_abc.stdouterr_file = run_abc.add_run_file("stdouterr.txt");
+#endif
 
-	run_abc.abc_script = stringf("read_blif \"%s/input.blif\"; ", run_abc.per_run_tempdir_name);
+	run_abc.abc_script = stringf("read_blif \"%s\"; ", run_abc.input_file);
 
 	if (!config.liberty_files.empty() || !config.genlib_files.empty()) {
 		run_abc.dont_use_args = "";
@@ -1084,8 +1183,8 @@ void AbcModuleState::prepare_module(RTLIL::Design *design, RTLIL::Module *module
 		run_abc.abc_script = run_abc.abc_script.substr(0, pos) + config.delay_target + run_abc.abc_script.substr(pos+3);
 
 	if (config.abc_dress)
-		run_abc.abc_script += stringf("; dress \"%s/input.blif\"", run_abc.per_run_tempdir_name);
-	run_abc.abc_script += stringf("; write_blif %s/output.blif", run_abc.per_run_tempdir_name);
+		run_abc.abc_script += stringf("; dress \"%s\"", run_abc.input_file);
+	run_abc.abc_script += stringf("; write_blif %s", run_abc.output_file);
 	run_abc.abc_script = add_echos_to_abc_cmd(run_abc.abc_script);
 #if defined(REUSE_YOSYS_ABC_PROCESSES)
 	if (config.is_yosys_abc())
@@ -1096,10 +1195,9 @@ void AbcModuleState::prepare_module(RTLIL::Design *design, RTLIL::Module *module
 		if (run_abc.abc_script[i] == ';' && run_abc.abc_script[i+1] == ' ')
 			run_abc.abc_script[i+1] = '\n';
 
-	std::string buffer = stringf("%s/abc.script", run_abc.per_run_tempdir_name);
-	FILE *f = fopen(buffer.c_str(), "wt");
+	FILE *f = fopen(run_abc.script_file.c_str(), "wt");
 	if (f == nullptr)
-		log_error("Opening %s for writing failed: %s\n", buffer, strerror(errno));
+		log_error("Opening %s for writing failed: %s\n", run_abc.script_file, strerror(errno));
 	fprintf(f, "%s\n", run_abc.abc_script.c_str());
 	fclose(f);
 
@@ -1234,10 +1332,9 @@ void RunAbcState::run(ConcurrentStack<AbcProcess> &process_pool)
 void RunAbcState::run(ConcurrentStack<AbcProcess> &)
 #endif
 {
-	std::string buffer = stringf("%s/input.blif", per_run_tempdir_name);
-	FILE *f = fopen(buffer.c_str(), "wt");
+	FILE *f = fopen(input_file.c_str(), "wt");
 	if (f == nullptr) {
-		logs.log("Opening %s for writing failed: %s\n", buffer, strerror(errno));
+		logs.log("Opening %s for writing failed: %s\n", input_file, strerror(errno));
 		err = true;
 		return;
 	}
@@ -1361,15 +1458,26 @@ void RunAbcState::run(ConcurrentStack<AbcProcess> &)
 		logs.log("Don't call ABC as there is nothing to map.\n");
 		return;
 	}
+	std::string cache_key;
+	if (config.result_cache) {
+		cache_key = result_cache_key();
+		if (abc_cache_lookup(config.result_cache_dir, cache_key, output_file)) {
+			logs.log("Reusing cached ABC result %s.\n", cache_key);
+			cache_hit = true;
+			did_run = true;
+			return;
+		}
+	}
+
 	int ret;
-	std::string tmp_script_name = stringf("%s/abc.script", per_run_tempdir_name);
+	const std::string &tmp_script_name = script_file;
 	do {
 		logs.log("Running ABC script: %s\n", replace_tempdir(tmp_script_name, config.global_tempdir_name, per_run_tempdir_name, config.show_tempdir));
 
 		errno = 0;
 		abc_output_filter filt(*this, config.global_tempdir_name, per_run_tempdir_name, config.show_tempdir);
 #ifdef YOSYS_LINK_ABC
-		string temp_stdouterr_name = stringf("%s/stdouterr.txt", per_run_tempdir_name);
+		const string &temp_stdouterr_name = stdouterr_file;
 		FILE *temp_stdouterr_w = fopen(temp_stdouterr_name.c_str(), "w");
 		if (temp_stdouterr_w == NULL)
 			logs.log_error("ABC: cannot open a temporary file for output redirection");
@@ -1444,6 +1552,8 @@ void RunAbcState::run(ConcurrentStack<AbcProcess> &)
 		logs.log_error("ABC: execution of script \"%s\" failed: return code %d (errno=%d).\n", tmp_script_name, ret, errno);
 		return;
 	}
+	if (config.result_cache && !abc_cache_store(config.result_cache_dir, cache_key, output_file))
+		logs.log_warning("ABC: cannot store the result in the cache directory.\n");
 	did_run = true;
 }
 
@@ -1506,204 +1616,133 @@ void emit_global_input_files(const AbcConfig &config)
 	}
 }
 
-void AbcModuleState::extract(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL::Module *module)
+RTLIL::Wire *AbcModuleState::mapped_wire(RTLIL::Design *design, RTLIL::Module *module, const std::string &net)
 {
-	log_push();
-	log_header(design, "Executed ABC.\n");
-	run_abc.logs.flush();
-	if (!run_abc.did_run) {
-		finish();
-		return;
-	}
-
-	std::string buffer = stringf("%s/%s", run_abc.per_run_tempdir_name, "output.blif");
-	std::ifstream ifs;
-	ifs.open(buffer);
-	if (ifs.fail())
-		log_error("Can't open ABC output file `%s'.\n", buffer);
-
-	bool builtin_lib = run_abc.config.liberty_files.empty() && run_abc.config.genlib_files.empty();
-	RTLIL::Design *mapped_design = new RTLIL::Design;
-	parse_blif(mapped_design, ifs, builtin_lib ? ID(DFF) : ID(_dff_));
-
-	ifs.close();
-
-	log_header(design, "Re-integrating ABC results.\n");
-	RTLIL::Module *mapped_mod = mapped_design->module(ID(netlist));
-	if (mapped_mod == nullptr)
-		log_error("ABC output file does not contain a module `netlist'.\n");
-	bool markgroups = run_abc.config.markgroups;
-	for (auto w : mapped_mod->wires()) {
+	RTLIL::Wire *&wire = mapped_wires[net];
+	if (wire == nullptr) {
 		RTLIL::Wire *orig_wire = nullptr;
-		RTLIL::Wire *wire = module->addWire(remap_name(w->name, &orig_wire));
+		wire = module->addWire(remap_name(net[0] == '\\' || net[0] == '$' ? net.substr(1) : net, &orig_wire));
 		if (orig_wire != nullptr && orig_wire->attributes.count(ID::src))
 			wire->attributes[ID::src] = orig_wire->attributes[ID::src];
-		if (markgroups) wire->attributes[ID::abcgroup] = map_autoidx;
+		if (run_abc.config.markgroups) wire->attributes[ID::abcgroup] = map_autoidx;
 		design->select(module, wire);
 	}
+	return wire;
+}
+
+void AbcModuleState::emit_mapped_cell(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL::Module *module, AbcMappedCell &c,
+	dict<std::string, int> &cell_stats)
+{
+	bool builtin_lib = run_abc.config.liberty_files.empty() && run_abc.config.genlib_files.empty();
+	bool markgroups = run_abc.config.markgroups;
 
-	SigMap mapped_sigmap(mapped_mod);
-	FfInitVals mapped_initvals(&mapped_sigmap, mapped_mod);
+	if (c.is_names && c.type.empty()) {
+		RTLIL::SigSig conn;
+		conn.first = c.ports.at(ID::Y);
+		conn.second = c.init;
+		connect(assign_map, module, conn);
+		return;
+	}
+	if (c.is_names) {
+		RTLIL::Const &lut = c.parameters.at(ID::LUT);
+		for (auto bit : lut)
+			if (bit == RTLIL::State::Sx)
+				bit = c.lut_default;
+	}
 
-	dict<std::string, int> cell_stats;
-	for (auto c : mapped_mod->cells())
+	cell_stats[c.type.unescape()]++;
+	if (builtin_lib)
 	{
-		if (builtin_lib)
-		{
-			cell_stats[c->type.unescape()]++;
-			if (c->type.in(ID(ZERO), ID(ONE))) {
-				RTLIL::SigSig conn;
-				RTLIL::IdString name_y = remap_name(c->getPort(ID::Y).as_wire()->name);
-				conn.first = module->wire(name_y);
-				conn.second = RTLIL::SigSpec(c->type == ID(ZERO) ? 0 : 1, 1);
-				connect(assign_map, module, conn);
-				continue;
-			}
-			if (c->type == ID(BUF)) {
-				RTLIL::SigSig conn;
-				RTLIL::IdString name_y = remap_name(c->getPort(ID::Y).as_wire()->name);
-				RTLIL::IdString name_a = remap_name(c->getPort(ID::A).as_wire()->name);
-				conn.first = module->wire(name_y);
-				conn.second = module->wire(name_a);
-				connect(assign_map, module, conn);
-				continue;
-			}
-			if (c->type == ID(NOT)) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), ID($_NOT_));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
-			}
-			if (c->type.in(ID(AND), ID(OR), ID(XOR), ID(NAND), ID(NOR), ID(XNOR), ID(ANDNOT), ID(ORNOT))) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), stringf("$_%s_", c->type.c_str()+1));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
-			}
-			if (c->type.in(ID(MUX), ID(NMUX))) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), stringf("$_%s_", c->type.c_str()+1));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::S, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
+		if (c.type.in(ID(ZERO), ID(ONE))) {
+			RTLIL::SigSig conn;
+			conn.first = c.ports.at(ID::Y);
+			conn.second = RTLIL::SigSpec(c.type == ID(ZERO) ? 0 : 1, 1);
+			connect(assign_map, module, conn);
+			return;
+		}
+		if (c.type == ID(BUF)) {
+			RTLIL::SigSig conn;
+			conn.first = c.ports.at(ID::Y);
+			conn.second = c.ports.at(ID::A);
+			connect(assign_map, module, conn);
+			return;
+		}
+		if (c.type == ID(NOT)) {
+			RTLIL::Cell *cell = module->addCell(c.name, ID($_NOT_));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
-			if (c->type == ID(MUX4)) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), ID($_MUX4_));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::S, ID::T, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
+			design->select(module, cell);
+			return;
+		}
+		if (c.type.in(ID(AND), ID(OR), ID(XOR), ID(NAND), ID(NOR), ID(XNOR), ID(ANDNOT), ID(ORNOT))) {
+			RTLIL::Cell *cell = module->addCell(c.name, stringf("$_%s_", c.type.c_str()+1));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
-			if (c->type == ID(MUX8)) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), ID($_MUX8_));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::E, ID::F, ID::G, ID::H, ID::S, ID::T, ID::U, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
+			design->select(module, cell);
+			return;
+		}
+		if (c.type.in(ID(MUX), ID(NMUX))) {
+			RTLIL::Cell *cell = module->addCell(c.name, stringf("$_%s_", c.type.c_str()+1));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::S, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
-			if (c->type == ID(MUX16)) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), ID($_MUX16_));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::E, ID::F, ID::G, ID::H, ID::I, ID::J, ID::K,
-						ID::L, ID::M, ID::N, ID::O, ID::P, ID::S, ID::T, ID::U, ID::V, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
+			design->select(module, cell);
+			return;
+		}
+		if (c.type == ID(MUX4)) {
+			RTLIL::Cell *cell = module->addCell(c.name, ID($_MUX4_));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::S, ID::T, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
-			if (c->type.in(ID(AOI3), ID(OAI3))) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), stringf("$_%s_", c->type.c_str()+1));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::C, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
+			design->select(module, cell);
+			return;
+		}
+		if (c.type == ID(MUX8)) {
+			RTLIL::Cell *cell = module->addCell(c.name, ID($_MUX8_));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::E, ID::F, ID::G, ID::H, ID::S, ID::T, ID::U, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
-			if (c->type.in(ID(AOI4), ID(OAI4))) {
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), stringf("$_%s_", c->type.c_str()+1));
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::Y}) {
-					RTLIL::IdString remapped_name = remap_name(c->getPort(name).as_wire()->name);
-					cell->setPort(name, module->wire(remapped_name));
-				}
-				design->select(module, cell);
-				continue;
+			design->select(module, cell);
+			return;
+		}
+		if (c.type == ID(MUX16)) {
+			RTLIL::Cell *cell = module->addCell(c.name, ID($_MUX16_));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::E, ID::F, ID::G, ID::H, ID::I, ID::J, ID::K,
+					ID::L, ID::M, ID::N, ID::O, ID::P, ID::S, ID::T, ID::U, ID::V, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
-			if (c->type == ID(DFF)) {
-				log_assert(clk_sig.size() == 1);
-				FfData ff(module, &initvals, remap_name(c->name));
-				ff.width = 1;
-				ff.is_fine = true;
-				ff.has_clk = true;
-				ff.pol_clk = clk_polarity;
-				ff.sig_clk = clk_sig;
-				if (en_sig.size() != 0) {
-					log_assert(en_sig.size() == 1);
-					ff.has_ce = true;
-					ff.pol_ce = en_polarity;
-					ff.sig_ce = en_sig;
-				}
-				RTLIL::Const init = mapped_initvals(c->getPort(ID::Q));
-				if (had_init)
-					ff.val_init = init;
-				else
-					ff.val_init = State::Sx;
-				if (arst_sig.size() != 0) {
-					log_assert(arst_sig.size() == 1);
-					ff.has_arst = true;
-					ff.pol_arst = arst_polarity;
-					ff.sig_arst = arst_sig;
-					ff.val_arst = init;
-				}
-				if (srst_sig.size() != 0) {
-					log_assert(srst_sig.size() == 1);
-					ff.has_srst = true;
-					ff.pol_srst = srst_polarity;
-					ff.sig_srst = srst_sig;
-					ff.val_srst = init;
-				}
-				ff.sig_d = module->wire(remap_name(c->getPort(ID::D).as_wire()->name));
-				ff.sig_q = module->wire(remap_name(c->getPort(ID::Q).as_wire()->name));
-				RTLIL::Cell *cell = ff.emit();
-				if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-				design->select(module, cell);
-				continue;
+			design->select(module, cell);
+			return;
+		}
+		if (c.type.in(ID(AOI3), ID(OAI3))) {
+			RTLIL::Cell *cell = module->addCell(c.name, stringf("$_%s_", c.type.c_str()+1));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::C, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
 			}
+			design->select(module, cell);
+			return;
 		}
-		else
-			cell_stats[c->type.unescape()]++;
-
-		if (c->type.in(ID(_const0_), ID(_const1_))) {
-			RTLIL::SigSig conn;
-			conn.first = module->wire(remap_name(c->connections().begin()->second.as_wire()->name));
-			conn.second = RTLIL::SigSpec(c->type == ID(_const0_) ? 0 : 1, 1);
-			connect(assign_map, module, conn);
-			continue;
+		if (c.type.in(ID(AOI4), ID(OAI4))) {
+			RTLIL::Cell *cell = module->addCell(c.name, stringf("$_%s_", c.type.c_str()+1));
+			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+			for (auto name : {ID::A, ID::B, ID::C, ID::D, ID::Y}) {
+				cell->setPort(name, c.ports.at(name));
+			}
+			design->select(module, cell);
+			return;
 		}
-
-		if (c->type == ID(_dff_)) {
+		if (c.type == ID(DFF)) {
 			log_assert(clk_sig.size() == 1);
-			FfData ff(module, &initvals, remap_name(c->name));
+			FfData ff(module, &initvals, c.name);
 			ff.width = 1;
 			ff.is_fine = true;
 			ff.has_clk = true;
@@ -1711,64 +1750,332 @@ void AbcModuleState::extract(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL
 			ff.sig_clk = clk_sig;
 			if (en_sig.size() != 0) {
 				log_assert(en_sig.size() == 1);
+				ff.has_ce = true;
 				ff.pol_ce = en_polarity;
 				ff.sig_ce = en_sig;
 			}
-			RTLIL::Const init = mapped_initvals(c->getPort(ID::Q));
+			RTLIL::Const init(c.init);
 			if (had_init)
 				ff.val_init = init;
 			else
 				ff.val_init = State::Sx;
 			if (arst_sig.size() != 0) {
 				log_assert(arst_sig.size() == 1);
+				ff.has_arst = true;
 				ff.pol_arst = arst_polarity;
 				ff.sig_arst = arst_sig;
 				ff.val_arst = init;
 			}
 			if (srst_sig.size() != 0) {
 				log_assert(srst_sig.size() == 1);
+				ff.has_srst = true;
 				ff.pol_srst = srst_polarity;
 				ff.sig_srst = srst_sig;
 				ff.val_srst = init;
 			}
-			ff.sig_d = module->wire(remap_name(c->getPort(ID::D).as_wire()->name));
-			ff.sig_q = module->wire(remap_name(c->getPort(ID::Q).as_wire()->name));
+			ff.sig_d = c.ports.at(ID::D);
+			ff.sig_q = c.ports.at(ID::Q);
 			RTLIL::Cell *cell = ff.emit();
 			if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
 			design->select(module, cell);
+			return;
+		}
+	}
+
+	if (c.type.in(ID(_const0_), ID(_const1_))) {
+		RTLIL::SigSig conn;
+		conn.first = c.ports.begin()->second;
+		conn.second = RTLIL::SigSpec(c.type == ID(_const0_) ? 0 : 1, 1);
+		connect(assign_map, module, conn);
+		return;
+	}
+
+	if (c.type == ID(_dff_)) {
+		log_assert(clk_sig.size() == 1);
+		FfData ff(module, &initvals, c.name);
+		ff.width = 1;
+		ff.is_fine = true;
+		ff.has_clk = true;
+		ff.pol_clk = clk_polarity;
+		ff.sig_clk = clk_sig;
+		if (en_sig.size() != 0) {
+			log_assert(en_sig.size() == 1);
+			ff.pol_ce = en_polarity;
+			ff.sig_ce = en_sig;
+		}
+		RTLIL::Const init(c.init);
+		if (had_init)
+			ff.val_init = init;
+		else
+			ff.val_init = State::Sx;
+		if (arst_sig.size() != 0) {
+			log_assert(arst_sig.size() == 1);
+			ff.pol_arst = arst_polarity;
+			ff.sig_arst = arst_sig;
+			ff.val_arst = init;
+		}
+		if (srst_sig.size() != 0) {
+			log_assert(srst_sig.size() == 1);
+			ff.pol_srst = srst_polarity;
+			ff.sig_srst = srst_sig;
+			ff.val_srst = init;
+		}
+		ff.sig_d = c.ports.at(ID::D);
+		ff.sig_q = c.ports.at(ID::Q);
+		RTLIL::Cell *cell = ff.emit();
+		if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+		design->select(module, cell);
+		return;
+	}
+
+	if (c.type == ID($lut) && GetSize(c.ports.at(ID::A)) == 1 && c.parameters.at(ID::LUT).as_int() == 2) {
+		SigSpec my_a = c.ports.at(ID::A);
+		SigSpec my_y = c.ports.at(ID::Y);
+		connect(assign_map, module, RTLIL::SigSig(my_a, my_y));
+		return;
+	}
+
+	RTLIL::Cell *cell = module->addCell(c.name, c.type);
+	if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
+	cell->parameters = c.parameters;
+	for (auto &conn : c.ports)
+		cell->setPort(conn.first, conn.second);
+	design->select(module, cell);
+}
+
+// Reads a line of a BLIF file, joining lines that end in a backslash.
+static bool read_blif_line(std::istream &f, std::string &line, int &line_count)
+{
+	line.clear();
+	for (std::string part; std::getline(f, part); ) {
+		line_count++;
+		while (!part.empty() && (part.back() == ' ' || part.back() == '\t' || part.back() == '\r'))
+			part.pop_back();
+		if (!part.empty() && part.back() == '\\') {
+			part.pop_back();
+			line += part;
+			continue;
+		}
+		line += part;
+		return true;
+	}
+	return !line.empty();
+}
+
+void AbcModuleState::extract(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL::Module *module)
+{
+	log_push();
+	log_header(design, "Executed ABC.\n");
+	run_abc.logs.flush();
+	if (!run_abc.did_run) {
+		finish();
+		return;
+	}
+
+	std::ifstream ifs;
+	ifs.open(run_abc.output_file);
+	if (ifs.fail())
+		log_error("Can't open ABC output file `%s'.\n", run_abc.output_file);
+
+	// The cells of the mapped netlist are added to the module while it is
+	// read. A cell is emitted when the next directive starts, as the truth
+	// table rows, .param and .cname lines of a cell follow it.
+	log_header(design, "Re-integrating ABC results.\n");
+	bool builtin_lib = run_abc.config.liberty_files.empty() && run_abc.config.genlib_files.empty();
+	dict<std::string, int> cell_stats;
+	std::optional<AbcMappedCell> pending;
+	bool found_model = false, found_end = false;
+	int line_count = 0;
+
+	auto syntax_error = [&]() {
+		log_error("Syntax error in line %d of ABC output file `%s'.\n", line_count, run_abc.output_file);
+	};
+	auto wire = [&](const std::string &net) {
+		return mapped_wire(design, module, net);
+	};
+	auto new_cell = [&](RTLIL::IdString type) {
+		pending.emplace();
+		pending->type = type;
+		pending->name = remap_name(stringf("auto$%d", autoidx++));
+	};
+
+	for (std::string line; !found_end && read_blif_line(ifs, line, line_count); )
+	{
+		std::vector<std::string> tokens = split_tokens(line);
+		if (tokens.empty() || tokens[0][0] == '#')
+			continue;
+		const std::string &cmd = tokens[0];
+
+		if (cmd[0] != '.') {
+			if (!pending || !pending->is_names)
+				syntax_error();
+			if (pending->type.empty()) {
+				for (char ch : line)
+					if (ch == '1' && pending->init != RTLIL::State::Sx)
+						pending->init = RTLIL::State::S1;
+					else if (ch != '0' && ch != '1' && ch != ' ' && ch != '\t')
+						syntax_error();
+				continue;
+			}
+			if (GetSize(tokens) != 2 || (tokens[1] != "0" && tokens[1] != "1"))
+				syntax_error();
+			const std::string &input = tokens[0];
+			RTLIL::Const &lut = pending->parameters.at(ID::LUT);
+			if (GetSize(input) != GetSize(pending->ports.at(ID::A)))
+				syntax_error();
+			RTLIL::State value = tokens[1] == "1" ? RTLIL::State::S1 : RTLIL::State::S0;
+			for (int i = 0; i < GetSize(lut); i++) {
+				bool match = true;
+				for (int j = 0; j < GetSize(input) && match; j++)
+					if (input[j] != '-' && input[j] != (((i >> j) & 1) ? '1' : '0'))
+						match = false;
+				if (match)
+					lut.set(i, value);
+			}
+			pending->lut_default = value == RTLIL::State::S1 ? RTLIL::State::S0 : RTLIL::State::S1;
 			continue;
 		}
 
-		if (c->type == ID($lut) && GetSize(c->getPort(ID::A)) == 1 && c->getParam(ID::LUT).as_int() == 2) {
-			SigSpec my_a = module->wire(remap_name(c->getPort(ID::A).as_wire()->name));
-			SigSpec my_y = module->wire(remap_name(c->getPort(ID::Y).as_wire()->name));
-			connect(assign_map, module, RTLIL::SigSig(my_a, my_y));
+		if (cmd == ".attr")
+			continue;
+		if (cmd == ".param") {
+			if (!pending || GetSize(tokens) < 3)
+				syntax_error();
+			const std::string &value = tokens[2];
+			if (value[0] == '"') {
+				std::string str = line.substr(line.find('"') + 1);
+				if (!str.empty() && str.back() == '"')
+					str.pop_back();
+				pending->parameters[RTLIL::escape_id(tokens[1])] = RTLIL::Const(str);
+			} else {
+				RTLIL::Const::Builder builder(GetSize(value));
+				for (int i = GetSize(value) - 1; i >= 0; i--)
+					builder.push_back(value[i] != '0' ? RTLIL::State::S1 : RTLIL::State::S0);
+				pending->parameters[RTLIL::escape_id(tokens[1])] = builder.build();
+			}
+			continue;
+		}
+		if (cmd == ".cname") {
+			if (!pending || GetSize(tokens) < 2)
+				syntax_error();
+			pending->name = remap_name(tokens[1]);
 			continue;
 		}
 
-		RTLIL::Cell *cell = module->addCell(remap_name(c->name), c->type);
-		if (markgroups) cell->attributes[ID::abcgroup] = map_autoidx;
-		cell->parameters = c->parameters;
-		for (auto &conn : c->connections()) {
-			RTLIL::SigSpec newsig;
-			for (auto &c : conn.second.chunks()) {
-				if (c.width == 0)
-					continue;
-				log_assert(c.width == 1);
-				newsig.append(module->wire(remap_name(c.wire->name)));
+		if (pending) {
+			emit_mapped_cell(assign_map, design, module, *pending, cell_stats);
+			pending.reset();
+		}
+
+		if (cmd == ".model") {
+			if (GetSize(tokens) < 2 || tokens[1] != "netlist")
+				log_error("ABC output file does not contain a module `netlist'.\n");
+			found_model = true;
+			continue;
+		}
+		if (!found_model)
+			syntax_error();
+
+		if (cmd == ".inputs" || cmd == ".outputs") {
+			for (int i = 1; i < GetSize(tokens); i++)
+				wire(tokens[i]);
+			continue;
+		}
+		if (cmd == ".end") {
+			found_end = true;
+			continue;
+		}
+
+		if (cmd == ".names") {
+			if (GetSize(tokens) < 2)
+				syntax_error();
+			int width = GetSize(tokens) - 2;
+			if (width > 12)
+				log_error("Cell with %d inputs in line %d of ABC output file `%s' is not supported.\n", width, line_count, run_abc.output_file);
+			// a constant driver has no type, and keeps its value in init
+			if (width == 0) {
+				pending.emplace();
+				pending->init = tokens.back() == "$undef" ? RTLIL::State::Sx : RTLIL::State::S0;
+			} else {
+				new_cell(ID($lut));
+				RTLIL::SigSpec inputs;
+				for (int i = 1; i <= width; i++)
+					inputs.append(wire(tokens[i]));
+				pending->ports[ID::A] = inputs;
+				pending->parameters[ID::WIDTH] = RTLIL::Const(width);
+				pending->parameters[ID::LUT] = RTLIL::Const(RTLIL::State::Sx, 1 << width);
+			}
+			pending->is_names = true;
+			pending->ports[ID::Y] = wire(tokens.back());
+			continue;
+		}
+
+		if (cmd == ".latch") {
+			if (GetSize(tokens) < 3)
+				syntax_error();
+			std::string edge = GetSize(tokens) > 3 ? tokens[3] : "";
+			std::string clock = GetSize(tokens) > 4 ? tokens[4] : "";
+			std::string init = GetSize(tokens) > 5 ? tokens[5] : "";
+			if (clock.empty() && !edge.empty()) {
+				init = edge;
+				edge.clear();
+			}
+			IdString clock_port;
+			if (clock.empty())
+				new_cell(builtin_lib ? ID(DFF) : ID(_dff_));
+			else if (edge == "re" || edge == "fe")
+				new_cell(edge == "re" ? ID($_DFF_P_) : ID($_DFF_N_)), clock_port = ID::C;
+			else if (edge == "ah" || edge == "al")
+				new_cell(edge == "ah" ? ID($_DLATCH_P_) : ID($_DLATCH_N_)), clock_port = ID::E;
+			else
+				new_cell(builtin_lib ? ID(DFF) : ID(_dff_));
+			if (!clock_port.empty())
+				pending->ports[clock_port] = wire(clock);
+			pending->ports[ID::D] = wire(tokens[1]);
+			pending->ports[ID::Q] = wire(tokens[2]);
+			if (init == "0" || init == "1")
+				pending->init = init == "1" ? RTLIL::State::S1 : RTLIL::State::S0;
+			continue;
+		}
+
+		if (cmd == ".gate" || cmd == ".subckt") {
+			if (GetSize(tokens) < 2)
+				syntax_error();
+			new_cell(RTLIL::escape_id(tokens[1]));
+			for (int i = 2; i < GetSize(tokens); i++) {
+				size_t pos = tokens[i].find('=');
+				if (pos == std::string::npos)
+					syntax_error();
+				std::string net = tokens[i].substr(pos + 1);
+				pending->ports[RTLIL::escape_id(tokens[i].substr(0, pos))] = net.empty() ? RTLIL::SigSpec() : RTLIL::SigSpec(wire(net));
 			}
-			cell->setPort(conn.first, newsig);
+			continue;
 		}
-		design->select(module, cell);
-	}
 
-	for (auto conn : mapped_mod->connections()) {
-		if (!conn.first.is_fully_const())
-			conn.first = module->wire(remap_name(conn.first.as_wire()->name));
-		if (!conn.second.is_fully_const())
-			conn.second = module->wire(remap_name(conn.second.as_wire()->name));
-		connect(assign_map, module, conn);
+		if (cmd == ".conn" || cmd == ".barbuf") {
+			if (GetSize(tokens) < 3)
+				syntax_error();
+			connect(assign_map, module, RTLIL::SigSig(wire(tokens[2]), wire(tokens[1])));
+			continue;
+		}
+
+		if (cmd == ".area" || cmd == ".delay" || cmd == ".wire_load_slope" || cmd == ".wire" ||
+				cmd == ".input_arrival" || cmd == ".default_input_arrival" || cmd == ".output_required" ||
+				cmd == ".default_output_required" || cmd == ".input_drive" || cmd == ".default_input_drive" ||
+				cmd == ".max_input_load" || cmd == ".default_max_input_load" || cmd == ".output_load" ||
+				cmd == ".default_output_load") {
+			log_warning("Blif delay constraints (%s) are not supported.", cmd);
+			continue;
+		}
+
+		syntax_error();
 	}
+	ifs.close();
+
+	if (!found_model)
+		log_error("ABC output file does not contain a module `netlist'.\n");
+	if (!found_end)
+		syntax_error();
 
 	cell_stats.sort();
 	for (auto &it : cell_stats)
@@ -1777,14 +2084,14 @@ void AbcModuleState::extract(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL
 	for (auto &si : run_abc.signal_list)
 		if (si.is_port) {
 			char buffer[100];
-			snprintf(buffer, 100, "\\ys__n%d", si.id);
+			snprintf(buffer, 100, "ys__n%d", si.id);
 			RTLIL::SigSig conn;
 			if (si.type != G(NONE)) {
 				conn.first = signal_bits[si.id];
-				conn.second = module->wire(remap_name(buffer));
+				conn.second = mapped_wire(design, module, buffer);
 				out_wires++;
 			} else {
-				conn.first = module->wire(remap_name(buffer));
+				conn.first = mapped_wire(design, module, buffer);
 				conn.second = signal_bits[si.id];
 				in_wires++;
 			}
@@ -1794,13 +2101,14 @@ void AbcModuleState::extract(AbcSigMap &assign_map, RTLIL::Design *design, RTLIL
 	log("ABC RESULTS:           input signals: %8d\n", in_wires);
 	log("ABC RESULTS:          output signals: %8d\n", out_wires);
 
-	delete mapped_design;
 	finish();
 }
 
 void AbcModuleState::finish()
 {
-	if (run_abc.config.cleanup)
+	if (run_abc.in_memory)
+		run_abc.close_run_files();
+	else if (run_abc.config.cleanup)
 	{
 		log("Removing temp directory.\n");
 		remove_directory(run_abc.per_run_tempdir_name);
@@ -1992,6 +2300,19 @@ struct AbcPass : public Pass {
 		log("        this attribute is a unique integer for each ABC process started. This\n");
 		log("        is useful for debugging the partitioning of clock domains.\n");
 		log("\n");
+		log("    -cache\n");
+		log("        reuse the results of earlier ABC runs on identical logic with identical\n");
+		log("        options, stored in an on-disk cache in $XDG_CACHE_HOME/yosys/abc or\n");
+		log("        ~/.cache/yosys/abc. the results are keyed by a hash of the extracted\n");
+		log("        netlist, the ABC script, the contents of the library, constraint and\n");
+		log("        script files, the Yosys build and the path, time and size of the ABC\n");
+		log("        binary. the cache directory must be owned by the current user and must\n");
+		log("        not be writable by others, otherwise the cache is not used. the least\n");
+		log("        recently used results are removed when the cache exceeds 256 MB.\n");
+		log("\n");
+		log("    -cache_dir <dir>\n");
+		log("        use the specified directory for the -cache results. implies -cache.\n");
+		log("\n");
 		log("    -dress\n");
 		log("        run the 'dress' command after all other ABC commands. This aims to\n");
 		log("        preserve naming by an equivalence check between the original and\n");
@@ -2048,6 +2369,7 @@ struct AbcPass : public Pass {
 		config.cleanup = !design->scratchpad_get_bool("abc.nocleanup", false);
 		config.show_tempdir = design->scratchpad_get_bool("abc.showtmp", false);
 		config.markgroups = design->scratchpad_get_bool("abc.markgroups", false);
+		config.result_cache = design->scratchpad_get_bool("abc.cache", false);
 
 		if (config.cleanup)
 			config.global_tempdir_name = get_base_tmpdir() + "/";
@@ -2159,6 +2481,15 @@ struct AbcPass : public Pass {
 				config.markgroups = true;
 				continue;
 			}
+			if (arg == "-cache") {
+				config.result_cache = true;
+				continue;
+			}
+			if (arg == "-cache_dir" && argidx+1 < args.size()) {
+				config.result_cache = true;
+				config.result_cache_dir = args[++argidx];
+				continue;
+			}
 			if (arg == "-liberty_args" && argidx+1 < args.size()) {
 				config.abc_liberty_args = args[++argidx];
 				if (!config.abc_liberty_args.empty()) {
@@ -2374,6 +2705,27 @@ struct AbcPass : public Pass {
 
 		emit_global_input_files(config);
 
+		if (config.result_cache) {
+			if (config.result_cache_dir.empty())
+				config.result_cache_dir = abc_cache_default_dir();
+			else
+				rewrite_filename(config.result_cache_dir);
+			std::string error;
+			if (!abc_cache_prepare_dir(config.result_cache_dir, error)) {
+				log_warning("ABC: not using the result cache: %s.\n", error);
+				config.result_cache = false;
+			}
+			for (auto &file : config.liberty_files)
+				config.result_cache_files += "|liberty:" + abc_cache_file_hash(file);
+			for (auto &file : config.genlib_files)
+				config.result_cache_files += "|genlib:" + abc_cache_file_hash(file);
+			if (!config.constr_file.empty())
+				config.result_cache_files += "|constr:" + abc_cache_file_hash(config.constr_file);
+			if (!config.script_file.empty() && config.script_file[0] != '+')
+				config.result_cache_files += "|source:" + abc_cache_file_hash(config.script_file);
+		}
+
+		int cache_hits = 0, cache_misses = 0;
 		for (auto mod : design->selected_modules())
 		{
 			if (mod->processes.size() > 0) {
@@ -2389,6 +2741,12 @@ struct AbcPass : public Pass {
 			FfInitVals initvals;
 			initvals.set(&assign_map, mod);
 
+			auto extract_result = [&](AbcModuleState &state) {
+				if (config.result_cache && state.run_abc.did_run)
+					(state.run_abc.cache_hit ? cache_hits : cache_misses)++;
+				state.extract(assign_map, design, mod);
+			};
+
 			for (auto wire : mod->wires())
 				if (wire->port_id > 0 || wire->get_bool_attribute(ID::keep))
 					assign_map.addVal(SigSpec(wire), AbcSigVal(true));
@@ -2401,7 +2759,7 @@ struct AbcPass : public Pass {
 				state.prepare_module(design, mod, assign_map, cells, dff_mode, clk_str);
 				ConcurrentStack<AbcProcess> process_pool;
 				state.run_abc.run(process_pool);
-				state.extract(assign_map, design, mod);
+				extract_result(state);
 				continue;
 			}
 
@@ -2596,7 +2954,7 @@ struct AbcPass : public Pass {
 					++work_finished_count;
 				}
 				while (work_finished_by_index[next_state_index_to_process] != nullptr) {
-					work_finished_by_index[next_state_index_to_process]->extract(assign_map, design, mod);
+					extract_result(*work_finished_by_index[next_state_index_to_process]);
 					work_finished_by_index[next_state_index_to_process] = nullptr;
 					++next_state_index_to_process;
 				}
@@ -2626,12 +2984,19 @@ struct AbcPass : public Pass {
 				++work_finished_count;
 			}
 			while (next_state_index_to_process < GetSize(work_finished_by_index)) {
-				work_finished_by_index[next_state_index_to_process]->extract(assign_map, design, mod);
+				extract_result(*work_finished_by_index[next_state_index_to_process]);
 				work_finished_by_index[next_state_index_to_process] = nullptr;
 				++next_state_index_to_process;
 			}
 		}
 
+		if (config.result_cache) {
+			log("ABC result cache: %d hits, %d misses.\n", cache_hits, cache_misses);
+			int evicted = abc_cache_evict(config.result_cache_dir, abc_cache_max_size);
+			if (evicted > 0)
+				log("Removed %d least recently used entries from the ABC result cache.\n", evicted);
+		}
+
 		if (config.cleanup) {
 			log("Removing global temp directory.\n");
 			remove_directory(config.global_tempdir_name);
@@ -0,0 +1,258 @@
+#ifndef ABC_CACHE_H
+#define ABC_CACHE_H
+
+#include "kernel/yosys.h"
+#include "libs/sha1/sha1.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <tuple>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+// The cache is trimmed to this size, least recently used entries first.
+static constexpr long long abc_cache_max_size = 256ll << 20;
+
+/*
+ * abc_cache_default_dir() - Get the per-user default cache directory.
+ *
+ * Return: $XDG_CACHE_HOME/yosys/abc or ~/.cache/yosys/abc, or an empty string
+ * if neither variable is set
+ */
+inline std::string abc_cache_default_dir()
+{
+#ifdef _WIN32
+	const char *local_app_data = getenv("LOCALAPPDATA");
+	if (local_app_data != nullptr && *local_app_data)
+		return std::string(local_app_data) + "/yosys/abc";
+#else
+	const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+	if (xdg_cache_home != nullptr && *xdg_cache_home)
+		return std::string(xdg_cache_home) + "/yosys/abc";
+	const char *home = getenv("HOME");
+	if (home != nullptr && *home)
+		return std::string(home) + "/.cache/yosys/abc";
+#endif
+	return "";
+}
+
+/*
+ * abc_cache_prepare_dir() - Create the cache directory and check that it can
+ * be trusted.
+ * @dir: The cache directory
+ * @error: Set to the reason if the directory cannot be used
+ *
+ * A new directory is only accessible by the current user. An existing one
+ * must be owned by the current user and not be writable by anyone else, as
+ * the netlists in it are read back without further checks.
+ *
+ * Return: true if the directory can be used
+ */
+inline bool abc_cache_prepare_dir(const std::string &dir, std::string &error)
+{
+	if (dir.empty()) {
+		error = "no cache directory, neither XDG_CACHE_HOME nor HOME are set";
+		return false;
+	}
+	std::error_code ec;
+	if (std::filesystem::create_directories(dir, ec))
+		std::filesystem::permissions(dir, std::filesystem::perms::owner_all, ec);
+	if (ec) {
+		error = stringf("cannot create `%s': %s", dir, ec.message());
+		return false;
+	}
+	struct stat dir_stat;
+	if (stat(dir.c_str(), &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode)) {
+		error = stringf("`%s' is not a directory", dir);
+		return false;
+	}
+#ifndef _WIN32
+	if (dir_stat.st_uid != geteuid()) {
+		error = stringf("`%s' is owned by another user", dir);
+		return false;
+	}
+	if ((dir_stat.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+		error = stringf("`%s' is writable by other users", dir);
+		return false;
+	}
+#endif
+	return true;
+}
+
+/*
+ * abc_cache_evict() - Trim the cache directory to a maximum size.
+ * @dir: The cache directory
+ * @max_size: Size in bytes the entries may take up in total
+ *
+ * Lookups refresh the modification time of the entries they hit, so the least
+ * recently used entries are removed first.
+ *
+ * Return: The number of removed entries
+ */
+inline int abc_cache_evict(const std::string &dir, long long max_size)
+{
+	std::vector<std::tuple<std::filesystem::file_time_type, long long, std::filesystem::path>> entries;
+	long long total_size = 0;
+	std::error_code ec;
+	for (auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+		std::error_code entry_ec;
+		if (entry.path().extension() != ".blif" || !entry.is_regular_file(entry_ec))
+			continue;
+		auto time = entry.last_write_time(entry_ec);
+		long long size = entry.file_size(entry_ec);
+		if (entry_ec)
+			continue;
+		entries.emplace_back(time, size, entry.path());
+		total_size += size;
+	}
+
+	std::sort(entries.begin(), entries.end());
+	int removed = 0;
+	for (auto &entry : entries) {
+		if (total_size <= max_size)
+			break;
+		if (std::filesystem::remove(std::get<2>(entry), ec)) {
+			total_size -= std::get<1>(entry);
+			removed++;
+		}
+	}
+	return removed;
+}
+
+// The functions below are called from the threads running ABC and must not log.
+
+/*
+ * abc_cache_file_identity() - Describe a file for a cache key.
+ * @path: Path of the file
+ *
+ * Return: The path, modification time and size of the file, or only the path
+ * if the file cannot be stat'ed
+ */
+inline std::string abc_cache_file_identity(const std::string &path)
+{
+	struct stat file_stat;
+	if (stat(path.c_str(), &file_stat) != 0)
+		return path + "|";
+	return stringf("%s:%lld:%lld|", path.c_str(), (long long)file_stat.st_mtime, (long long)file_stat.st_size);
+}
+
+/*
+ * abc_cache_file_hash() - Describe a file by its contents for a cache key.
+ * @path: Path of the file
+ *
+ * Return: The path and the hash of the contents of the file
+ */
+inline std::string abc_cache_file_hash(const std::string &path)
+{
+	std::ifstream f(path, std::ios::binary);
+	std::stringstream contents;
+	contents << f.rdbuf();
+	return path + ":" + sha1(contents.str()) + "|";
+}
+
+/*
+ * abc_cache_file_contents() - Read a file for a cache key.
+ * @path: Path of the file
+ * @skip_prefix: Lines starting with this prefix are left out, if not empty
+ *
+ * Return: The contents of the file
+ */
+inline std::string abc_cache_file_contents(const std::string &path, const std::string &skip_prefix = "")
+{
+	std::ifstream f(path);
+	std::string contents;
+	for (std::string line; std::getline(f, line); ) {
+		if (!skip_prefix.empty() && line.compare(0, skip_prefix.size(), skip_prefix) == 0)
+			continue;
+		contents += line;
+		contents += '\n';
+	}
+	return contents;
+}
+
+inline std::string abc_cache_entry(const std::string &dir, const std::string &key)
+{
+	return stringf("%s/%s.blif", dir, key);
+}
+
+/*
+ * abc_cache_lookup() - Look up the mapped netlist for a cache key.
+ * @dir: The cache directory, checked by abc_cache_prepare_dir()
+ * @key: Hash of everything the ABC run depends on
+ * @output_file: Where to copy the cached netlist to
+ *
+ * Return: true if the key was found and copied
+ */
+inline bool abc_cache_lookup(const std::string &dir, const std::string &key, const std::string &output_file)
+{
+	std::string entry = abc_cache_entry(dir, key);
+	struct stat entry_stat;
+	if (stat(entry.c_str(), &entry_stat) != 0 || !S_ISREG(entry_stat.st_mode))
+		return false;
+#ifndef _WIN32
+	if (entry_stat.st_uid != geteuid())
+		return false;
+#endif
+	{
+		std::ifstream in(entry, std::ios::binary);
+		if (in.fail())
+			return false;
+		std::ofstream out(output_file, std::ios::binary | std::ios::trunc);
+		out << in.rdbuf();
+		if (out.fail())
+			return false;
+	}
+	std::error_code ec;
+	std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), ec);
+	return true;
+}
+
+/*
+ * abc_cache_store() - Add the mapped netlist of an ABC run to the cache.
+ * @dir: The cache directory, checked by abc_cache_prepare_dir()
+ * @key: Hash of everything the ABC run depends on
+ * @output_file: The netlist written by ABC
+ *
+ * Concurrent writers cannot corrupt each other, as every writer renames its
+ * own temporary file into place.
+ *
+ * Return: true if the netlist was stored
+ */
+inline bool abc_cache_store(const std::string &dir, const std::string &key, const std::string &output_file)
+{
+	std::string entry = abc_cache_entry(dir, key);
+	size_t thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+	std::string temp_entry = stringf("%s.%u.%zx.tmp", entry.c_str(), get_process_id(), thread_id);
+	{
+		std::ifstream in(output_file, std::ios::binary);
+		std::ofstream out(temp_entry, std::ios::binary | std::ios::trunc);
+		if (in.fail() || out.fail())
+			return false;
+		out << in.rdbuf();
+		if (out.fail()) {
+			out.close();
+			remove(temp_entry.c_str());
+			return false;
+		}
+	}
+
+	std::error_code rename_ec;
+	std::filesystem::rename(temp_entry, entry, rename_ec);
+	if (rename_ec) {
+		remove(temp_entry.c_str());
+		return false;
+	}
+	return true;
+}
+
+YOSYS_NAMESPACE_END
+
+#endif // ABC_CACHE_H
@@ -0,0 +1,889 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2026  agent <agent@local>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/cellaigs.h"
+#include "kernel/cost.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+#define CUTMAP_MAX_LEAVES 6
+
+// Truth tables of up to six variables are stored in 64 bits, with the
+// function replicated over the unused variables.
+static const uint64_t tt_vars[CUTMAP_MAX_LEAVES] = {
+	0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+	0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull,
+};
+
+// Swaps the variables i < j of a truth table.
+static uint64_t tt_swap(uint64_t tt, int i, int j)
+{
+	int shift = (1 << j) - (1 << i);
+	uint64_t mask = tt_vars[i] & ~tt_vars[j];
+	return (tt & ~(mask | (mask << shift))) | ((tt & mask) << shift) | ((tt >> shift) & mask);
+}
+
+static bool tt_depends(uint64_t tt, int i)
+{
+	return ((tt & tt_vars[i]) >> (1 << i)) != (tt & ~tt_vars[i]);
+}
+
+static uint64_t tt_mask(int size)
+{
+	return size == CUTMAP_MAX_LEAVES ? ~uint64_t(0) : (uint64_t(1) << (1 << size)) - 1;
+}
+
+// An and-inverter graph with structural hashing. Literals are 2*node+inverted,
+// node 0 is the constant, so literal 0 is false and literal 1 is true. The
+// fanins of a node always have smaller indices than the node.
+struct CutAig
+{
+	vector<int> fanin0, fanin1;
+	dict<pair<int, int>, int> strash;
+
+	CutAig() : fanin0(1, -1), fanin1(1, -1) { }
+
+	int num_nodes() const { return GetSize(fanin0); }
+	bool is_and(int node) const { return fanin0[node] >= 0; }
+
+	int add_input()
+	{
+		fanin0.push_back(-1);
+		fanin1.push_back(-1);
+		return 2 * (num_nodes() - 1);
+	}
+
+	int add_and(int a, int b)
+	{
+		if (a > b)
+			std::swap(a, b);
+		if (a == 0)
+			return 0;
+		if (a == 1 || a == b)
+			return b;
+		if ((a ^ 1) == b)
+			return 0;
+		auto it = strash.find({a, b});
+		if (it != strash.end())
+			return 2 * it->second;
+		int node = num_nodes();
+		fanin0.push_back(a);
+		fanin1.push_back(b);
+		strash[{a, b}] = node;
+		return 2 * node;
+	}
+};
+
+struct Cut
+{
+	int size = 0;
+	int leaves[CUTMAP_MAX_LEAVES];
+	uint64_t sign = 0;
+	uint64_t tt = 0;
+	int arrival = 0;
+	// area of the LUT or gate implementing the cut
+	float area = 0;
+	// area flow of the cut, and its exact area during exact area recovery
+	float flow = 0;
+	float exact = 0;
+
+	bool is_wire() const { return size == 1 && (tt & 3) == 2; }
+	int delay() const { return size == 0 || is_wire() ? 0 : 1; }
+
+	bool subset_of(const Cut &other) const
+	{
+		if (size > other.size || (sign & ~other.sign) != 0)
+			return false;
+		for (int i = 0, j = 0; i < size; i++) {
+			while (j < other.size && other.leaves[j] < leaves[i])
+				j++;
+			if (j == other.size || other.leaves[j] != leaves[i])
+				return false;
+		}
+		return true;
+	}
+};
+
+// Priority cut mapping (Mishchenko et al., "Combinational and sequential
+// mapping with priority cuts", ICCAD 2007). Every node keeps a small set of
+// its best cuts, computed from the sets of its fanins. The first round
+// selects cuts for minimal depth, the following rounds recover area by area
+// flow and exact area without exceeding that depth.
+struct CutMapper
+{
+	enum Mode { Depth, AreaFlow, ExactArea };
+
+	const CutAig &aig;
+	vector<int> outputs;
+
+	int max_leaves = 4;
+	int max_cuts = 8;
+	// When mapping to gates, the area of the functions that have a match in
+	// the gate library, indexed by (size << 16) | truth table. When mapping
+	// to LUTs, every function has unit area.
+	bool lut_mode = true;
+	dict<uint32_t, float> function_area;
+
+	vector<vector<Cut>> cuts;
+	vector<Cut> best;
+	vector<int> refs, required;
+	vector<float> est_refs;
+	int depth = 0;
+	float area = 0;
+
+	vector<Cut> candidates;
+	vector<int> ref_stack;
+
+	CutMapper(const CutAig &aig) : aig(aig) { }
+
+	Cut trivial_cut(int node) const
+	{
+		Cut cut;
+		cut.size = 1;
+		cut.leaves[0] = node;
+		cut.sign = uint64_t(1) << (node % 64);
+		cut.tt = tt_vars[0];
+		cut.arrival = aig.is_and(node) ? best[node].arrival : 0;
+		return cut;
+	}
+
+	bool merge_leaves(const Cut &c0, const Cut &c1, Cut &cut) const
+	{
+		cut.sign = c0.sign | c1.sign;
+		if (__builtin_popcountll(cut.sign) > max_leaves)
+			return false;
+		int i = 0, j = 0, k = 0;
+		while (i < c0.size || j < c1.size) {
+			if (k == max_leaves)
+				return false;
+			if (j == c1.size || (i < c0.size && c0.leaves[i] < c1.leaves[j]))
+				cut.leaves[k++] = c0.leaves[i++];
+			else if (i == c0.size || c1.leaves[j] < c0.leaves[i])
+				cut.leaves[k++] = c1.leaves[j++];
+			else
+				cut.leaves[k++] = c0.leaves[i++], j++;
+		}
+		cut.size = k;
+		return true;
+	}
+
+	// The truth table of `from` over the leaves of `to`, a superset.
+	static uint64_t expand_tt(const Cut &from, const Cut &to)
+	{
+		uint64_t tt = from.tt;
+		int k = to.size - 1;
+		for (int i = from.size - 1; i >= 0; i--) {
+			while (to.leaves[k] != from.leaves[i])
+				k--;
+			if (k != i)
+				tt = tt_swap(tt, i, k);
+		}
+		return tt;
+	}
+
+	// Removes the leaves the function does not depend on.
+	static void minimize_support(Cut &cut)
+	{
+		int size = 0;
+		cut.sign = 0;
+		for (int i = 0; i < cut.size; i++) {
+			if (!tt_depends(cut.tt, i))
+				continue;
+			if (size != i)
+				cut.tt = tt_swap(cut.tt, size, i);
+			cut.leaves[size] = cut.leaves[i];
+			cut.sign |= uint64_t(1) << (cut.leaves[i] % 64);
+			size++;
+		}
+		cut.size = size;
+	}
+
+	// Computes the area, arrival and area flow of a cut, returns false if
+	// the function of the cut cannot be implemented.
+	bool evaluate(Cut &cut) const
+	{
+		if (cut.size == 0 || cut.is_wire())
+			cut.area = 0;
+		else if (lut_mode)
+			cut.area = 1;
+		else {
+			auto it = function_area.find((cut.size << 16) | (cut.tt & tt_mask(cut.size)));
+			if (it == function_area.end())
+				return false;
+			cut.area = it->second;
+		}
+		cut.arrival = 0;
+		cut.flow = cut.area;
+		for (int i = 0; i < cut.size; i++) {
+			int leaf = cut.leaves[i];
+			if (!aig.is_and(leaf))
+				continue;
+			cut.arrival = std::max(cut.arrival, best[leaf].arrival);
+			cut.flow += best[leaf].flow / est_refs[leaf];
+		}
+		cut.arrival += cut.delay();
+		return true;
+	}
+
+	float ref_cut(const Cut &cut)
+	{
+		float result = cut.area;
+		ref_stack.clear();
+		for (int i = 0; i < cut.size; i++)
+			if (aig.is_and(cut.leaves[i]) && refs[cut.leaves[i]]++ == 0)
+				ref_stack.push_back(cut.leaves[i]);
+		while (!ref_stack.empty()) {
+			const Cut &c = best[ref_stack.back()];
+			ref_stack.pop_back();
+			result += c.area;
+			for (int i = 0; i < c.size; i++)
+				if (aig.is_and(c.leaves[i]) && refs[c.leaves[i]]++ == 0)
+					ref_stack.push_back(c.leaves[i]);
+		}
+		return result;
+	}
+
+	float deref_cut(const Cut &cut)
+	{
+		float result = cut.area;
+		ref_stack.clear();
+		for (int i = 0; i < cut.size; i++)
+			if (aig.is_and(cut.leaves[i]) && --refs[cut.leaves[i]] == 0)
+				ref_stack.push_back(cut.leaves[i]);
+		while (!ref_stack.empty()) {
+			const Cut &c = best[ref_stack.back()];
+			ref_stack.pop_back();
+			result += c.area;
+			for (int i = 0; i < c.size; i++)
+				if (aig.is_and(c.leaves[i]) && --refs[c.leaves[i]] == 0)
+					ref_stack.push_back(c.leaves[i]);
+		}
+		return result;
+	}
+
+	void add_candidate(Cut &cut)
+	{
+		if (!evaluate(cut))
+			return;
+		for (int i = 0; i < GetSize(candidates); i++) {
+			const Cut &other = candidates[i];
+			// a cut with a subset of the leaves is at least as good for LUTs,
+			// but might not have a matching gate
+			if (lut_mode ? other.subset_of(cut) : (other.size == cut.size && other.subset_of(cut)))
+				return;
+		}
+		if (lut_mode)
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+					[&](const Cut &other) { return cut.subset_of(other); }), candidates.end());
+		candidates.push_back(cut);
+	}
+
+	void select_cuts(int node, Mode mode)
+	{
+		int lit0 = aig.fanin0[node], lit1 = aig.fanin1[node];
+		int node0 = lit0 >> 1, node1 = lit1 >> 1;
+
+		candidates.clear();
+		if (mode != Depth) {
+			Cut cut = best[node];
+			add_candidate(cut);
+		}
+
+		Cut trivial0 = trivial_cut(node0), trivial1 = trivial_cut(node1);
+		for (int i = -1; i < GetSize(cuts[node0]); i++)
+		for (int j = -1; j < GetSize(cuts[node1]); j++) {
+			const Cut &c0 = i < 0 ? trivial0 : cuts[node0][i];
+			const Cut &c1 = j < 0 ? trivial1 : cuts[node1][j];
+			Cut cut;
+			if (!merge_leaves(c0, c1, cut))
+				continue;
+			uint64_t tt0 = expand_tt(c0, cut) ^ ((lit0 & 1) ? ~uint64_t(0) : 0);
+			uint64_t tt1 = expand_tt(c1, cut) ^ ((lit1 & 1) ? ~uint64_t(0) : 0);
+			cut.tt = tt0 & tt1;
+			minimize_support(cut);
+			add_candidate(cut);
+		}
+		log_assert(!candidates.empty());
+
+		bool exact = mode == ExactArea && refs[node] > 0;
+		if (exact) {
+			deref_cut(best[node]);
+			for (auto &cut : candidates) {
+				cut.exact = ref_cut(cut);
+				deref_cut(cut);
+			}
+		}
+
+		int req = required[node];
+		auto key = [&](const Cut &cut) {
+			float cost = exact ? cut.exact : cut.flow;
+			if (mode == Depth)
+				return std::make_tuple(cut.arrival > req, float(cut.arrival), cut.flow, cut.size);
+			return std::make_tuple(cut.arrival > req, cost, float(cut.arrival), cut.size);
+		};
+		std::stable_sort(candidates.begin(), candidates.end(),
+				[&](const Cut &a, const Cut &b) { return key(a) < key(b); });
+		if (GetSize(candidates) > max_cuts)
+			candidates.resize(max_cuts);
+
+		log_assert(candidates.front().arrival <= req);
+		cuts[node] = candidates;
+		best[node] = candidates.front();
+		if (exact)
+			ref_cut(best[node]);
+	}
+
+	void update_cover(bool set_depth)
+	{
+		int num_nodes = aig.num_nodes();
+		refs.assign(num_nodes, 0);
+		for (int lit : outputs)
+			if (aig.is_and(lit >> 1))
+				refs[lit >> 1]++;
+		for (int node = num_nodes - 1; node > 0; node--)
+			if (aig.is_and(node) && refs[node] > 0)
+				for (int i = 0; i < best[node].size; i++)
+					refs[best[node].leaves[i]]++;
+
+		if (set_depth) {
+			depth = 0;
+			for (int lit : outputs)
+				if (aig.is_and(lit >> 1))
+					depth = std::max(depth, best[lit >> 1].arrival);
+		}
+
+		required.assign(num_nodes, INT_MAX);
+		for (int lit : outputs)
+			if (aig.is_and(lit >> 1)) {
+				log_assert(best[lit >> 1].arrival <= depth);
+				required[lit >> 1] = depth;
+			}
+		area = 0;
+		for (int node = num_nodes - 1; node > 0; node--) {
+			if (!aig.is_and(node) || refs[node] == 0)
+				continue;
+			const Cut &cut = best[node];
+			area += cut.area;
+			for (int i = 0; i < cut.size; i++)
+				required[cut.leaves[i]] = std::min(required[cut.leaves[i]], required[node] - cut.delay());
+		}
+
+		for (int node = 0; node < num_nodes; node++)
+			est_refs[node] = std::max(1.0f, (2 * est_refs[node] + refs[node]) / 3);
+	}
+
+	void run(int area_rounds)
+	{
+		int num_nodes = aig.num_nodes();
+		cuts.assign(num_nodes, {});
+		best.assign(num_nodes, Cut());
+		required.assign(num_nodes, INT_MAX);
+		est_refs.assign(num_nodes, 0);
+		for (int node = 0; node < num_nodes; node++)
+			if (aig.is_and(node)) {
+				est_refs[aig.fanin0[node] >> 1]++;
+				est_refs[aig.fanin1[node] >> 1]++;
+			}
+		for (int lit : outputs)
+			est_refs[lit >> 1]++;
+		for (auto &est : est_refs)
+			est = std::max(1.0f, est);
+
+		for (int round = 0; round <= area_rounds; round++) {
+			Mode mode = round == 0 ? Depth : round == 1 ? AreaFlow : ExactArea;
+			for (int node = 0; node < num_nodes; node++)
+				if (aig.is_and(node))
+					select_cuts(node, mode);
+			update_cover(round == 0);
+		}
+	}
+};
+
+// The gates of the internal cell library that can be selected with -g.
+struct GateType
+{
+	const char *name;
+	IdString type;
+	vector<IdString> pins;
+};
+
+static const vector<GateType> &gate_types()
+{
+	static const vector<GateType> types = {
+		{"NOT", ID($_NOT_), {ID::A}},
+		{"AND", ID($_AND_), {ID::A, ID::B}},
+		{"NAND", ID($_NAND_), {ID::A, ID::B}},
+		{"OR", ID($_OR_), {ID::A, ID::B}},
+		{"NOR", ID($_NOR_), {ID::A, ID::B}},
+		{"XOR", ID($_XOR_), {ID::A, ID::B}},
+		{"XNOR", ID($_XNOR_), {ID::A, ID::B}},
+		{"ANDNOT", ID($_ANDNOT_), {ID::A, ID::B}},
+		{"ORNOT", ID($_ORNOT_), {ID::A, ID::B}},
+		{"MUX", ID($_MUX_), {ID::A, ID::B, ID::S}},
+		{"NMUX", ID($_NMUX_), {ID::A, ID::B, ID::S}},
+		{"AOI3", ID($_AOI3_), {ID::A, ID::B, ID::C}},
+		{"OAI3", ID($_OAI3_), {ID::A, ID::B, ID::C}},
+		{"AOI4", ID($_AOI4_), {ID::A, ID::B, ID::C, ID::D}},
+		{"OAI4", ID($_OAI4_), {ID::A, ID::B, ID::C, ID::D}},
+	};
+	return types;
+}
+
+static bool eval_gate(IdString type, const bool *in)
+{
+	bool a = in[0], b = in[1], c = in[2], d = in[3];
+	if (type == ID($_NOT_)) return !a;
+	if (type == ID($_AND_)) return a && b;
+	if (type == ID($_NAND_)) return !(a && b);
+	if (type == ID($_OR_)) return a || b;
+	if (type == ID($_NOR_)) return !(a || b);
+	if (type == ID($_XOR_)) return a != b;
+	if (type == ID($_XNOR_)) return a == b;
+	if (type == ID($_ANDNOT_)) return a && !b;
+	if (type == ID($_ORNOT_)) return a || !b;
+	if (type == ID($_MUX_)) return c ? b : a;
+	if (type == ID($_NMUX_)) return !(c ? b : a);
+	if (type == ID($_AOI3_)) return !((a && b) || c);
+	if (type == ID($_OAI3_)) return !((a || b) && c);
+	if (type == ID($_AOI4_)) return !((a && b) || (c && d));
+	if (type == ID($_OAI4_)) return !((a || b) && (c || d));
+	log_abort();
+}
+
+// A gate implementing the function of a cut: pin i of the gate is connected
+// to leaf perm[i], inverted if bit perm[i] of neg_leaves is set.
+struct GateMatch
+{
+	const GateType *gate;
+	int perm[4];
+	int neg_leaves;
+	bool neg_output;
+	float area;
+};
+
+struct CutmapWorker
+{
+	Module *module;
+	SigMap sigmap;
+	bool lut_mode;
+	const dict<uint32_t, GateMatch> &gate_matches;
+
+	CutAig aig;
+	vector<SigBit> input_bits;
+	vector<SigBit> pos_bits, neg_bits;
+	vector<SigBit> output_bits;
+	vector<int> output_lits;
+
+	CutmapWorker(Module *module, bool lut_mode, const dict<uint32_t, GateMatch> &gate_matches) :
+			module(module), sigmap(module), lut_mode(lut_mode), gate_matches(gate_matches) { }
+
+	int bit_lit(dict<SigBit, int> &lits, SigBit bit)
+	{
+		bit = sigmap(bit);
+		// x and z constants are mapped as 0, see help()
+		if (bit.wire == nullptr)
+			return bit == State::S1 ? 1 : 0;
+		auto it = lits.find(bit);
+		if (it != lits.end())
+			return it->second;
+		int lit = aig.add_input();
+		input_bits.resize(lit / 2 + 1);
+		input_bits[lit / 2] = bit;
+		lits[bit] = lit;
+		return lit;
+	}
+
+	// Builds the AIG of the cells and finds the bits used outside of them.
+	void extract(const vector<Cell*> &cells, vector<Aig> &aigs)
+	{
+		dict<SigBit, int> drivers;
+		for (int i = 0; i < GetSize(cells); i++)
+			for (auto &node : aigs[i].nodes)
+				for (auto &op : node.outports)
+					drivers[sigmap(cells[i]->getPort(op.first)[op.second])] = i;
+
+		// order the cells so that each cell comes after the cells driving it
+		vector<int> pending(GetSize(cells));
+		vector<vector<int>> users(GetSize(cells));
+		for (int i = 0; i < GetSize(cells); i++) {
+			pool<int> deps;
+			for (auto &conn : cells[i]->connections())
+				if (cells[i]->input(conn.first))
+					for (auto bit : sigmap(conn.second))
+						if (drivers.count(bit))
+							deps.insert(drivers.at(bit));
+			pending[i] = GetSize(deps);
+			for (int dep : deps)
+				users[dep].push_back(i);
+		}
+		vector<int> order;
+		for (int i = 0; i < GetSize(cells); i++)
+			if (pending[i] == 0)
+				order.push_back(i);
+		for (int i = 0; i < GetSize(order); i++)
+			for (int user : users[order[i]])
+				if (--pending[user] == 0)
+					order.push_back(user);
+		if (GetSize(order) != GetSize(cells))
+			for (int i = 0; i < GetSize(cells); i++)
+				if (pending[i] != 0)
+					log_error("Found a logic loop through cell %s in module %s.\n", cells[i], module);
+
+		dict<SigBit, int> lits;
+		for (int i : order) {
+			Cell *cell = cells[i];
+			vector<int> node_lits;
+			for (auto &node : aigs[i].nodes) {
+				int lit;
+				if (node.portbit >= 0)
+					lit = bit_lit(lits, cell->getPort(node.portname)[node.portbit]) ^ node.inverter;
+				else if (node.left_parent < 0 && node.right_parent < 0)
+					lit = node.inverter;
+				else
+					lit = aig.add_and(node_lits.at(node.left_parent), node_lits.at(node.right_parent)) ^ node.inverter;
+				node_lits.push_back(lit);
+				for (auto &op : node.outports)
+					lits[sigmap(cell->getPort(op.first)[op.second])] = lit;
+			}
+		}
+		input_bits.resize(aig.num_nodes());
+
+		// the driven bits used by other cells, ports and kept wires
+		pool<Cell*> cell_set(cells.begin(), cells.end());
+		pool<SigBit> used_bits;
+		for (auto cell : module->cells()) {
+			if (cell_set.count(cell))
+				continue;
+			for (auto &conn : cell->connections())
+				for (auto bit : sigmap(conn.second))
+					if (drivers.count(bit))
+						used_bits.insert(bit);
+		}
+		for (auto wire : module->wires()) {
+			if (!wire->port_output && !wire->get_bool_attribute(ID::keep))
+				continue;
+			for (auto bit : sigmap(wire))
+				if (drivers.count(bit))
+					used_bits.insert(bit);
+		}
+		for (auto bit : used_bits) {
+			output_bits.push_back(bit);
+			output_lits.push_back(lits.at(bit));
+		}
+	}
+
+	SigBit not_bit(SigBit bit)
+	{
+		if (bit.wire == nullptr)
+			return bit == State::S1 ? State::S0 : State::S1;
+		Wire *w = module->addWire(NEW_ID);
+		if (lut_mode)
+			module->addLut(NEW_ID, bit, w, Const(1, 2));
+		else
+			module->addNotGate(NEW_ID, bit, w);
+		return w;
+	}
+
+	SigBit pos_bit(int node)
+	{
+		if (pos_bits[node] == State::Sx)
+			pos_bits[node] = not_bit(neg_bits[node]);
+		return pos_bits[node];
+	}
+
+	SigBit neg_bit(int node)
+	{
+		if (neg_bits[node] == State::Sx)
+			neg_bits[node] = not_bit(pos_bits[node]);
+		return neg_bits[node];
+	}
+
+	void emit(const CutMapper &mapper, int &num_cells)
+	{
+		int num_nodes = aig.num_nodes();
+		pos_bits.assign(num_nodes, State::Sx);
+		neg_bits.assign(num_nodes, State::Sx);
+		pos_bits[0] = State::S0;
+		neg_bits[0] = State::S1;
+		for (int node = 1; node < num_nodes; node++)
+			if (!aig.is_and(node))
+				pos_bits[node] = input_bits[node];
+
+		// nodes that are only used inverted are implemented inverted
+		vector<bool> pos_used(num_nodes), neg_used(num_nodes);
+		for (int lit : output_lits)
+			((lit & 1) ? neg_used : pos_used)[lit >> 1] = true;
+		for (int node = 1; node < num_nodes; node++)
+			if (aig.is_and(node) && mapper.refs[node] > 0)
+				for (int i = 0; i < mapper.best[node].size; i++)
+					pos_used[mapper.best[node].leaves[i]] = true;
+
+		int orig_num_cells = GetSize(module->cells());
+		for (int node = 1; node < num_nodes; node++)
+		{
+			if (!aig.is_and(node) || mapper.refs[node] == 0)
+				continue;
+
+			const Cut &cut = mapper.best[node];
+			bool inverted = !pos_used[node];
+			uint64_t tt = inverted ? ~cut.tt : cut.tt;
+			SigBit &y = inverted ? neg_bits[node] : pos_bits[node];
+
+			if (cut.size == 0) {
+				y = (tt & 1) ? State::S1 : State::S0;
+				continue;
+			}
+			if (cut.is_wire()) {
+				y = inverted ? neg_bit(cut.leaves[0]) : pos_bit(cut.leaves[0]);
+				continue;
+			}
+
+			if (lut_mode) {
+				SigSpec inputs;
+				for (int i = 0; i < cut.size; i++)
+					inputs.append(pos_bit(cut.leaves[i]));
+				Const lut(State::S0, 1 << cut.size);
+				for (int i = 0; i < (1 << cut.size); i++)
+					if ((tt >> i) & 1)
+						lut.set(i, State::S1);
+				y = module->addWire(NEW_ID);
+				module->addLut(NEW_ID, inputs, y, lut);
+				continue;
+			}
+
+			const GateMatch &match = gate_matches.at((cut.size << 16) | (tt & tt_mask(cut.size)));
+			SigBit gate_y = module->addWire(NEW_ID);
+			Cell *gate = module->addCell(NEW_ID, match.gate->type);
+			for (int i = 0; i < GetSize(match.gate->pins); i++) {
+				int leaf = cut.leaves[match.perm[i]];
+				bool neg = (match.neg_leaves >> match.perm[i]) & 1;
+				gate->setPort(match.gate->pins[i], neg ? neg_bit(leaf) : pos_bit(leaf));
+			}
+			gate->setPort(ID::Y, gate_y);
+			y = match.neg_output ? not_bit(gate_y) : gate_y;
+		}
+
+		for (int i = 0; i < GetSize(output_bits); i++) {
+			int lit = output_lits[i];
+			module->connect(output_bits[i], (lit & 1) ? neg_bit(lit >> 1) : pos_bit(lit >> 1));
+		}
+		num_cells = GetSize(module->cells()) - orig_num_cells;
+	}
+};
+
+struct CutmapPass : public Pass {
+	CutmapPass() : Pass("cutmap", "map logic to LUTs or gates using priority cuts") { }
+	void help() override
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    cutmap [options] [selection]\n");
+		log("\n");
+		log("This pass maps the selected combinational cells to k-input LUTs or to a small\n");
+		log("set of internal gate cells, without calling ABC. The cells are converted to an\n");
+		log("and-inverter graph using the same models as the aigmap pass, so all cells\n");
+		log("supported by aigmap can be mapped.\n");
+		log("\n");
+		log("For every node of the graph, a small set of the best cuts (priority cuts) is\n");
+		log("kept. The first round selects the cuts for minimal depth, the following rounds\n");
+		log("reduce the area by area flow and exact area without increasing the depth.\n");
+		log("\n");
+		log("Undefined (x) and high-impedance (z) constant bits on the inputs of the mapped\n");
+		log("cells are treated as 0.\n");
+		log("\n");
+		log("    -lut <k>\n");
+		log("        map to $lut cells with up to k inputs (2 to 6). this is the default,\n");
+		log("        with k=4.\n");
+		log("\n");
+		log("    -g type1,type2,...\n");
+		log("        map to the specified list of gate types instead of LUTs. supported\n");
+		log("        gate types are:\n");
+		log("           AND, NAND, OR, NOR, XOR, XNOR, ANDNOT, ORNOT, MUX,\n");
+		log("           NMUX, AOI3, OAI3, AOI4, OAI4.\n");
+		log("        the NOT gate is always added to this list. the list has to contain\n");
+		log("        at least one of AND, NAND, OR, NOR, ANDNOT, ORNOT. the same aliases as\n");
+		log("        for the abc pass can be used: simple, cmos2, cmos3, cmos4, cmos, gates,\n");
+		log("        aig and all. the gate areas are the ones used by abc and stat.\n");
+		log("\n");
+		log("    -cuts <n>\n");
+		log("        the number of priority cuts kept for each node (default: 8).\n");
+		log("\n");
+		log("    -area <n>\n");
+		log("        the number of area recovery rounds. the first round uses area flow,\n");
+		log("        all following ones exact area (default: 3).\n");
+		log("\n");
+	}
+	void execute(std::vector<std::string> args, RTLIL::Design *design) override
+	{
+		int lut_size = 0;
+		std::string g_arg;
+		int max_cuts = 8;
+		int area_rounds = 3;
+
+		log_header(design, "Executing CUTMAP pass (map logic using priority cuts).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-lut" && argidx+1 < args.size()) {
+				lut_size = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-g" && argidx+1 < args.size()) {
+				g_arg = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-cuts" && argidx+1 < args.size()) {
+				max_cuts = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-area" && argidx+1 < args.size()) {
+				area_rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (lut_size != 0 && !g_arg.empty())
+			log_cmd_error("Options -lut and -g are exclusive.\n");
+		if (g_arg.empty() && lut_size == 0)
+			lut_size = 4;
+		if (g_arg.empty() && (lut_size < 2 || lut_size > CUTMAP_MAX_LEAVES))
+			log_cmd_error("LUT size must be between 2 and %d.\n", CUTMAP_MAX_LEAVES);
+		if (max_cuts < 1)
+			log_cmd_error("Invalid number of cuts %d.\n", max_cuts);
+		if (area_rounds < 0)
+			log_cmd_error("Invalid number of area recovery rounds %d.\n", area_rounds);
+
+		pool<std::string> enabled_gates;
+		for (auto g : split_tokens(g_arg, ",")) {
+			static const dict<std::string, vector<std::string>> aliases = {
+				{"simple", {"AND", "OR", "XOR", "MUX"}},
+				{"cmos2", {"NAND", "NOR"}},
+				{"cmos3", {"NAND", "NOR", "AOI3", "OAI3"}},
+				{"cmos4", {"NAND", "NOR", "AOI3", "OAI3", "AOI4", "OAI4"}},
+				{"cmos", {"NAND", "NOR", "AOI3", "OAI3", "AOI4", "OAI4", "NMUX", "MUX", "XOR", "XNOR"}},
+				{"gates", {"AND", "NAND", "OR", "NOR", "XOR", "XNOR", "ANDNOT", "ORNOT"}},
+				{"aig", {"AND", "NAND", "OR", "NOR", "ANDNOT", "ORNOT"}},
+				{"all", {"AND", "NAND", "OR", "NOR", "XOR", "XNOR", "ANDNOT", "ORNOT", "AOI3", "OAI3", "AOI4", "OAI4", "MUX", "NMUX"}},
+			};
+			if (aliases.count(g)) {
+				for (auto &name : aliases.at(g))
+					enabled_gates.insert(name);
+				continue;
+			}
+			bool found = false;
+			for (auto &gate : gate_types())
+				if (g == gate.name)
+					found = true;
+			if (!found)
+				log_cmd_error("Invalid gate type \"%s\" in -g argument.\n", g);
+			enabled_gates.insert(g);
+		}
+
+		// For gate mapping, find the cheapest gate for every function of up
+		// to four inputs, including inverters on the inputs and the output.
+		dict<uint32_t, GateMatch> gate_matches;
+		int max_leaves = lut_size;
+		if (!g_arg.empty()) {
+			enabled_gates.insert("NOT");
+			if (!enabled_gates.count("AND") && !enabled_gates.count("NAND") && !enabled_gates.count("OR") &&
+					!enabled_gates.count("NOR") && !enabled_gates.count("ANDNOT") && !enabled_gates.count("ORNOT"))
+				log_cmd_error("The gate list has to contain at least one of AND, NAND, OR, NOR, ANDNOT, ORNOT.\n");
+
+			auto &cell_cost = CellCosts::default_gate_cost();
+			float not_area = cell_cost.at(ID($_NOT_));
+			max_leaves = 2;
+			for (auto &gate : gate_types()) {
+				if (!enabled_gates.count(gate.name))
+					continue;
+				int n = GetSize(gate.pins);
+				max_leaves = std::max(max_leaves, n);
+				int perm[4] = {0, 1, 2, 3};
+				do {
+					for (int neg_leaves = 0; neg_leaves < (1 << n); neg_leaves++)
+					for (int neg_output = 0; neg_output < 2; neg_output++) {
+						uint32_t tt = 0;
+						for (int x = 0; x < (1 << n); x++) {
+							bool in[4] = {};
+							for (int i = 0; i < n; i++)
+								in[i] = ((x ^ neg_leaves) >> perm[i]) & 1;
+							if (eval_gate(gate.type, in) != bool(neg_output))
+								tt |= 1 << x;
+						}
+						float area = cell_cost.at(gate.type) + not_area * (__builtin_popcount(neg_leaves) + neg_output);
+						uint32_t key = (n << 16) | tt;
+						auto it = gate_matches.find(key);
+						if (it != gate_matches.end() && it->second.area <= area)
+							continue;
+						GateMatch match = {&gate, {perm[0], perm[1], perm[2], perm[3]}, neg_leaves, bool(neg_output), area};
+						gate_matches[key] = match;
+					}
+				} while (std::next_permutation(perm, perm + n));
+			}
+		}
+
+		for (auto module : design->selected_modules())
+		{
+			if (module->has_processes_warn())
+				continue;
+
+			vector<Cell*> cells;
+			vector<Aig> aigs;
+			for (auto cell : module->selected_cells()) {
+				if (cell->has_keep_attr())
+					continue;
+				Aig aig(cell);
+				if (aig.name.empty())
+					continue;
+				cells.push_back(cell);
+				aigs.push_back(std::move(aig));
+			}
+			if (cells.empty())
+				continue;
+
+			CutmapWorker worker(module, g_arg.empty(), gate_matches);
+			worker.extract(cells, aigs);
+
+			CutMapper mapper(worker.aig);
+			mapper.outputs = worker.output_lits;
+			mapper.max_leaves = max_leaves;
+			mapper.max_cuts = max_cuts;
+			mapper.lut_mode = g_arg.empty();
+			for (auto &it : gate_matches)
+				mapper.function_area[it.first] = it.second.area;
+			mapper.run(area_rounds);
+
+			for (auto cell : cells)
+				module->remove(cell);
+
+			int num_cells = 0;
+			worker.emit(mapper, num_cells);
+
+			log("Mapped %d cells in module %s (%d AIG nodes) to %d %s with depth %d.\n", GetSize(cells), module,
+					GetSize(worker.aig.strash), num_cells, g_arg.empty() ? "LUTs" : "gates", mapper.depth);
+		}
+	}
+} CutmapPass;
+
+PRIVATE_NAMESPACE_END
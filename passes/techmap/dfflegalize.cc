@@ -21,6 +21,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/ffinit.h"
 #include "kernel/ff.h"
+#include "kernel/threading.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -240,7 +241,7 @@ struct DffLegalizePass : public Pass {
 		}
 	}
 
-	int get_initmask(FfData &ff) {
+	int get_initmask(const FfData &ff) {
 		int res = 0;
 		if (ff.val_init[0] == State::S0)
 			res = INIT_0;
@@ -914,30 +915,33 @@ struct DffLegalizePass : public Pass {
 		legalize_finish(ff);
 	}
 
+	// The value an undefined reset bit has to take for the given init value,
+	// or Sx if the supported cells leave it undefined.
+	State fixed_reset_x(State init, int supported) {
+		int mask;
+		if (init == State::S0)
+			mask = INIT_0;
+		else if (init == State::S1)
+			mask = INIT_1;
+		else
+			mask = INIT_X;
+		State res = State::Sx;
+		if (!(supported & (mask << 8)))
+			res = State::S0;
+		if (!(supported & (mask << 4)))
+			res = State::S1;
+		return res;
+	}
+
 	void fixup_reset_x(FfData &ff, int supported) {
 		for (int i = 0; i < ff.width; i++) {
-			int mask;
-			if (ff.val_init[i] == State::S0)
-				mask = INIT_0;
-			else if (ff.val_init[i] == State::S1)
-				mask = INIT_1;
-			else
-				mask = INIT_X;
 			if (ff.has_arst) {
-				if (ff.val_arst[i] == State::Sx) {
-					if (!(supported & (mask << 8)))
-						ff.val_arst.set(i, State::S0);
-					if (!(supported & (mask << 4)))
-						ff.val_arst.set(i, State::S1);
-				}
+				if (ff.val_arst[i] == State::Sx)
+					ff.val_arst.set(i, fixed_reset_x(ff.val_init[i], supported));
 			}
 			if (ff.has_srst) {
-				if (ff.val_srst[i] == State::Sx) {
-					if (!(supported & (mask << 8)))
-						ff.val_srst.set(i, State::S0);
-					if (!(supported & (mask << 4)))
-						ff.val_srst.set(i, State::S1);
-				}
+				if (ff.val_srst[i] == State::Sx)
+					ff.val_srst.set(i, fixed_reset_x(ff.val_init[i], supported));
 			}
 		}
 	}
@@ -1002,10 +1006,7 @@ struct DffLegalizePass : public Pass {
 		pol = !pol;
 	}
 
-	void legalize_finish(FfData &ff) {
-		int ff_type = get_ff_type(ff);
-		int initmask = get_initmask(ff);
-		log_assert(supported_cells[ff_type] & initmask);
+	int get_ff_neg(const FfData &ff) {
 		int ff_neg = 0;
 		if (ff.has_sr) {
 			if (!ff.pol_clr)
@@ -1033,6 +1034,38 @@ struct DffLegalizePass : public Pass {
 			if (!ff.pol_ce)
 				ff_neg |= NEG_CE;
 		}
+		return ff_neg;
+	}
+
+	// Returns true if legalize_ff() would emit the FF unchanged, ie. if its
+	// exact type, polarities and init value are supported.  Only reads the
+	// FF and the tables, so that it can run on worker threads.
+	bool is_legal(const FfData &ff) {
+		if (ff.has_gclk || !ff.is_fine)
+			return true;
+		if (mince && ff.has_ce && ff.sig_ce[0].wire && ce_used.at(ff.sig_ce[0], 0) < mince)
+			return false;
+		if (minsrst && ff.has_srst && ff.sig_srst[0].wire && srst_used.at(ff.sig_srst[0], 0) < minsrst)
+			return false;
+		if (!ff.has_clk && !ff.has_aload && !ff.has_sr)
+			return false;
+		int supported = supported_cells_neg[get_ff_type(ff)][get_ff_neg(ff)];
+		if (!(supported & get_initmask(ff)))
+			return false;
+		for (int i = 0; i < ff.width; i++) {
+			if (ff.has_arst && ff.val_arst[i] == State::Sx && fixed_reset_x(ff.val_init[i], supported) != State::Sx)
+				return false;
+			if (ff.has_srst && ff.val_srst[i] == State::Sx && fixed_reset_x(ff.val_init[i], supported) != State::Sx)
+				return false;
+		}
+		return true;
+	}
+
+	void legalize_finish(FfData &ff) {
+		int ff_type = get_ff_type(ff);
+		int initmask = get_initmask(ff);
+		log_assert(supported_cells[ff_type] & initmask);
+		int ff_neg = get_ff_neg(ff);
 		if (!(supported_cells_neg[ff_type][ff_neg] & initmask)) {
 			// Cell is supported, but not with those polarities.
 			// Will need to add some inverters.
@@ -1243,33 +1276,67 @@ unrecognized:
 		supported_rlatch = supported_adff | (supported_dlatch & 7) * 0x111;
 		supported_adlatch = supported_cells[FF_ADLATCH] | supported_cells[FF_DLATCHSR];
 
-		for (auto module : design->selected_modules())
+		// Use no more than one worker per thousand cells, so that small
+		// modules are handled on the main thread.
+		std::vector<Module*> modules = design->selected_modules();
+		int thread_pool_size = 0;
+		for (auto module : modules)
+			thread_pool_size = std::max(thread_pool_size, ThreadPool::work_pool_size(0, module->cells_size(), 1000));
+		ParallelDispatchThreadPool thread_pool(thread_pool_size);
+
+		for (auto module : modules)
 		{
+			ParallelDispatchThreadPool::Subpool subpool(thread_pool, ThreadPool::work_pool_size(0, module->cells_size(), 1000));
+			const RTLIL::Module *const_module = module;
+
 			sigmap.set(module);
-			initvals.set(&sigmap, module);
+			initvals.set_parallel(&sigmap, thread_pool, module);
 
 			if (mince || minsrst) {
 				ce_used.clear();
 				srst_used.clear();
 
-				for (auto cell : module->cells()) {
-					if (!cell->is_builtin_ff())
-						continue;
-
-					FfData ff(&initvals, cell);
-					if (ff.has_ce && ff.sig_ce[0].wire)
-						ce_used[ff.sig_ce[0]] += ff.width;
-					if (ff.has_srst && ff.sig_srst[0].wire)
-						srst_used[ff.sig_srst[0]] += ff.width;
-				}
+				ShardedVector<std::pair<SigBit, int>> ce_sigs(subpool), srst_sigs(subpool);
+				subpool.run([&](const ParallelDispatchThreadPool::RunCtx &ctx) {
+					for (int i : ctx.item_range(const_module->cells_size())) {
+						Cell *cell = const_module->cell_at(i);
+						if (!cell->is_builtin_ff())
+							continue;
+
+						FfData ff(&initvals, cell);
+						if (ff.has_ce && ff.sig_ce[0].wire)
+							ce_sigs.insert(ctx, {ff.sig_ce[0], ff.width});
+						if (ff.has_srst && ff.sig_srst[0].wire)
+							srst_sigs.insert(ctx, {ff.sig_srst[0], ff.width});
+					}
+				});
+				for (auto &it : ce_sigs)
+					ce_used[it.first] += it.second;
+				for (auto &it : srst_sigs)
+					srst_used[it.first] += it.second;
 			}
+
+			std::vector<Cell*> ff_cells;
 			for (auto cell : module->selected_cells())
-			{
-				if (!cell->is_builtin_ff())
-					continue;
-				FfData ff(&initvals, cell);
-				legalize_ff(ff);
-			}
+				if (cell->is_builtin_ff())
+					ff_cells.push_back(cell);
+
+			// Converting the cells to FfData and checking them against the
+			// supported cells only reads the module, so it is done on the
+			// worker threads. FFs that are already legal are left alone, all
+			// others are legalized afterwards in the original order.
+			std::vector<std::optional<FfData>> illegal_ffs(GetSize(ff_cells));
+			subpool.run([&](const ParallelDispatchThreadPool::RunCtx &ctx) {
+				for (int i : ctx.item_range(GetSize(ff_cells))) {
+					FfData ff(&initvals, ff_cells[i]);
+					if (!is_legal(ff))
+						illegal_ffs[i].emplace(std::move(ff));
+				}
+			});
+
+			for (auto &ff : illegal_ffs)
+				if (ff)
+					legalize_ff(*ff);
 		}
 
 		sigmap.clear();
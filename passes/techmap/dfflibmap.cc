@@ -21,6 +21,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/gzip.h"
 #include "kernel/newcelltypes.h"
+#include "kernel/threading.h"
 #include "libparse.h"
 #include <string.h>
 #include <errno.h>
@@ -417,54 +418,110 @@ static void find_cell(std::vector<const LibertyAst *> cells, IdString cell_type,
 	}
 }
 
+// A port of a mapped cell as given by cell_mapping::ports, with the port
+// names already converted to IdStrings.
+struct mapped_port {
+	IdString name;
+	char kind;
+	IdString source;
+};
+
+// The signals of the old cell that are connected to the ports of the new
+// cell, gathered on a worker thread for the ports with an uppercase or
+// lowercase kind.
+struct staged_cell {
+	std::vector<RTLIL::SigSpec> sigs;
+	std::string src;
+};
+
 static void dfflibmap(RTLIL::Design *design, RTLIL::Module *module)
 {
 	log("Mapping DFF/DLATCH cells in module `%s':\n", module->name);
 
+	dict<IdString, std::vector<mapped_port>> mapped_ports;
+	for (auto &it : cell_mappings)
+		for (auto &port : it.second.ports) {
+			mapped_port mp = {"\\" + port.first, port.second, IdString()};
+			if ('A' <= port.second && port.second <= 'Z')
+				mp.source = std::string("\\") + port.second;
+			else if ('a' <= port.second && port.second <= 'z')
+				mp.source = std::string("\\") + char(port.second - ('a' - 'A'));
+			mapped_ports[it.first].push_back(mp);
+		}
+
 	dict<SigBit, pool<Cell*>> notmap;
 	SigMap sigmap(module);
 
+	// Use no more than one worker per thousand cells, so that small
+	// modules are handled on the main thread.
+	ParallelDispatchThreadPool thread_pool(ThreadPool::work_pool_size(0, module->cells_size(), 1000));
+	const RTLIL::Module *const_module = module;
+
+	ShardedVector<RTLIL::Cell*> mapped_cells(thread_pool), wide_ff_cells(thread_pool);
+	ShardedVector<std::pair<RTLIL::SigSpec, RTLIL::Cell*>> not_cells(thread_pool);
+	thread_pool.run([&](const ParallelDispatchThreadPool::RunCtx &ctx) {
+		for (int i : ctx.item_range(const_module->cells_size())) {
+			RTLIL::Cell *cell = const_module->cell_at(i);
+			auto cats = StaticCellTypes::categories;
+			if (cats.is_ff(cell->type) && !cats.is_stdcell(cell->type))
+				wide_ff_cells.insert(ctx, cell);
+
+			if (design->selected(const_module, cell) && cell_mappings.count(cell->type) > 0)
+				mapped_cells.insert(ctx, cell);
+			if (cell->type == ID($_NOT_))
+				not_cells.insert(ctx, {sigmap(cell->getPort(ID::A)), cell});
+		}
+	});
+
+	for (auto cell : wide_ff_cells)
+		log_error("Wide register cell type %s is not supported.\n"
+				  "Convert netlist to gate-level first.\n", cell->type);
+
 	std::vector<RTLIL::Cell*> cell_list;
-	for (auto cell : module->cells()) {
-		auto cats = StaticCellTypes::categories;
-		if (cats.is_ff(cell->type) && !cats.is_stdcell(cell->type))
-			log_error("Wide register cell type %s is not supported.\n"
-					  "Convert netlist to gate-level first.\n", cell->type);
-
-		if (design->selected(module, cell) && cell_mappings.count(cell->type) > 0)
-			cell_list.push_back(cell);
-		if (cell->type == ID($_NOT_))
-			notmap[sigmap(cell->getPort(ID::A))].insert(cell);
-	}
+	for (auto cell : mapped_cells)
+		cell_list.push_back(cell);
+	for (auto &it : not_cells)
+		notmap[it.first].insert(it.second);
+
+	std::vector<staged_cell> staged(GetSize(cell_list));
+	thread_pool.run([&](const ParallelDispatchThreadPool::RunCtx &ctx) {
+		for (int i : ctx.item_range(GetSize(cell_list))) {
+			RTLIL::Cell *cell = cell_list[i];
+			for (auto &port : mapped_ports.at(cell->type))
+				staged[i].sigs.push_back(port.source.empty() ? RTLIL::SigSpec() : cell->connections().at(port.source, RTLIL::SigSpec()));
+			staged[i].src = cell->get_src_attribute();
+		}
+	});
 
-	std::map<std::string, int> stats;
-	for (auto cell : cell_list)
+	dict<std::pair<IdString, IdString>, int> stats;
+	for (int i = 0; i < GetSize(cell_list); i++)
 	{
-		auto cell_type = cell->type;
-		auto cell_name = cell->name;
-		auto cell_connections = cell->connections();
-		std::string src = cell->get_src_attribute();
+		auto cell_type = cell_list[i]->type;
+		auto cell_name = cell_list[i]->name;
+		const std::vector<RTLIL::SigSpec> &cell_sigs = staged[i].sigs;
 
-		module->remove(cell);
+		module->remove(cell_list[i]);
 
 		cell_mapping &cm = cell_mappings[cell_type];
+		const std::vector<mapped_port> &ports = mapped_ports.at(cell_type);
 		RTLIL::Cell *new_cell = module->addCell(cell_name, cm.cell_name);
 
-		new_cell->set_src_attribute(src);
+		new_cell->set_src_attribute(staged[i].src);
 
 		bool has_q = false, has_qn = false;
-		for (auto &port : cm.ports) {
-			if (port.second == 'Q') has_q = true;
-			if (port.second == 'q') has_qn = true;
+		for (auto &port : ports) {
+			if (port.kind == 'Q') has_q = true;
+			if (port.kind == 'q') has_qn = true;
 		}
 
-		for (auto &port : cm.ports) {
+		for (int j = 0; j < GetSize(ports); j++) {
+			const mapped_port &port = ports[j];
 			RTLIL::SigSpec sig;
-			if ('A' <= port.second && port.second <= 'Z') {
-				sig = cell_connections[std::string("\\") + port.second];
+			if ('A' <= port.kind && port.kind <= 'Z') {
+				sig = cell_sigs[j];
 			} else
-			if (port.second == 'q') {
-				RTLIL::SigSpec old_sig = cell_connections[std::string("\\") + char(port.second - ('a' - 'A'))];
+			if (port.kind == 'q') {
+				const RTLIL::SigSpec &old_sig = cell_sigs[j];
 				sig = module->addWire(NEW_ID, GetSize(old_sig));
 				if (has_q && has_qn) {
 					for (auto &it : notmap[sigmap(old_sig)]) {
@@ -475,24 +532,26 @@ static void dfflibmap(RTLIL::Design *design, RTLIL::Module *module)
 					module->addNotGate(NEW_ID, sig, old_sig);
 				}
 			} else
-			if ('a' <= port.second && port.second <= 'z') {
-				sig = cell_connections[std::string("\\") + char(port.second - ('a' - 'A'))];
-				sig = module->NotGate(NEW_ID, sig);
+			if ('a' <= port.kind && port.kind <= 'z') {
+				sig = module->NotGate(NEW_ID, cell_sigs[j]);
 			} else
-			if (port.second == '0' || port.second == '1') {
-				sig = RTLIL::SigSpec(port.second == '0' ? 0 : 1, 1);
+			if (port.kind == '0' || port.kind == '1') {
+				sig = RTLIL::SigSpec(port.kind == '0' ? 0 : 1, 1);
 			} else
-			if (port.second == 0) {
+			if (port.kind == 0) {
 				sig = module->addWire(NEW_ID);
 			} else
 				log_abort();
-			new_cell->setPort("\\" + port.first, sig);
+			new_cell->setPort(port.name, sig);
 		}
 
-		stats[stringf("%s cells to %s cells", cell_type, new_cell->type)]++;
+		stats[{cell_type, new_cell->type}]++;
 	}
 
-	for (auto &stat: stats)
+	std::map<std::string, int> sorted_stats;
+	for (auto &stat : stats)
+		sorted_stats[stringf("%s cells to %s cells", stat.first.first, stat.first.second)] += stat.second;
+	for (auto &stat: sorted_stats)
 		log("  mapped %d %s.\n", stat.second, stat.first);
 }
 
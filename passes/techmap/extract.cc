@@ -20,6 +20,7 @@
 #include "kernel/register.h"
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
+#include "kernel/threading.h"
 #include "libs/subcircuit/subcircuit.h"
 #include <algorithm>
 #include <stdlib.h>
@@ -35,11 +36,21 @@ public:
 	bool ignore_parameters;
 	std::set<std::pair<RTLIL::IdString, RTLIL::IdString>> ignored_parameters;
 	std::set<RTLIL::IdString> cell_attr, wire_attr;
+	// the compare callback runs on worker threads with -j, where no IdStrings
+	// can be created, so port names are looked up here
+	dict<std::string, RTLIL::IdString> port_ids;
 
 	SubCircuitSolver() : ignore_parameters(false)
 	{
 	}
 
+	void add_port_ids(RTLIL::Module *module)
+	{
+		for (auto cell : module->cells())
+			for (auto &conn : cell->connections())
+				port_ids.emplace(conn.first.str(), conn.first);
+	}
+
 	bool compareAttributes(const std::set<RTLIL::IdString> &attr, const dict<RTLIL::IdString, RTLIL::Const> &needleAttr, const dict<RTLIL::IdString, RTLIL::Const> &haystackAttr)
 	{
 		for (auto &it : attr) {
@@ -127,7 +138,7 @@ public:
 			for (auto &conn : needleCell->connections())
 			{
 				RTLIL::SigSpec needleSig = conn.second;
-				RTLIL::SigSpec haystackSig = haystackCell->getPort(portMapping.at(conn.first.str()));
+				RTLIL::SigSpec haystackSig = haystackCell->getPort(port_ids.at(portMapping.at(conn.first.str())));
 
 				for (int i = 0; i < min(needleSig.size(), haystackSig.size()); i++) {
 					RTLIL::Wire *needleWire = needleSig[i].wire, *haystackWire = haystackSig[i].wire;
@@ -368,6 +379,11 @@ struct ExtractPass : public Pass {
 		log("    -verbose\n");
 		log("        print debug output while analyzing\n");
 		log("\n");
+		log("    -j <N>\n");
+		log("        search for matches on up to N threads. the top-level branches of the\n");
+		log("        search are distributed over the threads and the matches are merged\n");
+		log("        in the original order, so the result does not depend on N.\n");
+		log("\n");
 		log("    -constports\n");
 		log("        also find instances with constant drivers. this may be much\n");
 		log("        slower than the normal operation.\n");
@@ -445,6 +461,7 @@ struct ExtractPass : public Pass {
 		std::string mine_outfile;
 		bool constports = false;
 		bool nodefaultswaps = false;
+		int threads = 1;
 
 		bool mine_mode = false;
 		int mine_cells_min = 3;
@@ -495,6 +512,10 @@ struct ExtractPass : public Pass {
 				solver.setVerbose();
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				threads = std::max(1, atoi(args[++argidx].c_str()));
+				continue;
+			}
 			if (args[argidx] == "-constports") {
 				constports = true;
 				continue;
@@ -621,6 +642,9 @@ struct ExtractPass : public Pass {
 		std::map<std::string, RTLIL::Module*> needle_map, haystack_map;
 		std::vector<RTLIL::Module*> needle_list;
 
+		if (threads > 1)
+			solver.setThreads(std::max(1, ThreadPool::pool_size(0, threads)));
+
 		log_header(design, "Creating graphs for SubCircuit library.\n");
 
 		if (!mine_mode)
@@ -630,6 +654,7 @@ struct ExtractPass : public Pass {
 				log("Creating needle graph %s.\n", graph_name);
 				if (module2graph(mod_graph, module, constports)) {
 					solver.addGraph(graph_name, mod_graph);
+					solver.add_port_ids(module);
 					needle_map[graph_name] = module;
 					needle_list.push_back(module);
 				}
@@ -641,6 +666,7 @@ struct ExtractPass : public Pass {
 			log("Creating haystack graph %s.\n", graph_name);
 			if (module2graph(mod_graph, module, constports, design, mine_mode ? mine_max_fanout : -1, mine_mode ? &mine_split : nullptr)) {
 				solver.addGraph(graph_name, mod_graph);
+				solver.add_port_ids(module);
 				haystack_map[graph_name] = module;
 			}
 		}
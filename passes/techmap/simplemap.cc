@@ -34,6 +34,13 @@ static void transfer_attr (Cell* to, const Cell* from, IdString attr) {
 static void transfer_src (Cell* to, const Cell* from) {
 	transfer_attr(to, from, ID::src);
 }
+// the attributes transfer_src() gives each gate, for Module::addCells()
+static dict<IdString, Const> src_attributes (const Cell* from) {
+	dict<IdString, Const> attributes;
+	if (from->has_attribute(ID::src))
+		attributes[ID::src] = from->attributes.at(ID::src);
+	return attributes;
+}
 
 void simplemap_not(RTLIL::Module *module, RTLIL::Cell *cell)
 {
@@ -42,12 +49,10 @@ void simplemap_not(RTLIL::Module *module, RTLIL::Cell *cell)
 
 	sig_a.extend_u0(GetSize(sig_y), cell->parameters.at(ID::A_SIGNED).as_bool());
 
-	for (int i = 0; i < GetSize(sig_y); i++) {
-		RTLIL::Cell *gate = module->addCell(NEW_ID, ID($_NOT_));
-		transfer_src(gate, cell);
-		gate->setPort(ID::A, sig_a[i]);
-		gate->setPort(ID::Y, sig_y[i]);
-	}
+	std::vector<IdString> names;
+	for (int i = 0; i < GetSize(sig_y); i++)
+		names.push_back(NEW_ID);
+	module->addCells(names, ID($_NOT_), {{ID::A, sig_a}, {ID::Y, sig_y}}, src_attributes(cell));
 }
 
 void simplemap_buf(RTLIL::Module *module, RTLIL::Cell *cell)
@@ -102,13 +107,10 @@ void simplemap_bitop(RTLIL::Module *module, RTLIL::Cell *cell)
 	if (cell->type == ID($bweqx)) gate_type = ID($_XNOR_);
 	log_assert(!gate_type.empty());
 
-	for (int i = 0; i < GetSize(sig_y); i++) {
-		RTLIL::Cell *gate = module->addCell(NEW_ID, gate_type);
-		transfer_src(gate, cell);
-		gate->setPort(ID::A, sig_a[i]);
-		gate->setPort(ID::B, sig_b[i]);
-		gate->setPort(ID::Y, sig_y[i]);
-	}
+	std::vector<IdString> names;
+	for (int i = 0; i < GetSize(sig_y); i++)
+		names.push_back(NEW_ID);
+	module->addCells(names, gate_type, {{ID::A, sig_a}, {ID::B, sig_b}, {ID::Y, sig_y}}, src_attributes(cell));
 }
 
 void simplemap_reduce(RTLIL::Module *module, RTLIL::Cell *cell)
@@ -294,14 +296,12 @@ void simplemap_mux(RTLIL::Module *module, RTLIL::Cell *cell)
 	RTLIL::SigSpec sig_b = cell->getPort(ID::B);
 	RTLIL::SigSpec sig_y = cell->getPort(ID::Y);
 
-	for (int i = 0; i < GetSize(sig_y); i++) {
-		RTLIL::Cell *gate = module->addCell(NEW_ID, ID($_MUX_));
-		transfer_src(gate, cell);
-		gate->setPort(ID::A, sig_a[i]);
-		gate->setPort(ID::B, sig_b[i]);
-		gate->setPort(ID::S, cell->getPort(ID::S));
-		gate->setPort(ID::Y, sig_y[i]);
-	}
+	RTLIL::SigSpec sig_s(cell->getPort(ID::S).as_bit(), GetSize(sig_y));
+
+	std::vector<IdString> names;
+	for (int i = 0; i < GetSize(sig_y); i++)
+		names.push_back(NEW_ID);
+	module->addCells(names, ID($_MUX_), {{ID::A, sig_a}, {ID::B, sig_b}, {ID::S, sig_s}, {ID::Y, sig_y}}, src_attributes(cell));
 }
 
 void simplemap_bwmux(RTLIL::Module *module, RTLIL::Cell *cell)
@@ -311,14 +311,10 @@ void simplemap_bwmux(RTLIL::Module *module, RTLIL::Cell *cell)
 	RTLIL::SigSpec sig_s = cell->getPort(ID::S);
 	RTLIL::SigSpec sig_y = cell->getPort(ID::Y);
 
-	for (int i = 0; i < GetSize(sig_y); i++) {
-		RTLIL::Cell *gate = module->addCell(NEW_ID, ID($_MUX_));
-		transfer_src(gate, cell);
-		gate->setPort(ID::A, sig_a[i]);
-		gate->setPort(ID::B, sig_b[i]);
-		gate->setPort(ID::S, sig_s[i]);
-		gate->setPort(ID::Y, sig_y[i]);
-	}
+	std::vector<IdString> names;
+	for (int i = 0; i < GetSize(sig_y); i++)
+		names.push_back(NEW_ID);
+	module->addCells(names, ID($_MUX_), {{ID::A, sig_a}, {ID::B, sig_b}, {ID::S, sig_s}, {ID::Y, sig_y}}, src_attributes(cell));
 }
 
 void simplemap_tribuf(RTLIL::Module *module, RTLIL::Cell *cell)
@@ -327,13 +323,11 @@ void simplemap_tribuf(RTLIL::Module *module, RTLIL::Cell *cell)
 	RTLIL::SigSpec sig_e = cell->getPort(ID::EN);
 	RTLIL::SigSpec sig_y = cell->getPort(ID::Y);
 
-	for (int i = 0; i < GetSize(sig_y); i++) {
-		RTLIL::Cell *gate = module->addCell(NEW_ID, ID($_TBUF_));
-		transfer_src(gate, cell);
-		gate->setPort(ID::A, sig_a[i]);
-		gate->setPort(ID::E, sig_e);
-		gate->setPort(ID::Y, sig_y[i]);
-	}
+	std::vector<IdString> names;
+	for (int i = 0; i < GetSize(sig_y); i++)
+		names.push_back(NEW_ID);
+	module->addCells(names, ID($_TBUF_), {{ID::A, sig_a}, {ID::E, RTLIL::SigSpec(sig_e.as_bit(), GetSize(sig_y))}, {ID::Y, sig_y}},
+			src_attributes(cell));
 }
 
 void simplemap_bmux(RTLIL::Module *module, RTLIL::Cell *cell)
@@ -344,16 +338,17 @@ void simplemap_bmux(RTLIL::Module *module, RTLIL::Cell *cell)
 
 	for (int idx = 0; idx < GetSize(sel); idx++) {
 		SigSpec new_data = module->addWire(NEW_ID, GetSize(data)/2);
+		SigSpec sig_a, sig_b;
+		std::vector<IdString> names;
 		for (int i = 0; i < GetSize(new_data); i += width) {
 			for (int k = 0; k < width; k++) {
-				RTLIL::Cell *gate = module->addCell(NEW_ID, ID($_MUX_));
-				transfer_src(gate, cell);
-				gate->setPort(ID::A, data[i*2+k]);
-				gate->setPort(ID::B, data[i*2+width+k]);
-				gate->setPort(ID::S, sel[idx]);
-				gate->setPort(ID::Y, new_data[i+k]);
+				names.push_back(NEW_ID);
+				sig_a.append(data[i*2+k]);
+				sig_b.append(data[i*2+width+k]);
 			}
 		}
+		module->addCells(names, ID($_MUX_), {{ID::A, sig_a}, {ID::B, sig_b}, {ID::S, SigSpec(sel[idx], GetSize(new_data))},
+				{ID::Y, new_data}}, src_attributes(cell));
 		data = new_data;
 	}
 
@@ -368,14 +363,15 @@ void simplemap_lut(RTLIL::Module *module, RTLIL::Cell *cell)
 
 	for (int idx = 0; GetSize(lut_data) > 1; idx++) {
 		SigSpec new_lut_data = module->addWire(NEW_ID, GetSize(lut_data)/2);
+		SigSpec sig_a, sig_b;
+		std::vector<IdString> names;
 		for (int i = 0; i < GetSize(lut_data); i += 2) {
-			RTLIL::Cell *gate = module->addCell(NEW_ID, ID($_MUX_));
-			transfer_src(gate, cell);
-			gate->setPort(ID::A, lut_data[i]);
-			gate->setPort(ID::B, lut_data[i+1]);
-			gate->setPort(ID::S, lut_ctrl[idx]);
-			gate->setPort(ID::Y, new_lut_data[i/2]);
+			names.push_back(NEW_ID);
+			sig_a.append(lut_data[i]);
+			sig_b.append(lut_data[i+1]);
 		}
+		module->addCells(names, ID($_MUX_), {{ID::A, sig_a}, {ID::B, sig_b}, {ID::S, SigSpec(lut_ctrl[idx], GetSize(new_lut_data))},
+				{ID::Y, new_lut_data}}, src_attributes(cell));
 		lut_data = new_lut_data;
 	}
 
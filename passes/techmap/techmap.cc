@@ -22,10 +22,14 @@
 #include "kernel/sigtools.h"
 #include "kernel/ffinit.h"
 #include "libs/sha1/sha1.h"
+#include "frontends/verilog/verilog_frontend.h"
+#include "frontends/verilog/preproc.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fstream>
+#include <sstream>
 
 #include "simplemap.h"
 
@@ -960,8 +964,130 @@ struct TechmapWorker
 	}
 };
 
+// A map library as left behind by a techmap call: the design read from the
+// map files and the templates specialized so far, so that a later call with
+// the same library neither needs to read the files nor to derive and run the
+// _TECHMAP_DO_* commands of those templates again. The cell type map is the
+// one built when the files were read, as the specialized templates added to
+// `map` since then must not become templates themselves.
+struct TechmapLibrary
+{
+	RTLIL::Design *map = nullptr;
+	dict<IdString, pool<IdString>> celltypeMap;
+	dict<std::pair<IdString, dict<IdString, RTLIL::Const>>, RTLIL::Module*> techmap_cache;
+	dict<RTLIL::Module*, bool> techmap_do_cache;
+	int last_used = 0;
+};
+
+static dict<std::string, TechmapLibrary> techmap_library_cache;
+// at most this many libraries, with at most this many modules (map file
+// modules and specialized templates) in total, are kept
+static constexpr int techmap_library_cache_size = 8;
+static constexpr int techmap_library_cache_modules = 4096;
+static int techmap_library_counter = 0;
+
+// Adds the name and the hash of the contents of a map file to `key`, followed
+// by those of the files it includes, resolved like the Verilog preprocessor
+// does. Returns false if an include can not be resolved statically.
+static bool techmap_library_add_file(std::string &key, const std::string &fn, const std::vector<std::string> &include_dirs,
+		pool<std::string> &visited)
+{
+	if (!visited.insert(fn).second)
+		return true;
+	std::ifstream f(fn, std::ios::binary);
+	if (f.fail())
+		return false;
+	std::stringstream buffer;
+	buffer << f.rdbuf();
+	std::string content = buffer.str();
+	key += "|" + fn + ":" + sha1(content);
+
+	std::string parent = fn.find('/') == std::string::npos ? "" : fn.substr(0, fn.rfind('/') + 1);
+	for (size_t pos = content.find("`include"); pos != std::string::npos; pos = content.find("`include", pos + 1)) {
+		size_t begin = content.find_first_not_of(" \t", pos + 8);
+		if (begin == std::string::npos || content[begin] != '"')
+			return false;
+		size_t end = content.find('"', begin + 1);
+		if (end == std::string::npos)
+			return false;
+		std::string name = content.substr(begin + 1, end - begin - 1);
+
+		std::vector<std::string> candidates = {name};
+		if (!name.empty() && name[0] != '/') {
+			if (!parent.empty())
+				candidates.push_back(parent + name);
+			for (auto &dir : include_dirs)
+				candidates.push_back(dir + "/" + name);
+		}
+		bool found = false;
+		for (auto &candidate : candidates)
+			if (std::ifstream(candidate).good()) {
+				if (!techmap_library_add_file(key, candidate, include_dirs, visited))
+					return false;
+				found = true;
+				break;
+			}
+		if (!found)
+			key += "|" + name + ":missing";
+	}
+	return true;
+}
+
+// Returns the key for caching the map library read by a techmap call, or an
+// empty string if it can not be cached.
+static std::string techmap_library_key(RTLIL::Design *design, const std::vector<std::string> &map_files,
+		const std::string &verilog_frontend, const TechmapWorker &worker, const std::vector<RTLIL::IdString> &dont_map)
+{
+	if (worker.extern_mode)
+		return "";
+
+	// the defines of the design are not tracked
+	for (auto &it : design->verilog_defines->defines)
+		if (it.first != "YOSYS")
+			return "";
+
+	// the map files are read with the options given to techmap and the
+	// options set with verilog_defaults
+	std::vector<std::string> options = split_tokens(verilog_frontend);
+	const std::vector<std::string> &defaults = VERILOG_FRONTEND::default_options();
+	options.insert(options.end(), defaults.begin(), defaults.end());
+
+	std::string key;
+	std::vector<std::string> include_dirs;
+	for (int i = 0; i < GetSize(options); i++) {
+		key += options[i] + " ";
+		if (options[i] == "-I" && i+1 < GetSize(options))
+			include_dirs.push_back(options[i+1]);
+		else if (options[i].compare(0, 2, "-I") == 0 && options[i].size() > 2)
+			include_dirs.push_back(options[i].substr(2));
+	}
+	key += stringf("|%d%d%d", worker.recursive_mode, worker.autoproc_mode, worker.ignore_wb);
+	for (auto type : dont_map)
+		key += stringf("|%s", type);
+
+	std::vector<std::string> files = map_files;
+	if (files.empty())
+		files.push_back("+/techmap.v");
+	pool<std::string> visited;
+	for (auto fn : files) {
+		if (fn.compare(0, 1, "%") == 0)
+			return "";
+		key += "|" + fn;
+		rewrite_filename(fn);
+		if (!techmap_library_add_file(key, fn, include_dirs, visited))
+			return "";
+	}
+	return key;
+}
+
 struct TechmapPass : public Pass {
 	TechmapPass() : Pass("techmap", "generic technology mapper") { }
+	void on_shutdown() override
+	{
+		for (auto &it : techmap_library_cache)
+			delete it.second.map;
+		techmap_library_cache.clear();
+	}
 	void help() override
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1017,6 +1143,9 @@ struct TechmapPass : public Pass {
 		log("        use paths relative to share directory for source locations\n");
 		log("        where possible (experimental).\n");
 		log("\n");
+		log("    -nocache\n");
+		log("        do not use or update the in-process cache of map libraries (see below)\n");
+		log("\n");
 		log("When a module in the map file has the 'techmap_celltype' attribute set, it will\n");
 		log("match cells with a type that match the text value of this attribute. Otherwise\n");
 		log("the module name will be used to match the cell.  Multiple space-separated cell\n");
@@ -1133,6 +1262,16 @@ struct TechmapPass : public Pass {
 		log("changed to the content of the techmap_chtype attribute. This allows for choosing\n");
 		log("the cell type dynamically.\n");
 		log("\n");
+		log("The map library read from the map files, together with all templates that\n");
+		log("have been specialized for the cells mapped with it, is kept in memory and\n");
+		log("reused by later techmap calls with the same map files and options. The cache\n");
+		log("is keyed by the contents of the map files and of the files they include, and\n");
+		log("by the options set with 'verilog_defaults'. Map libraries from saved designs\n");
+		log("('-map %%<name>'), -extern mode and designs with Verilog defines set by\n");
+		log("'read_verilog -D' or 'verilog_defines' are never cached. At most 8 libraries\n");
+		log("with at most 4096 modules in total are kept, the least recently used library\n");
+		log("is dropped first.\n");
+		log("\n");
 		log("See 'help extract' for a pass that does the opposite thing.\n");
 		log("\n");
 		log("See 'help flatten' for a pass that does flatten the design (which is\n");
@@ -1151,6 +1290,7 @@ struct TechmapPass : public Pass {
 		std::vector<RTLIL::IdString> dont_map;
 		std::string verilog_frontend = "verilog -nooverwrite -noblackbox -icells";
 		int max_iter = -1;
+		bool nocache = false;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -1199,14 +1339,34 @@ struct TechmapPass : public Pass {
 				dont_map.push_back(RTLIL::escape_id(args[++argidx]));
 				continue;
 			}
+			if (args[argidx] == "-nocache") {
+				nocache = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
-		RTLIL::Design *map = new RTLIL::Design;
-		if (map_files.empty()) {
+		std::string cache_key = nocache ? "" : techmap_library_key(design, map_files, verilog_frontend, worker, dont_map);
+
+		RTLIL::Design *map = nullptr;
+		dict<IdString, pool<IdString>> celltypeMap;
+		bool cache_hit = false;
+		auto cached = techmap_library_cache.find(cache_key);
+		if (!cache_key.empty() && cached != techmap_library_cache.end()) {
+			// taken out of the cache while in use, for nested techmap calls
+			cache_hit = true;
+			map = cached->second.map;
+			celltypeMap = std::move(cached->second.celltypeMap);
+			worker.techmap_cache = std::move(cached->second.techmap_cache);
+			worker.techmap_do_cache = std::move(cached->second.techmap_do_cache);
+			techmap_library_cache.erase(cached);
+			log("Using cached map library with %d modules.\n", GetSize(map->modules()));
+		} else if (map_files.empty()) {
+			map = new RTLIL::Design;
 			Frontend::frontend_call(map, nullptr, "+/techmap.v", verilog_frontend);
 		} else {
+			map = new RTLIL::Design;
 			for (auto &fn : map_files)
 				if (fn.compare(0, 1, "%") == 0) {
 					if (!saved_designs.count(fn.substr(1))) {
@@ -1223,42 +1383,43 @@ struct TechmapPass : public Pass {
 
 		log_header(design, "Continuing TECHMAP pass.\n");
 
-		dict<IdString, pool<IdString>> celltypeMap;
-		for (auto module : map->modules()) {
-			if (module->attributes.count(ID::techmap_celltype) && !module->attributes.at(ID::techmap_celltype).empty()) {
-				char *p = strdup(module->attributes.at(ID::techmap_celltype).decode_string().c_str());
-				for (char *q = strtok(p, " \t\r\n"); q; q = strtok(nullptr, " \t\r\n")) {
-					std::vector<std::string> queue;
-					queue.push_back(q);
-					while (!queue.empty()) {
-						std::string name = queue.back();
-						queue.pop_back();
-						auto pos = name.find('[');
-						if (pos == std::string::npos) {
-							// No further expansion.
-							celltypeMap[RTLIL::escape_id(name)].insert(module->name);
-						} else {
-							// Expand [] in this name.
-							auto epos = name.find(']', pos);
-							if (epos == std::string::npos)
-								log_error("Malformed techmap_celltype pattern %s\n", q);
-							for (size_t i = pos + 1; i < epos; i++) {
-								queue.push_back(name.substr(0, pos) + name[i] + name.substr(epos + 1, std::string::npos));
+		if (!cache_hit) {
+			for (auto module : map->modules()) {
+				if (module->attributes.count(ID::techmap_celltype) && !module->attributes.at(ID::techmap_celltype).empty()) {
+					char *p = strdup(module->attributes.at(ID::techmap_celltype).decode_string().c_str());
+					for (char *q = strtok(p, " \t\r\n"); q; q = strtok(nullptr, " \t\r\n")) {
+						std::vector<std::string> queue;
+						queue.push_back(q);
+						while (!queue.empty()) {
+							std::string name = queue.back();
+							queue.pop_back();
+							auto pos = name.find('[');
+							if (pos == std::string::npos) {
+								// No further expansion.
+								celltypeMap[RTLIL::escape_id(name)].insert(module->name);
+							} else {
+								// Expand [] in this name.
+								auto epos = name.find(']', pos);
+								if (epos == std::string::npos)
+									log_error("Malformed techmap_celltype pattern %s\n", q);
+								for (size_t i = pos + 1; i < epos; i++) {
+									queue.push_back(name.substr(0, pos) + name[i] + name.substr(epos + 1, std::string::npos));
+								}
 							}
 						}
 					}
+					free(p);
+				} else {
+					IdString module_name = module->name.begins_with("\\$") ?
+							module->name.substr(1) : module->name.str();
+					celltypeMap[module_name].insert(module->name);
 				}
-				free(p);
-			} else {
-				IdString module_name = module->name.begins_with("\\$") ?
-						module->name.substr(1) : module->name.str();
-				celltypeMap[module_name].insert(module->name);
 			}
-		}
 
-		// Erase any rules disabled with a -dont_map argument
-		for (auto type : dont_map)
-			celltypeMap.erase(type);
+			// Erase any rules disabled with a -dont_map argument
+			for (auto type : dont_map)
+				celltypeMap.erase(type);
+		}
 
 		log_debug("Cell type mappings to use:\n");
 		for (auto &i : celltypeMap) {
@@ -1293,7 +1454,35 @@ struct TechmapPass : public Pass {
 		}
 
 		log("No more expansions possible.\n");
-		delete map;
+
+		if (cache_key.empty() || GetSize(map->modules()) > techmap_library_cache_modules) {
+			delete map;
+		} else {
+			// a nested techmap call may have stored the same library meanwhile
+			auto existing = techmap_library_cache.find(cache_key);
+			if (existing != techmap_library_cache.end()) {
+				delete existing->second.map;
+				techmap_library_cache.erase(existing);
+			}
+			int cached_modules = GetSize(map->modules());
+			for (auto &it : techmap_library_cache)
+				cached_modules += GetSize(it.second.map->modules());
+			while (GetSize(techmap_library_cache) >= techmap_library_cache_size || cached_modules > techmap_library_cache_modules) {
+				auto oldest = techmap_library_cache.begin();
+				for (auto it = techmap_library_cache.begin(); it != techmap_library_cache.end(); ++it)
+					if (it->second.last_used < oldest->second.last_used)
+						oldest = it;
+				cached_modules -= GetSize(oldest->second.map->modules());
+				delete oldest->second.map;
+				techmap_library_cache.erase(oldest);
+			}
+			TechmapLibrary &library = techmap_library_cache[cache_key];
+			library.map = map;
+			library.celltypeMap = std::move(celltypeMap);
+			library.last_used = ++techmap_library_counter;
+			library.techmap_cache = std::move(worker.techmap_cache);
+			library.techmap_do_cache = std::move(worker.techmap_do_cache);
+		}
 
 		log_pop();
 	}
@@ -569,7 +569,33 @@ static void run_edges_test(RTLIL::Design *design, bool verbose)
 		log_error("SAT-based edge table does not match the database!\n");
 }
 
-static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::string uut_name, std::ofstream &vlog_file)
+static void run_satgen_bench(RTLIL::Design *design, int iterations, PerformanceTimer &direct_timer, PerformanceTimer &template_timer)
+{
+	RTLIL::Module *gold_mod = design->module(ID(gold));
+	SigMap sigmap(gold_mod);
+
+	for (int use_templates = 0; use_templates < 2; use_templates++)
+	for (bool model_undef : {false, true})
+	{
+		PerformanceTimer &timer = use_templates ? template_timer : direct_timer;
+		timer.begin();
+		for (int i = 0; i < iterations; i++) {
+			ezSAT ez;
+			SatGen satgen(&ez, &sigmap);
+			satgen.model_undef = model_undef;
+			satgen.cnf_templates = use_templates;
+			for (auto cell : gold_mod->cells())
+				satgen.importCell(cell);
+			// force the direct import to generate CNF, like the template import does
+			for (auto wire : gold_mod->wires())
+				for (int id : satgen.importSigSpec(wire))
+					ez.bind(id);
+		}
+		timer.end();
+	}
+}
+
+static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, bool satgen_templates, std::string uut_name, std::ofstream &vlog_file)
 {
 	log("Eval testing:%c", verbose ? '\n' : ' ');
 
@@ -582,6 +608,8 @@ static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::
 	SatGen satgen1(ez1.get(), &sigmap);
 	SatGen satgen2(ez2.get(), &sigmap);
 	satgen2.model_undef = true;
+	satgen1.cnf_templates = satgen_templates;
+	satgen2.cnf_templates = satgen_templates;
 
 	if (!nosat)
 		for (auto cell : gold_mod->cells()) {
@@ -860,6 +888,15 @@ struct TestCellPass : public Pass {
 		log("    -noopt\n");
 		log("        do not opt tecchmapped design\n");
 		log("\n");
+		log("    -satgen-templates\n");
+		log("        import cells into the SAT models of the const-eval check using cached\n");
+		log("        CNF templates (see SatGen::cnf_templates)\n");
+		log("\n");
+		log("    -satgen-bench {integer}\n");
+		log("        don't test anything. instead import each generated cell this number\n");
+		log("        of times into a new SAT model, once directly and once using cached\n");
+		log("        CNF templates, and report the import throughput of both\n");
+		log("\n");
 		log("    -edges\n");
 		log("        test cell edges db creator against sat-based implementation\n");
 		log("\n");
@@ -890,6 +927,8 @@ struct TestCellPass : public Pass {
 		bool noopt = false;
 		bool edges = false;
 		bool check_cost = false;
+		bool satgen_templates = false;
+		int satgen_bench = 0;
 
 		int argidx;
 		for (argidx = 1; argidx < GetSize(args); argidx++)
@@ -947,6 +986,14 @@ struct TestCellPass : public Pass {
 				noopt = true;
 				continue;
 			}
+			if (args[argidx] == "-satgen-templates") {
+				satgen_templates = true;
+				continue;
+			}
+			if (args[argidx] == "-satgen-bench" && argidx+1 < GetSize(args)) {
+				satgen_bench = atoi(args[++argidx].c_str());
+				continue;
+			}
 			if (args[argidx] == "-edges") {
 				edges = true;
 				continue;
@@ -1134,6 +1181,8 @@ struct TestCellPass : public Pass {
 			int worst_abs = 0;
 			// How many times is it bigger than estimated?
 			float worst_rel = 0.0;
+			// CPU time of SatGen imports for -satgen-bench
+			PerformanceTimer direct_timer, template_timer;
 			for (int i = 0; i < num_iter; i++)
 			{
 				Cell* uut = nullptr;
@@ -1166,6 +1215,8 @@ struct TestCellPass : public Pass {
 						}
 					}
 					Pass::call(design, stringf("%s %s_%s_%05d.%s", writer, write_prefix, cell_type.c_str()+1, i, suffix));
+				} else if (satgen_bench > 0) {
+					run_satgen_bench(design, satgen_bench, direct_timer, template_timer);
 				} else if (edges) {
 					Pass::call(design, "dump gold");
 					run_edges_test(design, verbose);
@@ -1189,7 +1240,7 @@ struct TestCellPass : public Pass {
 						uut_names.push_back(uut_name);
 					}
 					if (!noeval)
-						run_eval_test(design, verbose, nosat, uut_name, vlog_file);
+						run_eval_test(design, verbose, nosat, satgen_templates, uut_name, vlog_file);
 					if (check_cost && uut) {
 						Pass::call(design, "select gate");
 						int num_cells = 0;
@@ -1221,6 +1272,12 @@ struct TestCellPass : public Pass {
 				}
 				delete design;
 			}
+			if (satgen_bench > 0) {
+				double imports = 2.0 * num_iter * satgen_bench;
+				log("SatGen import of %s: %.0f cells/s direct, %.0f cells/s with CNF templates (%.2fx).\n", cell_type.c_str(),
+						imports / std::max(direct_timer.sec(), 1e-9f), imports / std::max(template_timer.sec(), 1e-9f),
+						direct_timer.sec() / std::max(template_timer.sec(), 1e-9f));
+			}
 			if (check_cost && failed) {
 				log_warning("Cell type %s cost underestimated in %.1f%% cases "
 					    "with worst offender being by %d (%.1f%%)\n",
@@ -314,7 +314,7 @@ void xilinx_dsp_pack(xilinx_dsp_pm &pm)
 	if (st.postAdd) {
 		log("  postadder %s (%s)\n", st.postAdd, st.postAdd->type.unescape());
 
-		SigSpec &opmode = cell->connections_.at(ID(OPMODE));
+		SigSpec opmode = cell->getPort(ID(OPMODE));
 		if (st.postAddMux) {
 			log_assert(st.ffP);
 			opmode[4] = st.postAddMux->getPort(ID::S);
@@ -326,6 +326,7 @@ void xilinx_dsp_pack(xilinx_dsp_pm &pm)
 			opmode[4] = State::S1;
 		opmode[6] = State::S0;
 		opmode[5] = State::S1;
+		cell->setPort(ID(OPMODE), opmode);
 
 		if (opmode[4] != State::S0) {
 			if (st.postAddMuxAB == ID::A)
@@ -443,13 +444,17 @@ void xilinx_dsp_pack(xilinx_dsp_pm &pm)
 		if (st.ffM) {
 			SigSpec M; // unused
 			f(M, st.ffM, ID(CEM), ID(RSTM));
-			st.ffM->connections_.at(ID::Q).replace(st.sigM, pm.module->addWire(NEW_ID, GetSize(st.sigM)));
+			SigSpec Q = st.ffM->getPort(ID::Q);
+			Q.replace(st.sigM, pm.module->addWire(NEW_ID, GetSize(st.sigM)));
+			st.ffM->setPort(ID::Q, Q);
 			cell->setParam(ID(MREG), State::S1);
 		}
 		if (st.ffP) {
 			SigSpec P; // unused
 			f(P, st.ffP, ID(CEP), ID(RSTP));
-			st.ffP->connections_.at(ID::Q).replace(st.sigP, pm.module->addWire(NEW_ID, GetSize(st.sigP)));
+			SigSpec Q = st.ffP->getPort(ID::Q);
+			Q.replace(st.sigP, pm.module->addWire(NEW_ID, GetSize(st.sigP)));
+			st.ffP->setPort(ID::Q, Q);
 			cell->setParam(ID(PREG), State::S1);
 		}
 
@@ -508,7 +513,7 @@ void xilinx_dsp48a_pack(xilinx_dsp48a_pm &pm)
 	log_debug("ffP:        %s\n", st.ffP ? st.ffP->name.unescape() : "--");
 
 	Cell *cell = st.dsp;
-	SigSpec &opmode = cell->connections_.at(ID(OPMODE));
+	SigSpec opmode = cell->getPort(ID(OPMODE));
 
 	if (st.preAdd) {
 		log("  preadder %s (%s)\n", st.preAdd, st.preAdd->type.unescape());
@@ -553,6 +558,8 @@ void xilinx_dsp48a_pack(xilinx_dsp48a_pm &pm)
 		pm.autoremove(st.postAdd);
 	}
 
+	cell->setPort(ID(OPMODE), opmode);
+
 	if (st.clock != SigBit())
 	{
 		cell->setPort(ID::CLK, st.clock);
@@ -626,13 +633,17 @@ void xilinx_dsp48a_pack(xilinx_dsp48a_pm &pm)
 		if (st.ffM) {
 			SigSpec M; // unused
 			f(M, st.ffM, ID(CEM), ID(RSTM));
-			st.ffM->connections_.at(ID::Q).replace(st.sigM, pm.module->addWire(NEW_ID, GetSize(st.sigM)));
+			SigSpec Q = st.ffM->getPort(ID::Q);
+			Q.replace(st.sigM, pm.module->addWire(NEW_ID, GetSize(st.sigM)));
+			st.ffM->setPort(ID::Q, Q);
 			cell->setParam(ID(MREG), State::S1);
 		}
 		if (st.ffP) {
 			SigSpec P; // unused
 			f(P, st.ffP, ID(CEP), ID(RSTP));
-			st.ffP->connections_.at(ID::Q).replace(st.sigP, pm.module->addWire(NEW_ID, GetSize(st.sigP)));
+			SigSpec Q = st.ffP->getPort(ID::Q);
+			Q.replace(st.sigP, pm.module->addWire(NEW_ID, GetSize(st.sigP)));
+			st.ffP->setPort(ID::Q, Q);
 			cell->setParam(ID(PREG), State::S1);
 		}
 
@@ -807,13 +818,20 @@ struct XilinxDspPass : public Pass {
 			if (family == "xc7")
 				xilinx_simd_pack(module, module->selected_cells());
 
+			// The matchers below share the signal map and users of the
+			//   module, and catch up with the changes made by the
+			//   previous ones instead of rebuilding them
+			pmgen_module_index index(module);
+
 			// Match for all features ([ABDMP][12]?REG, pre-adder,
 			// post-adder, pattern detector, etc.) except for CREG
 			if (family == "xc7") {
-				xilinx_dsp_pm pm(module, module->selected_cells());
+				xilinx_dsp_pm pm(index);
+				pm.setup();
 				pm.run_xilinx_dsp_pack(xilinx_dsp_pack);
 			} else if (family == "xc6s" || family == "xc3sda") {
-				xilinx_dsp48a_pm pm(module, module->selected_cells());
+				xilinx_dsp48a_pm pm(index);
+				pm.setup();
 				pm.run_xilinx_dsp48a_pack(xilinx_dsp48a_pack);
 			}
 			// Separating out CREG packing is necessary since there
@@ -825,14 +843,16 @@ struct XilinxDspPass : public Pass {
 			//   PREG of an upstream DSP that had not been visited
 			//   yet
 			{
-				xilinx_dsp_CREG_pm pm(module, module->selected_cells());
+				xilinx_dsp_CREG_pm pm(index);
+				pm.setup();
 				pm.run_xilinx_dsp_packC(xilinx_dsp_packC);
 			}
 			// Lastly, identify and utilise PCOUT -> PCIN,
 			//   ACOUT -> ACIN, and BCOUT-> BCIN dedicated cascade
 			//   chains
 			{
-				xilinx_dsp_cascade_pm pm(module, module->selected_cells());
+				xilinx_dsp_cascade_pm pm(index);
+				pm.setup();
 				pm.run_xilinx_dsp_cascade();
 			}
 		}
@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+# Run peepopt and xilinx_dsp with the matcher indices updated incrementally
+# and with the indices rebuilt before every run, the netlists must be the same.
+
+set -e
+
+export TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+cat > $TMPDIR/peepopt.v <<EOT
+module shiftmul(input [11:0] D, input [1:0] S, input [2:0] w, output [11:0] Y, output [7:0] Z);
+	assign Y = D >> (S*3);
+	assign Z = 1'b1 >> (w * (3'b110));
+endmodule
+module muldiv(input [11:0] a, output [11:0] y);
+	assign y = (a * 16'd5140) / (257 * 2);
+endmodule
+EOT
+
+cat > $TMPDIR/cascade.v <<EOT
+module cascade(input clk, input [4:0] a, input [4:0] b, output reg [9:0] o);
+reg [4:0] ar1, ar2, ar3, br1, br2, br3;
+reg [9:0] m, n;
+always @(posedge clk) begin
+ar1 <= a;
+ar2 <= ar1;
+ar3 <= ar2;
+br1 <= b;
+br2 <= br1;
+br3 <= br2;
+m <= ar1 * br1;
+n <= ar2 * br2 + m;
+o <= ar3 * br3 + n;
+end
+endmodule
+EOT
+
+for rebuild in 0 1; do
+	${YOSYS} -q -p "
+		scratchpad -set pmgen.full_rebuild $rebuild
+		read_verilog $TMPDIR/peepopt.v
+		prep -nokeepdc
+		peepopt
+		opt_clean
+		write_verilog -noattr $TMPDIR/peepopt_$rebuild.v
+	"
+	for top in macc macc2; do
+		for family in xc7 xc6s; do
+			${YOSYS} -q -p "
+				scratchpad -set pmgen.full_rebuild $rebuild
+				read_verilog macc.v
+				synth_xilinx -top $top -family $family -run :coarse
+				opt_clean
+				write_verilog -noattr $TMPDIR/${top}_${family}_$rebuild.v
+			"
+		done
+	done
+	${YOSYS} -q -p "
+		scratchpad -set pmgen.full_rebuild $rebuild
+		read_verilog $TMPDIR/cascade.v
+		synth_xilinx -noiopad -run :coarse
+		opt_clean
+		write_verilog -noattr $TMPDIR/cascade_$rebuild.v
+	"
+done
+
+for design in peepopt macc_xc7 macc_xc6s macc2_xc7 macc2_xc6s cascade; do
+	diff $TMPDIR/${design}_0.v $TMPDIR/${design}_1.v
+done
@@ -11,6 +11,12 @@ def run_subtest(name):
         f"./cxxrtl-test-{name}",
     ])
 
+def run_fst_subtest():
+    gen_tests_makefile.generate_cmd_test("cxxrtl_fst", [
+        f"$${{CXX:-g++}} -std=c++11 -O2 -o cxxrtl-test-fst -I../../backends/cxxrtl/runtime -I../../libs/fst test_fst.cc ../../libs/fst/fstapi.cc ../../libs/fst/fastlz.cc ../../libs/fst/lz4.cc -lstdc++ -lz -pthread",
+        f"./cxxrtl-test-fst",
+    ])
+
 def compile_only():
     gen_tests_makefile.generate_cmd_test("cxxrtl_unconnected_output", [
         '$(YOSYS) -p "read_verilog test_unconnected_output.v; select =*; proc; clean; write_cxxrtl cxxrtl-test-unconnected_output.cc"',
@@ -21,6 +27,7 @@ def main():
     def callback():
         run_subtest("value")
         run_subtest("value_fuzz")
+        run_fst_subtest()
         compile_only()
 
     gen_tests_makefile.generate_custom(callback)
@@ -0,0 +1,57 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "cxxrtl/cxxrtl.h"
+#include "cxxrtl/cxxrtl_fst.h"
+
+static std::string value_at(fstReaderContext *reader, uint64_t time, fstHandle handle)
+{
+    char buf[128];
+    return fstReaderGetValueFromHandleAtTime(reader, time, handle, buf);
+}
+
+int main()
+{
+    cxxrtl::value<1> clk;
+    cxxrtl::value<40> count;
+    // A width that is a multiple of 32 bits, as the last variable of every sample.
+    cxxrtl::value<64> wide;
+    cxxrtl::debug_items items;
+    items.add("top clk", cxxrtl::debug_item(clk));
+    items.add("top count", cxxrtl::debug_item(count));
+    items.add("top wide", cxxrtl::debug_item(wide));
+
+    {
+        cxxrtl::fst_writer writer;
+        bool opened = writer.open("cxxrtl-test-fst.fst");
+        assert(opened);
+        (void)opened;
+        writer.timescale(1, "ns");
+        // Use tiny buffers so that many of them are handed off to the compression thread.
+        writer.buffering(16, 2);
+        writer.add(items);
+        for (uint64_t step = 0; step < 1000; step++) {
+            clk.data[0] = step & 1;
+            if (clk.data[0])
+                count = count.add(cxxrtl::value<40>(0x10000001u, 0x1u));
+            wide = cxxrtl::value<64>(uint32_t(step), 0x80000000u);
+            writer.sample(step * 5);
+        }
+    }
+
+    fstReaderContext *reader = fstReaderOpen("cxxrtl-test-fst.fst");
+    assert(reader != nullptr);
+    fstReaderSetFacProcessMaskAll(reader);
+    assert(fstReaderGetEndTime(reader) == 999 * 5);
+    assert(value_at(reader, 0, 1) == "0");
+    assert(value_at(reader, 5, 1) == "1");
+    assert(value_at(reader, 12, 1) == "0");
+    assert(value_at(reader, 17, 1) == "1");
+    // After 10 rising edges, count is 10 * 0x110000001 = 0xaa000000a.
+    assert(value_at(reader, 95, 2) == "0000101010100000000000000000000000001010");
+    assert(value_at(reader, 15, 3) == "1" + std::string(61, '0') + "11");
+    fstReaderClose(reader);
+    return 0;
+}
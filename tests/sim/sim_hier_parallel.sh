@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# Simulate a hierarchy of sibling instances with one work unit per thread, so
+# that the instances are updated in parallel, and replay the resulting trace
+# on the flattened design.
+
+set -e
+
+YOSYS_WORK_UNITS_PER_THREAD=1 ${YOSYS} -q -p "
+	read_verilog -formal sim_hier_parallel.v
+	hierarchy -top top
+	proc
+	chformal -lower
+	memory -nomap
+	sim -clock clk -n 30 -assert -fst sim_hier_parallel.fst top
+"
+
+${YOSYS} -q -p "
+	read_verilog -formal sim_hier_parallel.v
+	hierarchy -top top
+	proc
+	chformal -lower
+	memory -nomap
+	flatten
+	sim -r sim_hier_parallel.fst -scope top -sim-cmp -q top
+"
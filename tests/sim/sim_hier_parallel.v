@@ -0,0 +1,17 @@
+module cnt(input clk, input [3:0] inc, output reg [7:0] q, output [7:0] m);
+	reg [7:0] mem [0:3];
+	initial q = 0;
+	always @(posedge clk) begin
+		q <= q + inc;
+		mem[q[1:0]] <= q ^ {inc, inc};
+		assert (q != 8'hff);
+	end
+	assign m = mem[inc[1:0]];
+endmodule
+
+module top(input clk, output [7:0] a, b, c, d, ma, mb, mc, md);
+	cnt u0(clk, 4'd1, a, ma);
+	cnt u1(clk, a[3:0], b, mb);
+	cnt u2(clk, 4'd3, c, mc);
+	cnt u3(clk, b[5:2], d, md);
+endmodule
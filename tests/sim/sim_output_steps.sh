@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# Write the trace of a simulation over many steps, in which signals change at
+# different rates, as VCD and FST. Replaying a trace compares every wire of the
+# design at every step with the values in the file, so a change that is missing
+# from the written output steps is reported as a signal difference.
+
+set -e
+
+${YOSYS} -q -p "
+	read_verilog sim_output_steps.v
+	hierarchy -top top
+	proc
+	memory -nomap
+	sim -clock clk -n 80 -vcd sim_output_steps.vcd -fst sim_output_steps.fst top
+"
+
+for trace in sim_output_steps.vcd sim_output_steps.fst; do
+	${YOSYS} -q -p "
+		read_verilog sim_output_steps.v
+		hierarchy -top top
+		proc
+		memory -nomap
+		sim -r $trace -scope top -sim-cmp -q top
+	"
+done
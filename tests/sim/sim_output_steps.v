@@ -0,0 +1,27 @@
+module counter #(parameter W = 4) (input clk, output reg [W-1:0] q, output wrap);
+	initial q = 0;
+	always @(posedge clk)
+		q <= q + 1;
+	assign wrap = &q;
+endmodule
+
+module top(input clk, output [3:0] fast, output reg [7:0] slow, output reg [7:0] rdata);
+	wire wrap;
+	counter #(.W(4)) c_fast (.clk(clk), .q(fast), .wrap(wrap));
+
+	reg [7:0] mem [0:3];
+	integer i;
+	initial begin
+		slow = 0;
+		rdata = 0;
+		for (i = 0; i < 4; i = i + 1)
+			mem[i] = 0;
+	end
+
+	always @(posedge clk) begin
+		if (wrap)
+			slow <= slow + 8'd3;
+		mem[fast[1:0]] <= {fast, slow[3:0]};
+		rdata <= mem[fast[3:2]];
+	end
+endmodule
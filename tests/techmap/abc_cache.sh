@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Map two copies of the same module with the ABC result cache in an empty
+# cache directory. In the first run, the second copy reuses the result of the
+# first one. In the second run, both copies are served from the cache. A cache
+# directory writable by other users is not used.
+
+set -e
+
+export TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+export XDG_CACHE_HOME=$TMPDIR/cache
+
+cat > $TMPDIR/abc_cache.v <<EOT
+module a(input [3:0] x, y, output [3:0] z);
+	assign z = x + y;
+endmodule
+module b(input [3:0] x, y, output [3:0] z);
+	assign z = x + y;
+endmodule
+EOT
+
+${YOSYS} -q -p "
+	read_verilog $TMPDIR/abc_cache.v
+	techmap
+	logger -expect log \"ABC result cache: 1 hits, 1 misses.\" 1
+	abc -cache
+	logger -check-expected
+"
+
+${YOSYS} -q -p "
+	read_verilog $TMPDIR/abc_cache.v
+	techmap
+	logger -expect log \"ABC result cache: 2 hits, 0 misses.\" 1
+	equiv_opt -assert abc -cache
+	logger -check-expected
+"
+
+test -d $XDG_CACHE_HOME/yosys/abc
+test "$(ls -ld $XDG_CACHE_HOME/yosys/abc | cut -c1-10)" = drwx------
+
+mkdir $TMPDIR/shared
+chmod 777 $TMPDIR/shared
+${YOSYS} -q -p "
+	read_verilog $TMPDIR/abc_cache.v
+	techmap
+	logger -expect warning \"ABC: not using the result cache: .* is writable by other users\" 1
+	abc -cache_dir $TMPDIR/shared
+	logger -check-expected
+"
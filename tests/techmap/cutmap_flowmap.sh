@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+# Map the designs of the former flowmap tests to LUTs and to gates. The LUT
+# counts and depths are the ones reached for k=3 and k=4, pack2.v and pack3.v
+# reduce to constants once the whole cone fits into one cut.
+
+set -e
+
+check() {
+	design=$1 luts3=$2 depth3=$3 luts4=$4 depth4=$5
+	${YOSYS} -q -p "
+		read_verilog ../../passes/tests/flowmap/$design.v
+		proc
+		design -stash input
+
+		design -load input
+		equiv_opt -assert cutmap -lut 3
+		design -load postopt
+		select -assert-none t:* t:\$lut %d
+		select -assert-none t:\$lut r:WIDTH>3 %i
+		select -assert-max $luts3 t:\$lut
+		logger -expect log \"Longest topological path in .* \(length=$depth3\)\" 1
+		ltp -noff
+		logger -check-expected
+
+		design -load input
+		equiv_opt -assert cutmap -lut 4
+		design -load postopt
+		select -assert-none t:* t:\$lut %d
+		select -assert-none t:\$lut r:WIDTH>4 %i
+		select -assert-max $luts4 t:\$lut
+		logger -expect log \"Longest topological path in .* \(length=$depth4\)\" 1
+		ltp -noff
+		logger -check-expected
+
+		design -load input
+		equiv_opt -assert cutmap -lut 4 -cuts 2 -area 0
+		design -load postopt
+		select -assert-none t:* t:\$lut %d
+		select -assert-none t:\$lut r:WIDTH>4 %i
+
+		design -load input
+		equiv_opt -assert cutmap -g aig
+		design -load postopt
+		select -assert-none t:* t:\$_AND_ t:\$_NAND_ t:\$_OR_ t:\$_NOR_ t:\$_ANDNOT_ t:\$_ORNOT_ t:\$_NOT_ %u %u %u %u %u %u %d
+
+		design -load input
+		equiv_opt -assert cutmap -g cmos4
+		design -load postopt
+		select -assert-none t:* t:\$_NAND_ t:\$_NOR_ t:\$_AOI3_ t:\$_OAI3_ t:\$_AOI4_ t:\$_OAI4_ t:\$_NOT_ %u %u %u %u %u %u %d
+	"
+}
+
+#     design luts3 depth3 luts4 depth4
+check flow   9 3 5 2
+check flowp  6 3 4 2
+check pack1  6 2 3 2
+check pack1p 6 2 3 2
+check pack2  4 3 0 0
+check pack2p 4 3 3 2
+check pack3  0 0 0 0
+check pack3p 2 2 1 1
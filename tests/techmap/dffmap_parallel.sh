@@ -0,0 +1,9 @@
+#!/usr/bin/env bash
+# Run the dfflegalize and dfflibmap tests with one work unit per thread, so
+# that the FFs are converted and checked on worker threads.
+
+set -e
+
+for t in dfflegalize_dff_init dfflegalize_inv dfflegalize_mince dfflegalize_minsrst dfflibmap; do
+	YOSYS_WORK_UNITS_PER_THREAD=1 ${YOSYS} -q -s $t.ys
+done
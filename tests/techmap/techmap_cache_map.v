@@ -0,0 +1,14 @@
+(* techmap_celltype = "$add" *)
+module add_to_xor #(
+	parameter A_SIGNED = 0,
+	parameter B_SIGNED = 0,
+	parameter A_WIDTH = 1,
+	parameter B_WIDTH = 1,
+	parameter Y_WIDTH = 1
+) (
+	input [A_WIDTH-1:0] A,
+	input [B_WIDTH-1:0] B,
+	output [Y_WIDTH-1:0] Y
+);
+	assign Y = A ^ B;
+endmodule
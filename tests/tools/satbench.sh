@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+# Compare the solve times of SAT solvers on equivalence miters of the designs
+# in tests/sat. Each design is proven equivalent to its gate-level netlist
+# with 'sat -tempinduct', once for every solver. Only the time spent in the
+# solver, as reported by 'sat', is compared; reading, synthesizing and
+# encoding the designs is the same for every solver and not included.
+#
+# Usage: satbench.sh [-l <ipasir-library>]... [solver]...
+#
+# Every library given with -l is loaded with the 'ipasir' command and is
+# benchmarked under the name of its file. minisat is always included as the
+# reference. Set SATBENCH_CNF to a directory to also
+# dump the CNF of each miter there.
+
+set -e -o pipefail
+
+toolsdir="$(cd "$(dirname "$0")"; pwd)"
+yosys="${YOSYS:-$toolsdir/../../yosys}"
+designs="alu.v counters.v grom_computer.v grom_cpu.v share.v splice.v"
+
+load=""
+solvers=()
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-l)
+			name="$(basename "$2")"
+			name="${name%%.*}"
+			load="$load ipasir -name $name $(realpath "$2");"
+			solvers+=("$name")
+			shift 2 ;;
+		*)
+			solvers+=("$1")
+			shift ;;
+	esac
+done
+if ! printf '%s\n' "${solvers[@]}" | grep -qx minisat; then
+	solvers=("minisat" "${solvers[@]}")
+fi
+
+printf "%-20s" design
+for solver in "${solvers[@]}"; do
+	printf " %12s" "$solver"
+done
+echo
+
+for design in $designs; do
+	printf "%-20s" "$design"
+	for solver in "${solvers[@]}"; do
+		dump=""
+		if [ -n "$SATBENCH_CNF" ] && [ "$solver" = minisat ]; then
+			mkdir -p "$SATBENCH_CNF"
+			dump="-dump_cnf $SATBENCH_CNF/${design%.v}.cnf"
+		fi
+		seconds=$("$yosys" -p "
+			$load
+			read_verilog $toolsdir/../sat/$design
+			hierarchy -auto-top
+			proc; flatten; opt_clean
+			rename -top gold
+			design -stash gold
+			read_verilog $toolsdir/../sat/$design
+			hierarchy -auto-top
+			synth -flatten
+			rename -top gate
+			design -stash gate
+			design -copy-from gold -as gold gold
+			design -copy-from gate -as gate gate
+			miter -equiv -flatten -make_assert -ignore_gold_x gold gate miter
+			sat -tempinduct -prove-asserts -set-init-zero -seq 1 -maxsteps 8 -select-solver $solver $dump miter
+		" | sed -n 's/^Time spent in the SAT solver: \(.*\) seconds\.$/\1/p')
+		printf " %12s" "$seconds"
+	done
+	echo
+done
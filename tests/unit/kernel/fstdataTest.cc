@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "kernel/fstdata.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// A trace of 1000 time steps, split into blocks of 100 time steps. clk toggles
+// every step, cnt counts the rising edges and slow toggles every 128 steps, so
+// most blocks start without a change of slow.
+class FstDataTest : public testing::Test {
+protected:
+	std::string filename;
+
+	static std::string bits(unsigned value, int width)
+	{
+		std::string str;
+		for (int i = width - 1; i >= 0; i--)
+			str += (value >> i) & 1 ? '1' : '0';
+		return str;
+	}
+
+	void SetUp() override
+	{
+		filename = make_temp_file(get_base_tmpdir() + "/yosys_fstdata_XXXXXX") + ".fst";
+		fstWriterContext *writer = fstWriterCreate(filename.c_str(), 1);
+		ASSERT_NE(writer, nullptr);
+		fstWriterSetScope(writer, FST_ST_VCD_MODULE, "top", nullptr);
+		fstHandle clk = fstWriterCreateVar(writer, FST_VT_VCD_WIRE, FST_VD_IMPLICIT, 1, "clk", 0);
+		fstHandle cnt = fstWriterCreateVar(writer, FST_VT_VCD_REG, FST_VD_IMPLICIT, 8, "cnt", 0);
+		fstHandle slow = fstWriterCreateVar(writer, FST_VT_VCD_REG, FST_VD_IMPLICIT, 1, "slow", 0);
+		fstWriterSetUpscope(writer);
+
+		for (unsigned t = 0; t < 1000; t++) {
+			if (t > 0 && t % 100 == 0)
+				fstWriterFlushContext(writer);
+			fstWriterEmitTimeChange(writer, t);
+			fstWriterEmitValueChange(writer, clk, bits(t % 2, 1).c_str());
+			if (t % 2 == 0)
+				fstWriterEmitValueChange(writer, cnt, bits(t / 2 % 256, 8).c_str());
+			if (t % 128 == 0)
+				fstWriterEmitValueChange(writer, slow, bits(t / 128 % 2, 1).c_str());
+		}
+		fstWriterClose(writer);
+	}
+
+	void TearDown() override
+	{
+		remove(filename.c_str());
+	}
+
+	// Reads the samples in [start, end] and checks them against the trace.
+	// Returns the number of samples.
+	int checkSamples(uint64_t start, uint64_t end, bool clocked, unsigned int end_cycle = UINT_MAX)
+	{
+		FstData fst(filename);
+		std::vector<fstHandle> clocks;
+		if (clocked)
+			clocks.push_back(fst.getHandle("top.clk"));
+		fstHandle cnt = fst.getHandle("top.cnt");
+		fstHandle slow = fst.getHandle("top.slow");
+
+		int count = 0;
+		uint64_t time, prev_time = 0;
+		fst.beginSamples(clocks, start, end, end_cycle);
+		while (fst.nextSample(time)) {
+			EXPECT_GE(time, start);
+			EXPECT_LE(time, end);
+			if (count > 0)
+				EXPECT_GT(time, prev_time);
+			EXPECT_EQ(fst.valueOf(cnt), bits(time / 2 % 256, 8)) << "at time " << time;
+			EXPECT_EQ(fst.valueOf(slow), bits(time / 128 % 2, 1)) << "at time " << time;
+			prev_time = time;
+			count++;
+		}
+		return count;
+	}
+};
+
+TEST_F(FstDataTest, multipleBlocks)
+{
+	fstReaderContext *reader = fstReaderOpen(filename.c_str());
+	ASSERT_NE(reader, nullptr);
+	EXPECT_EQ(fstReaderGetValueChangeSectionCount(reader), 10u);
+	fstReaderClose(reader);
+}
+
+TEST_F(FstDataTest, fullRead)
+{
+	EXPECT_EQ(checkSamples(0, 999, false), 1000);
+	EXPECT_EQ(checkSamples(0, 999, true), 1000);
+}
+
+TEST_F(FstDataTest, windowsAcrossBlocks)
+{
+	// windows starting in the middle of a block, ending in a later one
+	EXPECT_EQ(checkSamples(150, 250, false), 101);
+	EXPECT_EQ(checkSamples(150, 250, true), 101);
+	EXPECT_EQ(checkSamples(299, 701, true), 403);
+	// windows starting and ending at block boundaries
+	EXPECT_EQ(checkSamples(100, 300, false), 201);
+	EXPECT_EQ(checkSamples(99, 100, true), 2);
+	// a window within a single block
+	EXPECT_EQ(checkSamples(510, 520, false), 11);
+}
+
+TEST_F(FstDataTest, cycleLimitAcrossBlocks)
+{
+	EXPECT_EQ(checkSamples(150, 999, true, 200), 201);
+}
+
+YOSYS_NAMESPACE_END
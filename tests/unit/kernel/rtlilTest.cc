@@ -340,6 +340,30 @@ namespace RTLIL {
 		EXPECT_NO_FATAL_FAILURE(mod->addWire(ID(test), RTLIL::WIDTH_LIMIT - 1));
 	}
 
+	TEST_F(KernelRtlilTest, ModuleAddCells) {
+		std::unique_ptr<Module> mod = std::make_unique<Module>();
+		Wire *a = mod->addWire(ID(a), 3);
+		Wire *s = mod->addWire(ID(s));
+		Wire *y = mod->addWire(ID(y), 3);
+		dict<IdString, Const> attributes;
+		attributes[ID::src] = Const("test.v:1");
+
+		std::vector<Cell*> cells = mod->addCells({ID(g0), ID(g1), ID(g2)}, ID($_MUX_),
+				{{ID::A, a}, {ID::B, SigSpec(State::S1, 3)}, {ID::S, SigSpec(s, 3)}, {ID::Y, y}}, attributes);
+
+		ASSERT_EQ(cells.size(), 3u);
+		EXPECT_EQ(GetSize(mod->cells()), 3);
+		for (int i = 0; i < 3; i++) {
+			EXPECT_EQ(mod->cell(stringf("\\g%d", i)), cells[i]);
+			EXPECT_EQ(cells[i]->type, ID($_MUX_));
+			EXPECT_EQ(cells[i]->getPort(ID::A), SigSpec(SigBit(a, i)));
+			EXPECT_EQ(cells[i]->getPort(ID::B), SigSpec(State::S1));
+			EXPECT_EQ(cells[i]->getPort(ID::S), SigSpec(s));
+			EXPECT_EQ(cells[i]->getPort(ID::Y), SigSpec(SigBit(y, i)));
+			EXPECT_EQ(cells[i]->get_src_attribute(), "test.v:1");
+		}
+	}
+
 	TEST_F(KernelRtlilTest, ConstEqualStr) {
 		EXPECT_EQ(Const("abc"), Const("abc"));
 		EXPECT_NE(Const("abc"), Const("def"));
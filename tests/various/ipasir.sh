@@ -0,0 +1,8 @@
+set -e
+rm -f ipasir_stub.so
+CXXFLAGS=$(${YOSYS_CONFIG} --cxxflags)
+DATDIR=$(${YOSYS_CONFIG} --datdir)
+DATDIR=${DATDIR//\//\\\/}
+CXXFLAGS=${CXXFLAGS//$DATDIR/$BUILD_DIR/share}
+${YOSYS_CONFIG} --exec --cxx ${CXXFLAGS} --ldflags -shared -o ipasir_stub.so ipasir_stub.cc
+${YOSYS} -s ipasir_solve.ys_
@@ -0,0 +1,151 @@
+// A minimal solver implementing the IPASIR interface for testing the ipasir
+// command: plain DPLL with unit propagation and without learning, only usable
+// for small problems.
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+struct StubSolver
+{
+	std::vector<std::vector<int>> clauses;
+	std::vector<int> clause, assumptions, trail;
+	// value of each variable: 1 true, -1 false, 0 unassigned
+	std::vector<int> model;
+
+	int value(int lit) const
+	{
+		int v = model[std::abs(lit)];
+		return lit > 0 ? v : -v;
+	}
+
+	void assign(int lit)
+	{
+		model[std::abs(lit)] = lit > 0 ? 1 : -1;
+		trail.push_back(std::abs(lit));
+	}
+
+	void undo(size_t size)
+	{
+		while (trail.size() > size) {
+			model[trail.back()] = 0;
+			trail.pop_back();
+		}
+	}
+
+	bool dpll()
+	{
+		size_t trail_size = trail.size();
+		for (bool changed = true; changed; ) {
+			changed = false;
+			for (auto &c : clauses) {
+				int unassigned = 0, last = 0;
+				bool satisfied = false;
+				for (int lit : c) {
+					int v = value(lit);
+					if (v > 0) {
+						satisfied = true;
+						break;
+					}
+					if (v == 0)
+						unassigned++, last = lit;
+				}
+				if (satisfied)
+					continue;
+				if (unassigned == 0) {
+					undo(trail_size);
+					return false;
+				}
+				if (unassigned == 1) {
+					assign(last);
+					changed = true;
+				}
+			}
+		}
+
+		int var = 0;
+		for (int i = 1; i < int(model.size()) && var == 0; i++)
+			if (model[i] == 0)
+				var = i;
+		if (var == 0)
+			return true;
+
+		for (int lit : {var, -var}) {
+			size_t size = trail.size();
+			assign(lit);
+			if (dpll())
+				return true;
+			undo(size);
+		}
+		undo(trail_size);
+		return false;
+	}
+
+	void add_var(int lit)
+	{
+		if (std::abs(lit) >= int(model.size()))
+			model.resize(std::abs(lit) + 1);
+	}
+
+	int solve()
+	{
+		undo(0);
+		std::vector<int> assumed;
+		assumed.swap(assumptions);
+		for (int lit : assumed) {
+			if (value(lit) < 0)
+				return 20;
+			if (value(lit) == 0)
+				assign(lit);
+		}
+		return dpll() ? 10 : 20;
+	}
+};
+
+extern "C" {
+
+const char *ipasir_signature()
+{
+	return "ipasir_stub";
+}
+
+void *ipasir_init()
+{
+	return new StubSolver;
+}
+
+void ipasir_release(void *solver)
+{
+	delete (StubSolver*)solver;
+}
+
+void ipasir_add(void *solver, int32_t lit_or_zero)
+{
+	StubSolver *s = (StubSolver*)solver;
+	if (lit_or_zero == 0) {
+		s->clauses.push_back(s->clause);
+		s->clause.clear();
+	} else {
+		s->add_var(lit_or_zero);
+		s->clause.push_back(lit_or_zero);
+	}
+}
+
+void ipasir_assume(void *solver, int32_t lit)
+{
+	StubSolver *s = (StubSolver*)solver;
+	s->add_var(lit);
+	s->assumptions.push_back(lit);
+}
+
+int ipasir_solve(void *solver)
+{
+	return ((StubSolver*)solver)->solve();
+}
+
+int32_t ipasir_val(void *solver, int32_t lit)
+{
+	return ((StubSolver*)solver)->value(lit) < 0 ? -lit : lit;
+}
+
+}